@@ -0,0 +1,268 @@
+// Deterministic benchmark of the whole rendering pipeline.
+//
+// Loads the fixed scene presets (cubes, mountains, teapot, crates), flies the camera
+// along a scripted (or recorded) path instead of IO and renders N frames uncapped
+// without any window. Reports mean, p50, p99 and max frame time together with
+// triangles per second as CSV or JSON so runs can be compared between commits.
+// Built with -DPROFILER it also prints the per-stage breakdown of each scene
+// to stderr, and with -DRASTER_STATS the rasterizer counters.
+//
+// Build and run from sdl2-c (asset paths are relative to it):
+//   clang -O2 -o bench/bench bench/bench.c src/model/*.c src/model/*/*.c
+//         src/integration/plgreader.c src/integration/display.c src/integration/scene.c
+//         src/integration/profiler.c -lm -pthread
+//   bench/bench [--scene cubes|mountains|teapot|crates|all] [--frames N] [--warmup N]
+//               [--path recorded.txt] [--raster scanline|halfspace] [--stepping float|fixed|subpixel]
+//               [--threads N] [--hiz] [--clear full|epoch]
+//               [--depth linear|16|24|32|float] [--sort none|front-to-back|back-to-front]
+//               [--shading forward|deferred] [--hsr zbuffer|sbuffer] [--texture off|affine|16|8|exact]
+//               [--format csv|json] [--out file]
+
+#include "../src/integration/scene.h"
+#include "../src/integration/timer.h"
+#include "../src/integration/profiler.h"
+#include "../src/model/object/rasterstats.h"
+#include "../src/model/object/hiz.h"
+#include "../src/model/object/depth.h"
+#include "../src/model/pipeline.h"
+#include "../src/model/camerapath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FORMAT_CSV  0
+#define FORMAT_JSON 1
+
+// Result of benchmarking a single scene.
+typedef struct {
+    int    scene;
+    int    frames;
+    double mean_ms,
+           p50_ms,
+           p99_ms,
+           max_ms,
+           triangles_per_frame,
+           triangles_per_sec;
+}BenchResult;
+
+static Frame  frame;
+static Object objects[MAX_AMOUNT_OF_OBJECTS];
+static RGBA   palette[256];
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+// Nearest rank percentile of sorted frame times.
+static double percentile_ms(const uint64_t* sorted, int amount, int percent) {
+    int rank = (percent * amount + 99) / 100;
+    if(rank < 1) { rank = 1; }
+    return timer_ns_to_ms(sorted[rank - 1]);
+}
+
+// Renders warmup + frames frames of scene along path and collects statistics.
+static int bench_scene(BenchResult* result, int preset, const CameraPath* custom_path, int frames, int warmup) {
+    Scene scene;
+    CameraPath path;
+    Vector startpos = vector_create(0, 0, 0);
+    Camera* camera  = camera_init(&startpos);
+    uint64_t* times = malloc(sizeof(uint64_t) * frames);
+    uint64_t total_ns = 0, total_triangles = 0;
+
+    if(!scene_load_preset(&scene, objects, palette, preset)) {
+        fprintf(stderr, "bench: could not load scene %s\n", scene_preset_name(preset));
+        free(times);
+        free(camera);
+        return 0;
+    }
+    if(custom_path != NULL) {
+        path = *custom_path;
+    } else {
+        scene_preset_camera_path(&path, preset);
+    }
+
+    for(int i = 0; i < warmup; i++) {
+        camerapath_apply(&path, (float) i / (float) (warmup > 1 ? warmup - 1 : 1), camera);
+        pipeline_render_frame(&frame, &scene, camera);
+    }
+
+    PROFILE_RESET();
+    RASTER_STATS_RESET();
+    for(int i = 0; i < frames; i++) {
+        camerapath_apply(&path, (float) i / (float) (frames > 1 ? frames - 1 : 1), camera);
+        uint64_t start = timer_now_ns();
+        PROFILE_FRAME_BEGIN();
+        pipeline_render_frame(&frame, &scene, camera);
+        PROFILE_FRAME_END();
+        times[i] = timer_now_ns() - start;
+        total_ns        += times[i];
+        total_triangles += pipeline_count_triangles(&frame);
+    }
+
+#ifdef PROFILER
+    // per-stage breakdown goes to stderr so results stay machine readable.
+    fprintf(stderr, "%s: ", scene_preset_name(preset));
+    PROFILE_PRINT(stderr);
+#endif
+#ifdef RASTER_STATS
+    fprintf(stderr, "%s: ", scene_preset_name(preset));
+    RASTER_STATS_PRINT(stderr);
+#endif
+
+    qsort(times, frames, sizeof(uint64_t), compare_u64);
+    result->scene               = preset;
+    result->frames              = frames;
+    result->mean_ms             = timer_ns_to_ms(total_ns) / frames;
+    result->p50_ms              = percentile_ms(times, frames, 50);
+    result->p99_ms              = percentile_ms(times, frames, 99);
+    result->max_ms              = timer_ns_to_ms(times[frames - 1]);
+    result->triangles_per_frame = (double) total_triangles / frames;
+    result->triangles_per_sec   = (total_ns > 0) ? (double) total_triangles * 1e9 / (double) total_ns : 0;
+
+    if(custom_path == NULL) {
+        camerapath_free(&path);
+    }
+    free(times);
+    free(camera);
+    return 1;
+}
+
+static void print_results(FILE* out, const BenchResult* results, int amount, int format, int warmup) {
+    if(format == FORMAT_CSV) {
+        fprintf(out, "scene,frames,mean_ms,p50_ms,p99_ms,max_ms,triangles_per_frame,triangles_per_sec\n");
+        for(int i = 0; i < amount; i++) {
+            fprintf(out, "%s,%d,%.4f,%.4f,%.4f,%.4f,%.1f,%.0f\n",
+                    scene_preset_name(results[i].scene), results[i].frames,
+                    results[i].mean_ms, results[i].p50_ms, results[i].p99_ms, results[i].max_ms,
+                    results[i].triangles_per_frame, results[i].triangles_per_sec);
+        }
+        return;
+    }
+    fprintf(out, "{\n  \"warmup\": %d,\n  \"results\": [\n", warmup);
+    for(int i = 0; i < amount; i++) {
+        fprintf(out, "    {\"scene\": \"%s\", \"frames\": %d, \"mean_ms\": %.4f, \"p50_ms\": %.4f, "
+                     "\"p99_ms\": %.4f, \"max_ms\": %.4f, \"triangles_per_frame\": %.1f, \"triangles_per_sec\": %.0f}%s\n",
+                scene_preset_name(results[i].scene), results[i].frames,
+                results[i].mean_ms, results[i].p50_ms, results[i].p99_ms, results[i].max_ms,
+                results[i].triangles_per_frame, results[i].triangles_per_sec,
+                (i + 1 < amount) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int main(int arc, char* args[]) {
+    int frames = 300, warmup = 10, format = FORMAT_CSV, scene = -1, mode;
+    const char* path_file = NULL;
+    const char* out_file  = NULL;
+    CameraPath custom_path;
+    BenchResult results[AMOUNT_OF_SCENES];
+    int amount = 0;
+
+    for(int i = 1; i < arc; i++) {
+        if(strcmp(args[i], "--scene") == 0 && i + 1 < arc) {
+            i++;
+            if(strcmp(args[i], "all") != 0 && (scene = scene_preset_from_name(args[i])) < 0) {
+                fprintf(stderr, "bench: unknown scene %s\n", args[i]);
+                return 1;
+            }
+        }
+        else if(strcmp(args[i], "--frames") == 0 && i + 1 < arc) { frames = atoi(args[++i]); }
+        else if(strcmp(args[i], "--warmup") == 0 && i + 1 < arc) { warmup = atoi(args[++i]); }
+        else if(strcmp(args[i], "--path")   == 0 && i + 1 < arc) { path_file = args[++i]; }
+        else if(strcmp(args[i], "--out")    == 0 && i + 1 < arc) { out_file  = args[++i]; }
+        else if(strcmp(args[i], "--stepping") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], RASTER_FLOAT, RASTER_SUBPIXEL, raster_stepping_name)) < 0) {
+                fprintf(stderr, "bench: unknown --stepping value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_stepping(mode);
+        }
+        else if(strcmp(args[i], "--raster") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], RASTER_SCANLINE, RASTER_HALFSPACE, raster_algorithm_name)) < 0) {
+                fprintf(stderr, "bench: unknown --raster value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_algorithm(mode);
+        }
+        else if(strcmp(args[i], "--threads") == 0 && i + 1 < arc) { raster_set_threads(atoi(args[++i])); }
+        else if(strcmp(args[i], "--hiz") == 0) { raster_set_hiz(1); }
+        else if(strcmp(args[i], "--clear") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], CLEAR_FULL, CLEAR_EPOCH, raster_clear_name)) < 0) {
+                fprintf(stderr, "bench: unknown --clear value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_clear(mode);
+        }
+        else if(strcmp(args[i], "--depth") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], DEPTH_LINEAR, DEPTH_FORMATS - 1, depth_format_name)) < 0) {
+                fprintf(stderr, "bench: unknown --depth value %s\n", args[i]);
+                return 1;
+            }
+            depth_set_format(mode);
+        }
+        else if(strcmp(args[i], "--sort") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], POLY_SORT_NONE, POLY_SORT_BACK_TO_FRONT, poly_sort_name)) < 0) {
+                fprintf(stderr, "bench: unknown --sort value %s\n", args[i]);
+                return 1;
+            }
+            poly_set_sort(mode);
+        }
+        else if(strcmp(args[i], "--shading") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], SHADE_FORWARD, SHADE_DEFERRED, raster_shading_name)) < 0) {
+                fprintf(stderr, "bench: unknown --shading value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_shading(mode);
+        }
+        else if(strcmp(args[i], "--hsr") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], HSR_ZBUFFER, HSR_SBUFFER, raster_hsr_name)) < 0) {
+                fprintf(stderr, "bench: unknown --hsr value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_hsr(mode);
+        }
+        else if(strcmp(args[i], "--texture") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], TEXTURE_OFF, TEXTURE_EXACT, raster_texture_name)) < 0) {
+                fprintf(stderr, "bench: unknown --texture value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_texture(mode);
+        }
+        else if(strcmp(args[i], "--format") == 0 && i + 1 < arc) {
+            format = (strcmp(args[++i], "json") == 0) ? FORMAT_JSON : FORMAT_CSV;
+        }
+        else {
+            fprintf(stderr, "bench: unknown argument %s\n", args[i]);
+            return 1;
+        }
+    }
+    if(frames < 1) { frames = 1; }
+    if(warmup < 0) { warmup = 0; }
+    if(path_file != NULL && !camerapath_load(&custom_path, path_file)) {
+        return 1;
+    }
+
+    for(int preset = 0; preset < AMOUNT_OF_SCENES; preset++) {
+        if(scene != -1 && scene != preset) {
+            continue;
+        }
+        if(bench_scene(&results[amount], preset, path_file ? &custom_path : NULL, frames, warmup)) {
+            amount++;
+        }
+    }
+
+    FILE* out = stdout;
+    if(out_file != NULL && (out = fopen(out_file, "w")) == NULL) {
+        fprintf(stderr, "bench: could not open file %s\n", out_file);
+        return 1;
+    }
+    print_results(out, results, amount, format, warmup);
+    if(out != stdout) {
+        fclose(out);
+    }
+    if(path_file != NULL) {
+        camerapath_free(&custom_path);
+    }
+    return amount > 0 ? 0 : 1;
+}
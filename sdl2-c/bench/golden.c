@@ -0,0 +1,254 @@
+// Golden image regression runner.
+//
+// Renders a fixed set of scene presets and camera poses (positions along the
+// scripted camera path of each preset) without any window and compares each
+// frame against a stored reference image. A pose fails when more than
+// --max-diff of its pixels differ by more than --tolerance in any channel.
+// Each pose is also timed (median of --frames renders) and fails when it is
+// slower than the stored baseline by more than --margin percent.
+//
+// Reference images are kept in bench/golden/<scene>_<pose>.ppm. The timing
+// baseline (bench/golden/baseline.txt) depends on the machine and is not
+// committed, it is written by --update or --update-baseline. Without a
+// baseline only images are checked. Exit status is 1 if any pose failed.
+//
+// Build and run from sdl2-c (asset paths are relative to it):
+//   clang -O2 -o bench/golden bench/golden.c src/model/*.c src/model/*/*.c
+//         src/integration/plgreader.c src/integration/display.c src/integration/scene.c
+//         src/integration/image.c -lm -pthread
+//   bench/golden [--dir bench/golden] [--update | --update-baseline] [--tolerance N]
+//                [--max-diff fraction] [--margin percent] [--frames N] [--diff dir]
+
+#include "../src/integration/scene.h"
+#include "../src/integration/image.h"
+#include "../src/integration/timer.h"
+#include "../src/model/pipeline.h"
+#include "../src/model/camerapath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MODE_CHECK           0
+#define MODE_UPDATE          1  // write reference images and baseline
+#define MODE_UPDATE_BASELINE 2  // only write baseline
+
+#define MAX_BASELINES 64
+
+// A single camera pose, t is position along the scripted path of scene.
+typedef struct {
+    int   scene;
+    float t;
+}GoldenPose;
+
+static const GoldenPose poses[] = {
+    { SCENE_CUBES,     0.0f  },
+    { SCENE_CUBES,     0.5f  },
+    { SCENE_MOUNTAINS, 0.0f  },
+    { SCENE_MOUNTAINS, 0.5f  },
+    { SCENE_TEAPOT,    0.0f  },
+    { SCENE_TEAPOT,    0.5f  },
+    { SCENE_CRATES,    0.0f  },
+    { SCENE_CRATES,    0.5f  },
+};
+#define AMOUNT_OF_POSES ((int) (sizeof(poses) / sizeof(poses[0])))
+
+// Baseline frame time of a pose.
+typedef struct {
+    char   name[64];
+    double ms;
+}Baseline;
+
+static Frame    frame;
+static Object   objects[MAX_AMOUNT_OF_OBJECTS];
+static RGBA     palette[256];
+static uint32_t reference[ALL_PIXELS];
+static uint32_t diff[ALL_PIXELS];
+
+static Baseline baselines[MAX_BASELINES];
+static int      amount_of_baselines;
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+// Name of pose, e.g "mountains_050".
+static void pose_name(char* name, int length, const GoldenPose* pose) {
+    snprintf(name, length, "%s_%03d", scene_preset_name(pose->scene), (int) (pose->t * 100 + 0.5f));
+}
+
+// Loads baseline file, lines are: name ms. Missing file means no baselines.
+static void load_baselines(const char* filename) {
+    FILE* fp = fopen(filename, "r");
+    amount_of_baselines = 0;
+    if(fp == NULL) {
+        return;
+    }
+    while(amount_of_baselines < MAX_BASELINES &&
+          fscanf(fp, "%63s %lf", baselines[amount_of_baselines].name, &baselines[amount_of_baselines].ms) == 2) {
+        amount_of_baselines++;
+    }
+    fclose(fp);
+}
+
+static int save_baselines(const char* filename) {
+    FILE* fp = fopen(filename, "w");
+    if(fp == NULL) {
+        printf("could not open file %s\n", filename);
+        return 0;
+    }
+    for(int i = 0; i < amount_of_baselines; i++) {
+        fprintf(fp, "%s %.4f\n", baselines[i].name, baselines[i].ms);
+    }
+    fclose(fp);
+    return 1;
+}
+
+// Returns baseline of pose or NULL.
+static Baseline* find_baseline(const char* name) {
+    for(int i = 0; i < amount_of_baselines; i++) {
+        if(strcmp(baselines[i].name, name) == 0) {
+            return &baselines[i];
+        }
+    }
+    return NULL;
+}
+
+static void set_baseline(const char* name, double ms) {
+    Baseline* baseline = find_baseline(name);
+    if(baseline == NULL && amount_of_baselines < MAX_BASELINES) {
+        baseline = &baselines[amount_of_baselines++];
+        snprintf(baseline->name, sizeof(baseline->name), "%s", name);
+    }
+    if(baseline != NULL) {
+        baseline->ms = ms;
+    }
+}
+
+// Renders pose once for the image and then frames more times for the median frame time.
+static double render_pose(Scene* scene, const CameraPath* path, Camera* camera, float t, int frames) {
+    uint64_t* times = malloc(sizeof(uint64_t) * frames);
+
+    camerapath_apply(path, t, camera);
+    for(int i = 0; i < frames; i++) {
+        uint64_t start = timer_now_ns();
+        pipeline_render_frame(&frame, scene, camera);
+        times[i] = timer_now_ns() - start;
+    }
+    qsort(times, frames, sizeof(uint64_t), compare_u64);
+    double median = timer_ns_to_ms(times[frames / 2]);
+    free(times);
+    return median;
+}
+
+// Compares frame against reference. Returns amount of pixels where any channel
+// differs by more than tolerance, largest channel difference is put in max_delta.
+// diff gets the differing pixels in red on top of a dimmed reference.
+static int compare_images(const uint32_t* pixels, int tolerance, int* max_delta) {
+    int differing = 0;
+    *max_delta = 0;
+    for(int i = 0; i < ALL_PIXELS; i++) {
+        int pixel_delta = 0;
+        for(int shift = 0; shift < 24; shift += 8) {
+            int delta = abs((int) ((pixels[i] >> shift) & 0xFF) - (int) ((reference[i] >> shift) & 0xFF));
+            if(delta > pixel_delta) { pixel_delta = delta; }
+        }
+        if(pixel_delta > *max_delta) { *max_delta = pixel_delta; }
+        if(pixel_delta > tolerance) {
+            differing++;
+            diff[i] = _RGB32BIT(0, 255, 0, 0);
+        } else {
+            diff[i] = (reference[i] >> 2) & 0x3F3F3F;
+        }
+    }
+    return differing;
+}
+
+int main(int arc, char* args[]) {
+    const char* dir = "bench/golden";
+    const char* diff_dir = NULL;
+    int mode = MODE_CHECK, tolerance = 8, frames = 15;
+    double max_diff = 0.001, margin = 15;
+    int failures = 0;
+    char path[512], baseline_path[512], name[64];
+
+    for(int i = 1; i < arc; i++) {
+        if(strcmp(args[i], "--dir") == 0 && i + 1 < arc)              { dir = args[++i]; }
+        else if(strcmp(args[i], "--diff") == 0 && i + 1 < arc)        { diff_dir = args[++i]; }
+        else if(strcmp(args[i], "--update") == 0)                     { mode = MODE_UPDATE; }
+        else if(strcmp(args[i], "--update-baseline") == 0)            { mode = MODE_UPDATE_BASELINE; }
+        else if(strcmp(args[i], "--tolerance") == 0 && i + 1 < arc)   { tolerance = atoi(args[++i]); }
+        else if(strcmp(args[i], "--max-diff") == 0 && i + 1 < arc)    { max_diff = atof(args[++i]); }
+        else if(strcmp(args[i], "--margin") == 0 && i + 1 < arc)      { margin = atof(args[++i]); }
+        else if(strcmp(args[i], "--frames") == 0 && i + 1 < arc)      { frames = atoi(args[++i]); }
+        else {
+            fprintf(stderr, "golden: unknown argument %s\n", args[i]);
+            return 1;
+        }
+    }
+    if(frames < 1) { frames = 1; }
+
+    snprintf(baseline_path, sizeof(baseline_path), "%s/baseline.txt", dir);
+    load_baselines(baseline_path);
+
+    Vector startpos = vector_create(0, 0, 0);
+    Camera* camera  = camera_init(&startpos);
+
+    printf("%-16s %8s %10s %10s %10s  %s\n", "pose", "max diff", "pixels", "ms", "baseline", "result");
+    for(int p = 0; p < AMOUNT_OF_POSES; p++) {
+        const GoldenPose* pose = &poses[p];
+        Scene scene;
+        CameraPath camera_path;
+        int image_ok = 1, time_ok = 1, max_delta = 0, differing = 0;
+
+        pose_name(name, sizeof(name), pose);
+        snprintf(path, sizeof(path), "%s/%s.ppm", dir, name);
+        if(!scene_load_preset(&scene, objects, palette, pose->scene)) {
+            printf("%-16s could not load scene\n", name);
+            failures++;
+            continue;
+        }
+        scene_preset_camera_path(&camera_path, pose->scene);
+        double ms = render_pose(&scene, &camera_path, camera, pose->t, frames);
+        camerapath_free(&camera_path);
+
+        if(mode == MODE_UPDATE) {
+            if(!image_write_ppm(path, frame.pixels, WINDOW_WIDTH, WINDOW_HEIGHT)) {
+                failures++;
+            }
+        } else if(!image_read_ppm(path, reference, WINDOW_WIDTH, WINDOW_HEIGHT)) {
+            image_ok = 0;
+        } else {
+            differing = compare_images(frame.pixels, tolerance, &max_delta);
+            image_ok  = differing <= (int) (max_diff * ALL_PIXELS);
+            if(!image_ok && diff_dir != NULL) {
+                char diff_path[512];
+                snprintf(diff_path, sizeof(diff_path), "%s/%s_diff.ppm", diff_dir, name);
+                image_write_ppm(diff_path, diff, WINDOW_WIDTH, WINDOW_HEIGHT);
+            }
+        }
+
+        Baseline* baseline = find_baseline(name);
+        double baseline_ms = (baseline != NULL) ? baseline->ms : 0;
+        if(mode == MODE_CHECK && baseline != NULL) {
+            time_ok = ms <= baseline_ms * (1.0 + margin / 100.0);
+        }
+        if(mode != MODE_CHECK) {
+            set_baseline(name, ms);
+        }
+
+        printf("%-16s %8d %10d %10.4f %10.4f  %s%s%s\n", name, max_delta, differing, ms, baseline_ms,
+               (image_ok && time_ok) ? "ok" : "FAIL",
+               image_ok ? "" : " (image)", time_ok ? "" : " (slower than baseline)");
+        if(!image_ok || !time_ok) {
+            failures++;
+        }
+    }
+
+    if(mode != MODE_CHECK && !save_baselines(baseline_path)) {
+        failures++;
+    }
+    free(camera);
+    printf("%d of %d poses failed\n", failures, AMOUNT_OF_POSES);
+    return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,353 @@
+// Micro-benchmark of the math kernels in model/math.
+//
+// Every kernel is run over a large array of deterministic pseudo random inputs,
+// warmed up once and then timed over several repetitions (median is reported).
+// Accuracy is measured against double precision reference versions, and the
+// Carmack d_sqrt is compared with sqrtf and 1/sqrtf. Transforming a whole
+// object by one matrix is timed for the AoS vector_matrix_mul loop and for
+// each SoA vertices_transform kernel the CPU supports. Batch vertices_length
+// and vertices_normalize are timed per kernel in fast and exact precision.
+//
+// Build and run from sdl2-c:
+//   clang -O2 -o bench/mathbench bench/mathbench.c src/model/math/*.c -lm
+//   bench/mathbench [--count N] [--repeat N] [--format csv|json]
+
+#include "../src/model/math/matrix.h"
+#include "../src/model/math/vector.h"
+#include "../src/model/math/vertices.h"
+#include "../src/integration/timer.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FORMAT_CSV  0
+#define FORMAT_JSON 1
+
+// Result of a single kernel.
+typedef struct {
+    const char* kernel;
+    double ns_per_op,
+           max_abs_error,
+           max_rel_error;
+}MathResult;
+
+// Working data shared by all kernels.
+static struct {
+    int     count;
+    float*  scalars;
+    Vector* vectors;
+    Vector* up;
+    Matrix* matrices;
+    Matrix* matrices_b;
+    float*  out_scalars;
+    Vector* out_vectors;
+    Matrix* out_matrices;
+    Vertices soa_vectors;       // vectors as structure of arrays
+    Vertices soa_out;
+    float*   soa_lengths;       // vertices_length output, soa_vectors.capacity floats
+    int      precision;         // precision of batch kernels being timed
+}data;
+
+static volatile float sink;     // keeps results alive
+
+// Deterministic pseudo random float in [min, max].
+static float random_float(unsigned int* seed, float min, float max) {
+    *seed = (*seed * 1664525u) + 1013904223u;
+    return min + (max - min) * ((*seed >> 8) / 16777216.0f);
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+/* Kernels, each runs once over all inputs. */
+
+static void kernel_d_sqrt(void) {
+    for(int i = 0; i < data.count; i++) { data.out_scalars[i] = d_sqrt(data.scalars[i]); }
+}
+static void kernel_sqrtf(void) {
+    for(int i = 0; i < data.count; i++) { data.out_scalars[i] = sqrtf(data.scalars[i]); }
+}
+static void kernel_rsqrtf(void) {
+    for(int i = 0; i < data.count; i++) { data.out_scalars[i] = 1.0f / sqrtf(data.scalars[i]); }
+}
+static void kernel_vector_length(void) {
+    for(int i = 0; i < data.count; i++) { data.out_scalars[i] = vector_length(&data.vectors[i]); }
+}
+static void kernel_vector_normalize(void) {
+    for(int i = 0; i < data.count; i++) { data.out_vectors[i] = vector_normalize(&data.vectors[i]); }
+}
+static void kernel_vector_matrix_mul(void) {
+    for(int i = 0; i < data.count; i++) { data.out_vectors[i] = vector_matrix_mul(&data.vectors[i], &data.matrices[i]); }
+}
+// Whole object by one matrix (matrices[0]), as done by object_view_transformation.
+static void kernel_object_aos(void) {
+    for(int i = 0; i < data.count; i++) { data.out_vectors[i] = vector_matrix_mul(&data.vectors[i], &data.matrices[0]); }
+}
+static void kernel_object_soa(void) {
+    vertices_transform(&data.soa_vectors, &data.soa_out, &data.matrices[0]);
+}
+static void kernel_batch_length(void) {
+    vertices_length(&data.soa_vectors, data.soa_lengths, data.precision);
+}
+static void kernel_batch_normalize(void) {
+    vertices_normalize(&data.soa_vectors, &data.soa_out, data.precision);
+}
+static void kernel_matrix_mul(void) {
+    for(int i = 0; i < data.count; i++) { data.out_matrices[i] = matrix_mul(&data.matrices[i], &data.matrices_b[i]); }
+}
+static void kernel_matrix_point_at(void) {
+    for(int i = 0; i < data.count; i++) {
+        data.out_matrices[i] = matrix_point_at(&data.up[i], &data.vectors[i], &data.up[i]);
+    }
+}
+static void kernel_matrix_quick_lookat_inverse(void) {
+    for(int i = 0; i < data.count; i++) { data.out_matrices[i] = matrix_quick_lookat_inverse(&data.matrices[i]); }
+}
+
+/* Accuracy checks, run on the output of the kernel. */
+
+static void update_error(MathResult* result, double value, double reference) {
+    double abs_error = fabs(value - reference);
+    double rel_error = (reference != 0) ? abs_error / fabs(reference) : abs_error;
+    if(abs_error > result->max_abs_error) { result->max_abs_error = abs_error; }
+    if(rel_error > result->max_rel_error) { result->max_rel_error = rel_error; }
+}
+
+static void check_sqrt(MathResult* result) {
+    for(int i = 0; i < data.count; i++) { update_error(result, data.out_scalars[i], sqrt((double) data.scalars[i])); }
+}
+static void check_rsqrt(MathResult* result) {
+    for(int i = 0; i < data.count; i++) { update_error(result, data.out_scalars[i], 1.0 / sqrt((double) data.scalars[i])); }
+}
+static void check_vector_length(MathResult* result) {
+    for(int i = 0; i < data.count; i++) {
+        const Vector* v = &data.vectors[i];
+        update_error(result, data.out_scalars[i], sqrt((double) v->x*v->x + (double) v->y*v->y + (double) v->z*v->z));
+    }
+}
+static void check_vector_normalize(MathResult* result) {
+    for(int i = 0; i < data.count; i++) {
+        const Vector* n = &data.out_vectors[i];
+        update_error(result, sqrt((double) n->x*n->x + (double) n->y*n->y + (double) n->z*n->z), 1.0);
+    }
+}
+static void check_vector_matrix_mul(MathResult* result) {
+    for(int i = 0; i < data.count; i++) {
+        const Vector* v = &data.vectors[i];
+        const Matrix* m = &data.matrices[i];
+        for(int col = 0; col < 3; col++) {
+            double reference = (double) v->x * m->matrix[0][col] + (double) v->y * m->matrix[1][col] +
+                               (double) v->z * m->matrix[2][col] + m->matrix[3][col];
+            float value = (col == 0) ? data.out_vectors[i].x : (col == 1) ? data.out_vectors[i].y : data.out_vectors[i].z;
+            update_error(result, value, reference);
+        }
+    }
+}
+static void check_object_transform(MathResult* result, const Vector* out, const Vertices* soa_out) {
+    const Matrix* m = &data.matrices[0];
+    for(int i = 0; i < data.count; i++) {
+        const Vector* v = &data.vectors[i];
+        Vector value = (out != NULL) ? out[i] : vertices_get(soa_out, i);
+        for(int col = 0; col < 3; col++) {
+            double reference = (double) v->x * m->matrix[0][col] + (double) v->y * m->matrix[1][col] +
+                               (double) v->z * m->matrix[2][col] + m->matrix[3][col];
+            update_error(result, (col == 0) ? value.x : (col == 1) ? value.y : value.z, reference);
+        }
+    }
+}
+static void check_object_aos(MathResult* result) {
+    check_object_transform(result, data.out_vectors, NULL);
+}
+static void check_object_soa(MathResult* result) {
+    check_object_transform(result, NULL, &data.soa_out);
+}
+static void check_batch_length(MathResult* result) {
+    for(int i = 0; i < data.count; i++) {
+        const Vector* v = &data.vectors[i];
+        update_error(result, data.soa_lengths[i], sqrt((double) v->x*v->x + (double) v->y*v->y + (double) v->z*v->z));
+    }
+}
+static void check_batch_normalize(MathResult* result) {
+    for(int i = 0; i < data.count; i++) {
+        Vector n = vertices_get(&data.soa_out, i);
+        update_error(result, sqrt((double) n.x*n.x + (double) n.y*n.y + (double) n.z*n.z), 1.0);
+    }
+}
+static void check_matrix_mul(MathResult* result) {
+    for(int i = 0; i < data.count; i++) {
+        for(int row = 0; row < ROW; row++) {
+            for(int col = 0; col < COL; col++) {
+                double reference = 0;
+                for(int k = 0; k < COL; k++) {
+                    reference += (double) data.matrices[i].matrix[row][k] * data.matrices_b[i].matrix[k][col];
+                }
+                update_error(result, data.out_matrices[i].matrix[row][col], reference);
+            }
+        }
+    }
+}
+// point at matrix must have unit length forward axis (row 2).
+static void check_matrix_point_at(MathResult* result) {
+    for(int i = 0; i < data.count; i++) {
+        const float* f = data.out_matrices[i].matrix[2];
+        update_error(result, sqrt((double) f[0]*f[0] + (double) f[1]*f[1] + (double) f[2]*f[2]), 1.0);
+    }
+}
+// pointAt * lookAt must be identity. Inputs use arbitrary yaw, so the
+// translation row is checked for non-symmetric rotations as well.
+static void check_matrix_quick_lookat_inverse(MathResult* result) {
+    for(int i = 0; i < data.count; i++) {
+        for(int row = 0; row < ROW; row++) {
+            for(int col = 0; col < COL; col++) {
+                double value = 0;
+                for(int k = 0; k < COL; k++) {
+                    value += (double) data.matrices[i].matrix[row][k] * data.out_matrices[i].matrix[k][col];
+                }
+                update_error(result, value, (row == col) ? 1.0 : 0.0);
+            }
+        }
+    }
+}
+
+// Generates inputs. matrices are valid pointAt matrices so that they can be
+// used by matrix_quick_lookat_inverse, matrices_b are general matrices.
+static void generate_data(int count) {
+    unsigned int seed = 12345;
+    data.count        = count;
+    data.scalars      = malloc(sizeof(float)  * count);
+    data.vectors      = malloc(sizeof(Vector) * count);
+    data.up           = malloc(sizeof(Vector) * count);
+    data.matrices     = malloc(sizeof(Matrix) * count);
+    data.matrices_b   = malloc(sizeof(Matrix) * count);
+    data.out_scalars  = malloc(sizeof(float)  * count);
+    data.out_vectors  = malloc(sizeof(Vector) * count);
+    data.out_matrices = malloc(sizeof(Matrix) * count);
+    vertices_allocate(&data.soa_vectors, count);
+    vertices_allocate(&data.soa_out, count);
+    data.soa_lengths  = aligned_alloc(VERTICES_ALIGN, sizeof(float) * data.soa_vectors.capacity);
+
+    for(int i = 0; i < count; i++) {
+        data.scalars[i] = random_float(&seed, 0.001f, 10000.0f);
+        data.vectors[i] = vector_create(random_float(&seed, -100, 100),
+                                        random_float(&seed, -100, 100),
+                                        random_float(&seed, 1, 100));
+        vertices_set(&data.soa_vectors, i, &data.vectors[i]);
+        data.up[i]      = vector_create(0, 1, 0);
+
+        Vector position = vector_create(random_float(&seed, -500, 500),
+                                        random_float(&seed, -500, 500),
+                                        random_float(&seed, -500, 500));
+        Matrix rotation = matrix_create_rotation_matrix_y(random_float(&seed, -3.14f, 3.14f));
+        Vector locked_z = vector_create(0, 0, 1);
+        Vector forward  = vector_matrix_mul(&locked_z, &rotation);
+        data.matrices[i] = matrix_point_at(&position, &forward, &data.up[i]);
+
+        for(int row = 0; row < ROW; row++) {
+            for(int col = 0; col < COL; col++) {
+                data.matrices_b[i].matrix[row][col] = random_float(&seed, -2, 2);
+            }
+        }
+    }
+}
+
+// Warms up kernel once, then times it repeat times and keeps the median.
+static void run_kernel(MathResult* result, const char* name, void (*kernel)(void),
+                       void (*check)(MathResult*), int repeat) {
+    double* samples = malloc(sizeof(double) * repeat);
+
+    kernel();
+    for(int r = 0; r < repeat; r++) {
+        uint64_t start = timer_now_ns();
+        kernel();
+        samples[r] = (double) (timer_now_ns() - start) / data.count;
+    }
+    qsort(samples, repeat, sizeof(double), compare_double);
+
+    result->kernel        = name;
+    result->ns_per_op     = samples[repeat / 2];
+    result->max_abs_error = 0;
+    result->max_rel_error = 0;
+    check(result);
+    sink = data.out_scalars[0] + data.out_vectors[0].x + data.out_matrices[0].matrix[0][0];
+    free(samples);
+}
+
+int main(int arc, char* args[]) {
+    int count = 1 << 16, repeat = 15, format = FORMAT_CSV;
+    MathResult results[32];
+    char soa_names[3][40];
+    char batch_names[3][4][40];
+    const char* precision_names[2] = {"fast", "exact"};
+    int amount = 0;
+
+    for(int i = 1; i < arc; i++) {
+        if(strcmp(args[i], "--count") == 0 && i + 1 < arc)       { count  = atoi(args[++i]); }
+        else if(strcmp(args[i], "--repeat") == 0 && i + 1 < arc) { repeat = atoi(args[++i]); }
+        else if(strcmp(args[i], "--format") == 0 && i + 1 < arc) {
+            format = (strcmp(args[++i], "json") == 0) ? FORMAT_JSON : FORMAT_CSV;
+        }
+        else {
+            fprintf(stderr, "mathbench: unknown argument %s\n", args[i]);
+            return 1;
+        }
+    }
+    if(count < 1)  { count = 1; }
+    if(repeat < 1) { repeat = 1; }
+    generate_data(count);
+
+    run_kernel(&results[amount++], "d_sqrt",                      kernel_d_sqrt,                      check_sqrt,                        repeat);
+    run_kernel(&results[amount++], "sqrtf",                       kernel_sqrtf,                       check_sqrt,                        repeat);
+    run_kernel(&results[amount++], "1/sqrtf",                     kernel_rsqrtf,                      check_rsqrt,                       repeat);
+    run_kernel(&results[amount++], "vector_length",               kernel_vector_length,               check_vector_length,               repeat);
+    run_kernel(&results[amount++], "vector_normalize",            kernel_vector_normalize,            check_vector_normalize,            repeat);
+    run_kernel(&results[amount++], "vector_matrix_mul",           kernel_vector_matrix_mul,           check_vector_matrix_mul,           repeat);
+    run_kernel(&results[amount++], "object_aos",                  kernel_object_aos,                  check_object_aos,                  repeat);
+    for(int kernel = TRANSFORM_SCALAR; kernel <= TRANSFORM_AVX; kernel++) {
+        if(!vertices_kernel_supported(kernel)) {
+            continue;
+        }
+        vertices_set_kernel(kernel);
+        snprintf(soa_names[kernel], sizeof(soa_names[kernel]), "object_soa_%s", vertices_kernel_name(kernel));
+        run_kernel(&results[amount++], soa_names[kernel],         kernel_object_soa,                  check_object_soa,                  repeat);
+    }
+    for(int kernel = TRANSFORM_SCALAR; kernel <= TRANSFORM_AVX; kernel++) {
+        if(!vertices_kernel_supported(kernel)) {
+            continue;
+        }
+        vertices_set_kernel(kernel);
+        for(data.precision = PRECISION_FAST; data.precision <= PRECISION_EXACT; data.precision++) {
+            char* length_name    = batch_names[kernel][2 * data.precision];
+            char* normalize_name = batch_names[kernel][2 * data.precision + 1];
+            snprintf(length_name, 40, "batch_length_%s_%s",
+                     vertices_kernel_name(kernel), precision_names[data.precision]);
+            snprintf(normalize_name, 40, "batch_normalize_%s_%s",
+                     vertices_kernel_name(kernel), precision_names[data.precision]);
+            run_kernel(&results[amount++], length_name,           kernel_batch_length,                check_batch_length,                repeat);
+            run_kernel(&results[amount++], normalize_name,        kernel_batch_normalize,             check_batch_normalize,             repeat);
+        }
+    }
+    vertices_set_kernel(TRANSFORM_AUTO);
+    run_kernel(&results[amount++], "matrix_mul",                  kernel_matrix_mul,                  check_matrix_mul,                  repeat);
+    run_kernel(&results[amount++], "matrix_point_at",             kernel_matrix_point_at,             check_matrix_point_at,             repeat);
+    run_kernel(&results[amount++], "matrix_quick_lookat_inverse", kernel_matrix_quick_lookat_inverse, check_matrix_quick_lookat_inverse, repeat);
+
+    if(format == FORMAT_CSV) {
+        printf("kernel,count,ns_per_op,max_abs_error,max_rel_error\n");
+        for(int i = 0; i < amount; i++) {
+            printf("%s,%d,%.3f,%.3e,%.3e\n", results[i].kernel, count,
+                   results[i].ns_per_op, results[i].max_abs_error, results[i].max_rel_error);
+        }
+    } else {
+        printf("{\n  \"count\": %d,\n  \"repeat\": %d,\n  \"results\": [\n", count, repeat);
+        for(int i = 0; i < amount; i++) {
+            printf("    {\"kernel\": \"%s\", \"ns_per_op\": %.3f, \"max_abs_error\": %.3e, \"max_rel_error\": %.3e}%s\n",
+                   results[i].kernel, results[i].ns_per_op, results[i].max_abs_error, results[i].max_rel_error,
+                   (i + 1 < amount) ? "," : "");
+        }
+        printf("  ]\n}\n");
+    }
+    return 0;
+}
@@ -0,0 +1,387 @@
+// Throughput benchmark of the triangle rasterizer.
+//
+// Drives draw_triangle_3D_z directly with synthetic triangle sets, without the
+// rest of the pipeline:
+//   tiny     sub-pixel to 2 pixel triangles (mostly setup cost)
+//   mid      triangles with 16-48 pixel edges
+//   sliver   thin triangles spanning the entire screen width
+//   clipped  triangles crossing the poly_clip_* edges of the screen
+// Each set is rendered in FLAT_SHADING and GOURAUD_SHADING by the scanline
+// rasterizer with float, 16.16 fixed point and 28.4 sub-pixel stepping
+// (RASTER_FLOAT, RASTER_FIXED, RASTER_SUBPIXEL) and by the half-space rasterizer
+// (RASTER_HALFSPACE), and textured with a 64x64 texture by draw_triangle_textured
+// in every texturing mode but TEXTURE_OFF (affine, divide every 16 or 8 pixels,
+// exact) with the float and the sub-pixel spans. The z-buffer is
+// cleared before each pass (untimed), a pass is timed and the median pass
+// is reported as Mtri/s and Mpixel/s (pixels rasterized, counted once per set).
+//
+// Build and run from sdl2-c:
+//   clang -O2 -o bench/rasterbench bench/rasterbench.c src/model/object/drawtriangle.c
+//         src/model/object/drawfixed.c src/model/object/drawhalfspace.c src/model/object/hiz.c
+//         src/model/object/depth.c src/model/object/rasterstats.c src/model/object/texture.c
+//         src/model/object/drawsubpixel.c src/integration/display.c -lm
+//   bench/rasterbench [--set tiny|mid|sliver|clipped|all] [--raster scanline|halfspace|all]
+//                     [--stepping float|fixed|subpixel|all] [--texture off|affine|16|8|exact|all]
+//                     [--passes N] [--format csv|json]
+
+#include "../src/model/object/polygon.h"
+#include "../src/integration/timer.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FORMAT_CSV  0
+#define FORMAT_JSON 1
+
+#define SET_TINY        0
+#define SET_MID         1
+#define SET_SLIVER      2
+#define SET_CLIPPED     3
+#define AMOUNT_OF_SETS  4
+
+// Screen space triangle as handed to draw_triangle_3D_z, with texture
+// coordinates and 1/z for draw_triangle_textured.
+typedef struct {
+    int x[3], y[3], z[3];
+    int color[4];
+    float u[3], v[3], w[3];
+}BenchTriangle;
+
+// Result of a single set in a single shading mode.
+typedef struct {
+    int      set;
+    int      mode;
+    int      algorithm;
+    int      stepping;
+    int      texture;           // texturing, TEXTURE_OFF for the untextured rasterizers
+    int      triangles;
+    uint64_t pixels;            // pixels rasterized per pass
+    double   ms_per_pass,
+             mtri_per_sec,
+             mpixel_per_sec;
+}RasterResult;
+
+static const char* set_names[AMOUNT_OF_SETS] = { "tiny", "mid", "sliver", "clipped" };
+static const int   set_sizes[AMOUNT_OF_SETS] = { 65536, 8192, 512, 4096 };
+
+static uint32_t pixelmap[ALL_PIXELS];
+static int      z_buffer[ALL_PIXELS];
+static Texture* texture;
+
+// Deterministic pseudo random int in [min, max].
+static int random_int(unsigned int* seed, int min, int max) {
+    *seed = (*seed * 1664525u) + 1013904223u;
+    return min + (int) ((*seed >> 8) % (unsigned int) (max - min + 1));
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+// Fills triangles with set, same seed always gives same triangles.
+static void generate_set(BenchTriangle* triangles, int amount, int set) {
+    unsigned int seed = 4242 + set;
+    for(int i = 0; i < amount; i++) {
+        BenchTriangle* t = &triangles[i];
+        int cx, cy, size;
+
+        switch(set) {
+        case SET_TINY:
+            cx = random_int(&seed, 0, WINDOW_WIDTH - 3);
+            cy = random_int(&seed, 0, WINDOW_HEIGHT - 3);
+            for(int v = 0; v < 3; v++) {
+                t->x[v] = cx + random_int(&seed, 0, 2);
+                t->y[v] = cy + random_int(&seed, 0, 2);
+            }
+            break;
+        case SET_MID:
+            size = random_int(&seed, 16, 48);
+            cx = random_int(&seed, 0, WINDOW_WIDTH - 1 - size);
+            cy = random_int(&seed, 0, WINDOW_HEIGHT - 1 - size);
+            for(int v = 0; v < 3; v++) {
+                t->x[v] = cx + random_int(&seed, 0, size);
+                t->y[v] = cy + random_int(&seed, 0, size);
+            }
+            break;
+        case SET_SLIVER:
+            cy = random_int(&seed, 0, WINDOW_HEIGHT - 1);
+            t->x[0] = 0;
+            t->y[0] = cy;
+            t->x[1] = WINDOW_WIDTH - 1;
+            t->y[1] = random_int(&seed, 0, WINDOW_HEIGHT - 5);
+            t->x[2] = WINDOW_WIDTH - 1;
+            t->y[2] = t->y[1] + random_int(&seed, 1, 4);
+            break;
+        default:
+            // center on a random screen edge, vertices reach well past it
+            size = random_int(&seed, 40, 160);
+            cx = random_int(&seed, 0, WINDOW_WIDTH - 1);
+            cy = random_int(&seed, 0, WINDOW_HEIGHT - 1);
+            switch(random_int(&seed, 0, 3)) {
+            case 0: cx = poly_clip_min_x; break;
+            case 1: cx = poly_clip_max_x; break;
+            case 2: cy = poly_clip_min_y; break;
+            default: cy = poly_clip_max_y; break;
+            }
+            for(int v = 0; v < 3; v++) {
+                t->x[v] = cx + random_int(&seed, -size, size);
+                t->y[v] = cy + random_int(&seed, -size, size);
+            }
+            break;
+        }
+        for(int v = 0; v < 3; v++) {
+            int shade = random_int(&seed, 32, 255);
+            t->z[v] = random_int(&seed, (int) CLIP_NEAR_Z, (int) CLIP_FAR_Z);
+            t->color[v] = _RGB32BIT(0, shade, shade, shade);
+            t->u[v] = random_int(&seed, 0, 256) / 128.0f;
+            t->v[v] = random_int(&seed, 0, 256) / 128.0f;
+            t->w[v] = 1.0f / t->z[v];
+        }
+        t->color[3] = t->color[0];
+    }
+}
+
+// Creates the 64x64 checkerboard texture of the textured passes.
+static Texture* create_texture(void) {
+    static uint32_t texels[64 * 64];
+    for(int v = 0; v < 64; v++) {
+        for(int u = 0; u < 64; u++) {
+            int shade = (((u >> 3) ^ (v >> 3)) & 1) ? 224 : 64;
+            texels[(v * 64) + u] = _RGB32BIT(0, shade, (shade + u) & 0xFF, (shade + v) & 0xFF);
+        }
+    }
+    return texture_create(texels, 64, 64);
+}
+
+static void clear_buffers(void) {
+    for(int i = 0; i < ALL_PIXELS; i++) {
+        z_buffer[i] = INT_MAX;
+    }
+}
+
+static void draw_triangle(BenchTriangle* t, int mode) {
+    if(raster_texture() != TEXTURE_OFF) {
+        RasterTriangle r;
+        for(int v = 0; v < 3; v++) {
+            r.x[v] = t->x[v];
+            r.y[v] = t->y[v];
+            r.sx[v] = subpixel_from_pixel(t->x[v]);
+            r.sy[v] = subpixel_from_pixel(t->y[v]);
+            r.z[v] = t->z[v];
+            r.color[v] = t->color[v];
+            r.u[v] = t->u[v];
+            r.v[v] = t->v[v];
+            r.w[v] = t->w[v];
+        }
+        r.color[3] = t->color[3];
+        r.mode     = mode;
+        r.texture  = texture;
+        draw_triangle_textured(&r, pixelmap, z_buffer);
+        return;
+    }
+    draw_triangle_3D_z(t->x[0], t->y[0], t->z[0],
+                       t->x[1], t->y[1], t->z[1],
+                       t->x[2], t->y[2], t->z[2],
+                       t->color, pixelmap, z_buffer, mode);
+}
+
+// Counts pixels rasterized by set, i.e the sum of the coverage of each
+// triangle drawn alone into an empty z-buffer. Only the bounding box of
+// each triangle is scanned and reset afterwards.
+static uint64_t count_pixels(BenchTriangle* triangles, int amount, int mode) {
+    uint64_t pixels = 0;
+    clear_buffers();
+    for(int i = 0; i < amount; i++) {
+        BenchTriangle* t = &triangles[i];
+        int min_x = t->x[0], max_x = t->x[0], min_y = t->y[0], max_y = t->y[0];
+        for(int v = 1; v < 3; v++) {
+            if(t->x[v] < min_x) { min_x = t->x[v]; }
+            if(t->x[v] > max_x) { max_x = t->x[v]; }
+            if(t->y[v] < min_y) { min_y = t->y[v]; }
+            if(t->y[v] > max_y) { max_y = t->y[v]; }
+        }
+        if(min_x < poly_clip_min_x) { min_x = poly_clip_min_x; }
+        if(min_y < poly_clip_min_y) { min_y = poly_clip_min_y; }
+        if(max_x > poly_clip_max_x) { max_x = poly_clip_max_x; }
+        if(max_y > poly_clip_max_y) { max_y = poly_clip_max_y; }
+
+        draw_triangle(t, mode);
+        for(int y = min_y; y <= max_y; y++) {
+            for(int x = min_x; x <= max_x; x++) {
+                if(z_buffer[PIXEL(x, y)] != INT_MAX) {
+                    pixels++;
+                    z_buffer[PIXEL(x, y)] = INT_MAX;
+                }
+            }
+        }
+    }
+    return pixels;
+}
+
+// Renders set passes times in mode with algorithm, stepping and texturing and
+// keeps the median pass.
+static void bench_set(RasterResult* result, BenchTriangle* triangles, int set, int mode,
+                      int algorithm, int stepping, int texturing, int passes) {
+    int amount = set_sizes[set];
+    uint64_t* samples = malloc(sizeof(uint64_t) * passes);
+
+    raster_set_algorithm(algorithm);
+    raster_set_stepping(stepping);
+    raster_set_texture(texturing);
+    result->set       = set;
+    result->mode      = mode;
+    result->algorithm = algorithm;
+    result->stepping  = stepping;
+    result->texture   = texturing;
+    result->triangles = amount;
+    result->pixels    = count_pixels(triangles, amount, mode);
+
+    // warmup
+    clear_buffers();
+    for(int i = 0; i < amount; i++) {
+        draw_triangle(&triangles[i], mode);
+    }
+
+    for(int pass = 0; pass < passes; pass++) {
+        clear_buffers();
+        uint64_t start = timer_now_ns();
+        for(int i = 0; i < amount; i++) {
+            draw_triangle(&triangles[i], mode);
+        }
+        samples[pass] = timer_now_ns() - start;
+    }
+    qsort(samples, passes, sizeof(uint64_t), compare_u64);
+
+    double seconds = samples[passes / 2] / 1e9;
+    result->ms_per_pass    = timer_ns_to_ms(samples[passes / 2]);
+    result->mtri_per_sec   = (seconds > 0) ? amount / seconds / 1e6 : 0;
+    result->mpixel_per_sec = (seconds > 0) ? result->pixels / seconds / 1e6 : 0;
+    free(samples);
+}
+
+int main(int arc, char* args[]) {
+    int set = -1, algorithm = -1, stepping = -1, texturing = -1, passes = 21, format = FORMAT_CSV;
+    RasterResult results[AMOUNT_OF_SETS * 16];
+    int amount = 0;
+
+    for(int i = 1; i < arc; i++) {
+        if(strcmp(args[i], "--set") == 0 && i + 1 < arc) {
+            set = -2;
+            i++;
+            for(int s = 0; s < AMOUNT_OF_SETS; s++) {
+                if(strcmp(args[i], set_names[s]) == 0) { set = s; }
+            }
+            if(strcmp(args[i], "all") == 0) { set = -1; }
+            if(set == -2) {
+                fprintf(stderr, "rasterbench: unknown set %s\n", args[i]);
+                return 1;
+            }
+        }
+        else if(strcmp(args[i], "--raster") == 0 && i + 1 < arc) {
+            i++;
+            if(strcmp(args[i], "all") == 0)                                          { algorithm = -1; }
+            else if(strcmp(args[i], raster_algorithm_name(RASTER_SCANLINE)) == 0)  { algorithm = RASTER_SCANLINE; }
+            else if(strcmp(args[i], raster_algorithm_name(RASTER_HALFSPACE)) == 0) { algorithm = RASTER_HALFSPACE; }
+            else {
+                fprintf(stderr, "rasterbench: unknown raster %s\n", args[i]);
+                return 1;
+            }
+        }
+        else if(strcmp(args[i], "--stepping") == 0 && i + 1 < arc) {
+            i++;
+            stepping = -2;
+            for(int mode = RASTER_FLOAT; mode <= RASTER_SUBPIXEL; mode++) {
+                if(strcmp(args[i], raster_stepping_name(mode)) == 0) { stepping = mode; }
+            }
+            if(strcmp(args[i], "all") == 0) { stepping = -1; }
+            if(stepping == -2) {
+                fprintf(stderr, "rasterbench: unknown stepping %s\n", args[i]);
+                return 1;
+            }
+        }
+        else if(strcmp(args[i], "--texture") == 0 && i + 1 < arc) {
+            i++;
+            texturing = -2;
+            for(int mode = TEXTURE_OFF; mode <= TEXTURE_EXACT; mode++) {
+                if(strcmp(args[i], raster_texture_name(mode)) == 0) { texturing = mode; }
+            }
+            if(strcmp(args[i], "all") == 0) { texturing = -1; }
+            if(texturing == -2) {
+                fprintf(stderr, "rasterbench: unknown texture %s\n", args[i]);
+                return 1;
+            }
+        }
+        else if(strcmp(args[i], "--passes") == 0 && i + 1 < arc) { passes = atoi(args[++i]); }
+        else if(strcmp(args[i], "--format") == 0 && i + 1 < arc) {
+            format = (strcmp(args[++i], "json") == 0) ? FORMAT_JSON : FORMAT_CSV;
+        }
+        else {
+            fprintf(stderr, "rasterbench: unknown argument %s\n", args[i]);
+            return 1;
+        }
+    }
+    if(passes < 1) { passes = 1; }
+    if((texture = create_texture()) == NULL) {
+        return 1;
+    }
+
+    for(int s = 0; s < AMOUNT_OF_SETS; s++) {
+        if(set >= 0 && s != set) {
+            continue;
+        }
+        BenchTriangle* triangles = malloc(sizeof(BenchTriangle) * set_sizes[s]);
+        generate_set(triangles, set_sizes[s], s);
+        for(int algo = RASTER_SCANLINE; algo <= RASTER_HALFSPACE; algo++) {
+            for(int step = RASTER_FLOAT; step <= RASTER_SUBPIXEL; step++) {
+                // stepping only applies to the scanline rasterizer
+                if((algorithm >= 0 && algo != algorithm) || (stepping >= 0 && step != stepping) ||
+                   (texturing > TEXTURE_OFF) || (algo == RASTER_HALFSPACE && step != RASTER_FLOAT)) {
+                    continue;
+                }
+                bench_set(&results[amount++], triangles, s, FLAT_SHADING, algo, step, TEXTURE_OFF, passes);
+                bench_set(&results[amount++], triangles, s, GOURAUD_SHADING, algo, step, TEXTURE_OFF, passes);
+            }
+        }
+        // the textured filler is always scanline, its spans are the float ones
+        // (fixed stepping does not change them) or the sub-pixel ones, lit by the flat color
+        static const int textured_steppings[2] = { RASTER_FLOAT, RASTER_SUBPIXEL };
+        for(int index = 0; index < 2; index++) {
+            int step = textured_steppings[index];
+            for(int mode = TEXTURE_AFFINE; mode <= TEXTURE_EXACT; mode++) {
+                if((texturing >= 0 && mode != texturing) || (algorithm >= 0 && algorithm != RASTER_SCANLINE) ||
+                   (stepping >= 0 && stepping != step)) {
+                    continue;
+                }
+                bench_set(&results[amount++], triangles, s, FLAT_SHADING, RASTER_SCANLINE, step, mode, passes);
+            }
+        }
+        free(triangles);
+    }
+
+    if(format == FORMAT_CSV) {
+        printf("set,mode,raster,stepping,texture,triangles,pixels,ms_per_pass,mtri_per_sec,mpixel_per_sec\n");
+        for(int i = 0; i < amount; i++) {
+            printf("%s,%s,%s,%s,%s,%d,%llu,%.4f,%.3f,%.3f\n", set_names[results[i].set],
+                   (results[i].mode == FLAT_SHADING) ? "flat" : "gouraud", raster_algorithm_name(results[i].algorithm),
+                   raster_stepping_name(results[i].stepping), raster_texture_name(results[i].texture), results[i].triangles,
+                   (unsigned long long) results[i].pixels, results[i].ms_per_pass,
+                   results[i].mtri_per_sec, results[i].mpixel_per_sec);
+        }
+    } else {
+        printf("{\n  \"passes\": %d,\n  \"results\": [\n", passes);
+        for(int i = 0; i < amount; i++) {
+            printf("    {\"set\": \"%s\", \"mode\": \"%s\", \"raster\": \"%s\", \"stepping\": \"%s\", \"texture\": \"%s\", "
+                   "\"triangles\": %d, \"pixels\": %llu, \"ms_per_pass\": %.4f, \"mtri_per_sec\": %.3f, "
+                   "\"mpixel_per_sec\": %.3f}%s\n",
+                   set_names[results[i].set], (results[i].mode == FLAT_SHADING) ? "flat" : "gouraud",
+                   raster_algorithm_name(results[i].algorithm), raster_stepping_name(results[i].stepping),
+                   raster_texture_name(results[i].texture), results[i].triangles, (unsigned long long) results[i].pixels, results[i].ms_per_pass,
+                   results[i].mtri_per_sec, results[i].mpixel_per_sec, (i + 1 < amount) ? "," : "");
+        }
+        printf("  ]\n}\n");
+    }
+    texture_free(texture);
+    return 0;
+}
@@ -0,0 +1,227 @@
+// Replays captured polygon lists straight into the rasterizer.
+//
+// Reads a frame capture (written by main --capture file), keeps all frames in
+// memory and feeds each of them repeat times into draw_poly_list_z. Only the
+// rasterizer is timed, the buffers are cleared before each run (untimed, with
+// epoch clears the tiles are wiped inside the timed draw as in the engine).
+// With --sort every frame is sorted once after loading, outside of the timing.
+// Reports the median time and triangles of each frame plus a total row, as
+// CSV or JSON. With --dump the last replayed frame is written as a PPM image.
+//
+// Build and run from sdl2-c:
+//   clang -O2 -o bench/replay bench/replay.c src/model/object/polygon.c src/model/object/drawtriangle.c
+//         src/model/object/drawfixed.c src/model/object/drawhalfspace.c src/model/object/drawtiles.c
+//         src/model/object/drawdeferred.c src/model/object/drawspans.c src/model/object/hiz.c
+//         src/model/object/depth.c src/model/object/rasterstats.c src/model/object/texture.c
+//         src/model/object/drawsubpixel.c src/integration/display.c src/integration/capture.c src/integration/image.c -lm -pthread
+//   bench/replay capture.bin [--repeat N] [--raster scanline|halfspace] [--stepping float|fixed|subpixel]
+//                            [--threads N] [--hiz] [--clear full|epoch]
+//                            [--depth linear|16|24|32|float] [--sort none|front-to-back|back-to-front]
+//                            [--shading forward|deferred] [--hsr zbuffer|sbuffer] [--format csv|json]
+//                            [--dump frame.ppm]
+
+#include "../src/integration/capture.h"
+#include "../src/integration/image.h"
+#include "../src/integration/timer.h"
+#include "../src/model/object/polygon.h"
+#include "../src/model/object/hiz.h"
+#include "../src/model/object/depth.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FORMAT_CSV  0
+#define FORMAT_JSON 1
+
+// Captured frame, storage holds exactly num_polys_frame facets.
+typedef struct {
+    int     num_polys_frame;
+    int     triangles;
+    facet*  world_poly_storage;
+    facet** world_polys;
+    double  median_ms;
+}ReplayFrame;
+
+static uint32_t pixelmap[ALL_PIXELS];
+static void*    z_buffer;       // sized for the depth format (depth_bytes)
+static facet    read_storage[MAX_POLYS_PER_FRAME];
+static facet*   read_polys[MAX_POLYS_PER_FRAME];
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+// Reads every frame of capture into frames, returns amount of frames or -1.
+static int load_frames(const char* filename, ReplayFrame** frames) {
+    FILE* fp = capture_open(filename);
+    int amount = 0, capacity = 0;
+    int num_polys_frame;
+
+    if(fp == NULL) {
+        return -1;
+    }
+    *frames = NULL;
+    while(capture_read_frame(fp, read_storage, read_polys, &num_polys_frame)) {
+        if(amount == capacity) {
+            capacity = (capacity == 0) ? 64 : capacity * 2;
+            *frames = realloc(*frames, sizeof(ReplayFrame) * capacity);
+        }
+        ReplayFrame* frame = &(*frames)[amount++];
+        frame->num_polys_frame    = num_polys_frame;
+        frame->triangles          = 0;
+        frame->world_poly_storage = malloc(sizeof(facet) * (num_polys_frame + 1));
+        frame->world_polys        = malloc(sizeof(facet*) * (num_polys_frame + 1));
+        for(int curr_poly = 0; curr_poly < num_polys_frame; curr_poly++) {
+            frame->world_poly_storage[curr_poly] = *read_polys[curr_poly];
+            frame->world_polys[curr_poly]        = &frame->world_poly_storage[curr_poly];
+            frame->triangles += read_polys[curr_poly]->num_points - 2;
+        }
+        sort_poly_list(frame->world_polys, num_polys_frame);
+    }
+    fclose(fp);
+    return amount;
+}
+
+// Rasterizes frame repeat times and keeps the median.
+static void replay_frame(ReplayFrame* frame, uint64_t* samples, int repeat) {
+    for(int r = 0; r < repeat; r++) {
+        buffers_clear(pixelmap, z_buffer);
+        uint64_t start = timer_now_ns();
+        draw_poly_list_z(frame->world_polys, &frame->num_polys_frame, pixelmap, z_buffer);
+        samples[r] = timer_now_ns() - start;
+        buffers_resolve();
+    }
+    qsort(samples, repeat, sizeof(uint64_t), compare_u64);
+    frame->median_ms = timer_ns_to_ms(samples[repeat / 2]);
+}
+
+int main(int arc, char* args[]) {
+    const char* filename = NULL;
+    const char* dump_path = NULL;
+    int repeat = 50, format = FORMAT_CSV, mode;
+    ReplayFrame* frames;
+
+    for(int i = 1; i < arc; i++) {
+        if(strcmp(args[i], "--repeat") == 0 && i + 1 < arc)      { repeat = atoi(args[++i]); }
+        else if(strcmp(args[i], "--dump") == 0 && i + 1 < arc)   { dump_path = args[++i]; }
+        else if(strcmp(args[i], "--stepping") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], RASTER_FLOAT, RASTER_SUBPIXEL, raster_stepping_name)) < 0) {
+                fprintf(stderr, "replay: unknown --stepping value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_stepping(mode);
+        }
+        else if(strcmp(args[i], "--raster") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], RASTER_SCANLINE, RASTER_HALFSPACE, raster_algorithm_name)) < 0) {
+                fprintf(stderr, "replay: unknown --raster value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_algorithm(mode);
+        }
+        else if(strcmp(args[i], "--threads") == 0 && i + 1 < arc) { raster_set_threads(atoi(args[++i])); }
+        else if(strcmp(args[i], "--hiz") == 0)                   { raster_set_hiz(1); }
+        else if(strcmp(args[i], "--clear") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], CLEAR_FULL, CLEAR_EPOCH, raster_clear_name)) < 0) {
+                fprintf(stderr, "replay: unknown --clear value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_clear(mode);
+        }
+        else if(strcmp(args[i], "--depth") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], DEPTH_LINEAR, DEPTH_FORMATS - 1, depth_format_name)) < 0) {
+                fprintf(stderr, "replay: unknown --depth value %s\n", args[i]);
+                return 1;
+            }
+            depth_set_format(mode);
+        }
+        else if(strcmp(args[i], "--sort") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], POLY_SORT_NONE, POLY_SORT_BACK_TO_FRONT, poly_sort_name)) < 0) {
+                fprintf(stderr, "replay: unknown --sort value %s\n", args[i]);
+                return 1;
+            }
+            poly_set_sort(mode);
+        }
+        else if(strcmp(args[i], "--shading") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], SHADE_FORWARD, SHADE_DEFERRED, raster_shading_name)) < 0) {
+                fprintf(stderr, "replay: unknown --shading value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_shading(mode);
+        }
+        else if(strcmp(args[i], "--hsr") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], HSR_ZBUFFER, HSR_SBUFFER, raster_hsr_name)) < 0) {
+                fprintf(stderr, "replay: unknown --hsr value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_hsr(mode);
+        }
+        else if(strcmp(args[i], "--format") == 0 && i + 1 < arc) {
+            format = (strcmp(args[++i], "json") == 0) ? FORMAT_JSON : FORMAT_CSV;
+        }
+        else if(args[i][0] != '-' && filename == NULL)            { filename = args[i]; }
+        else {
+            fprintf(stderr, "replay: unknown argument %s\n", args[i]);
+            return 1;
+        }
+    }
+    if(filename == NULL) {
+        fprintf(stderr, "usage: replay capture.bin [--repeat N] [--raster scanline|halfspace] "
+                        "[--stepping float|fixed|subpixel] [--threads N] [--hiz] [--clear full|epoch] "
+                        "[--depth linear|16|24|32|float] [--sort none|front-to-back|back-to-front] "
+                        "[--shading forward|deferred] [--hsr zbuffer|sbuffer] [--format csv|json] "
+                        "[--dump frame.ppm]\n");
+        return 1;
+    }
+    if(repeat < 1) { repeat = 1; }
+    if((z_buffer = malloc((size_t) ALL_PIXELS * depth_bytes(depth_format()))) == NULL) {
+        fprintf(stderr, "replay: could not allocate z-buffer\n");
+        return 1;
+    }
+
+    int amount = load_frames(filename, &frames);
+    if(amount <= 0) {
+        fprintf(stderr, "replay: no frames in %s\n", filename);
+        return 1;
+    }
+
+    uint64_t* samples = malloc(sizeof(uint64_t) * repeat);
+    double total_ms = 0;
+    long long total_triangles = 0;
+    for(int f = 0; f < amount; f++) {
+        replay_frame(&frames[f], samples, repeat);
+        total_ms        += frames[f].median_ms;
+        total_triangles += frames[f].triangles;
+    }
+    free(samples);
+
+    double triangles_per_sec = (total_ms > 0) ? total_triangles / (total_ms / 1000.0) : 0;
+    if(format == FORMAT_CSV) {
+        printf("frame,polys,triangles,median_ms\n");
+        for(int f = 0; f < amount; f++) {
+            printf("%d,%d,%d,%.4f\n", f, frames[f].num_polys_frame, frames[f].triangles, frames[f].median_ms);
+        }
+        printf("total,%d,%lld,%.4f\n", amount, total_triangles, total_ms);
+        printf("# %.0f triangles/s over %d frames x %d runs\n", triangles_per_sec, amount, repeat);
+    } else {
+        printf("{\n  \"capture\": \"%s\",\n  \"repeat\": %d,\n  \"frames\": [\n", filename, repeat);
+        for(int f = 0; f < amount; f++) {
+            printf("    {\"polys\": %d, \"triangles\": %d, \"median_ms\": %.4f}%s\n",
+                   frames[f].num_polys_frame, frames[f].triangles, frames[f].median_ms,
+                   (f + 1 < amount) ? "," : "");
+        }
+        printf("  ],\n  \"total_ms\": %.4f,\n  \"triangles\": %lld,\n  \"triangles_per_sec\": %.0f\n}\n",
+               total_ms, total_triangles, triangles_per_sec);
+    }
+
+    if(dump_path != NULL) {
+        image_write_ppm(dump_path, pixelmap, WINDOW_WIDTH, WINDOW_HEIGHT);
+    }
+    for(int f = 0; f < amount; f++) {
+        free(frames[f].world_poly_storage);
+        free(frames[f].world_polys);
+    }
+    free(frames);
+    free(z_buffer);
+    return 0;
+}
@@ -1,34 +1,31 @@
 #include "../integration/plgreader.h"
-#include "../integration/io.h"
+#include "../integration/backend.h"
+#include "../integration/profiler.h"
+#include "../integration/capture.h"
 #include "../model/object/polygon.h"
+#include "../model/object/rasterstats.h"
+#include "../model/object/hiz.h"
+#include "../model/object/depth.h"
 #include "../model/light/rgba.h"
 #include "../model/camera.h"
+#include "../model/pipeline.h"
+#include "../model/camerapath.h"
 #include "../model/global.h"
-#include <SDL2/SDL.h>
 #include <stdint.h>
 #include <stdio.h>
-#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 
 // Static State structure.
-// Holds a very simple SDL component structure for window, texture and renderer.
-// Also contains pixelmap of entire screen (creating a first quadrant screen).
+// Holds the display backend (SDL window or headless) that frames are presented to.
 static struct {
-    SDL_Window *window;
-    SDL_Texture *texture;
-    SDL_Renderer *renderer;
-    uint32_t pixels  [WINDOW_WIDTH * WINDOW_HEIGHT];
-    uint32_t z_buffer[WINDOW_WIDTH * WINDOW_HEIGHT];
+    Backend* backend;
     bool quit;
     Camera* camera;
-    IO* io; 
 }state;
 
-// Polygon i.e facet list containing all faces of all objects
-// world_polys is pointer for real world_poly_storage.
-int num_polys_frame = 0;
-facet* world_polys[MAX_POLYS_PER_FRAME];
-facet world_poly_storage[MAX_POLYS_PER_FRAME];
-int z_buffer[WINDOW_WIDTH * WINDOW_HEIGHT]; 
+// Frame that the pipeline renders into (pixelmap, z-buffer and polygon list).
+static Frame frame;
 
 RGBA palette[256];
 //Vector source = {-0.913913,0.389759,-0.113369};
@@ -39,132 +36,209 @@ float ambient_light = 6.0f;
 // List of objects loaded in from PLG files.
 Object test_objects[MAX_AMOUNT_OF_OBJECTS];
 const int amount_of_objects = 1;
+static Scene scene;
 
-// Initialize camera, io and all external objects.
+// Initialize camera and all external objects.
 static inline void initialize_state() {
     Vector startpos = vector_create(0, 0, 0);
     state.camera    = camera_init(&startpos);
-    state.io        = io_create(&state.quit, state.camera);
         
     // PLG_Load_Object(&test_objects[0], "src/assets/cube.plg", 1);
     OBJ_Load_Object(&test_objects[0], "src/assets/mountains.obj", 1);
     for(int index = 0; index < amount_of_objects; index++) {
         // PLG_Load_Object(&test_objects[index], "src/assets/cube.plg", 1);
-        test_objects[index].world_pos.x=-200 + (index%4)*100;
-        test_objects[index].world_pos.y=0;
-        test_objects[index].world_pos.z=200 + 300*(index>>2);
+        object_position(&test_objects[index], -200 + (index%4)*100, 0, 200 + 300*(index>>2));
         //test_objects[index].polys[0].two_sided = 1;
     }  
-}
 
-// A single instance or iteration of entire rendering process
-// that is repeated continously throughout the program:
-//    
-// Each object is firstly culled to determine if it is even inside viewing window.
-// Convert each object to world coordinates (sectors are already in world space).
-// Shade and remove backfaces, ignore the backface part for now.
-// Convert world coordinates into camera coordinates
-// clip the object polygons against viewing volume.
-// generate polygon list.
-// clip possible near_z for each polygon.
-static inline void lifecycle_process() {
-    // Fill z_buffer with highest possible values.
-    for(int i = 0; i < ALL_PIXELS; i++) {
-        z_buffer[i] = INT_MAX;
-    }
+    scene.objects           = test_objects;
+    scene.amount_of_objects = amount_of_objects;
+    scene.palette           = palette;
+    scene.light_source      = source;
+    scene.ambient_light     = ambient_light;
+}
 
-    // Handle all events regarding IO, update camera
-    // and reset list of polygons.
-    io_handle_events(state.io);
-    camera_update(state.camera);
-    reset_poly_list(&num_polys_frame);
+// Main method firstly creates display backend, either SDL window (default) or
+// headless when started with --headless [frames] [--dump directory].
+// With --record file the camera pose of every frame is saved as a camera path
+// that can be replayed by the benchmark (bench --path file).
+// With --capture file the clipped polygon list of every frame is saved so the
+// rasterizer alone can be replayed and timed (bench/replay file).
+// --transform scalar|sse|avx picks the vertex transform kernel and
+// --stepping float|fixed|subpixel the rasterizer arithmetic (subpixel, the
+// default, keeps 28.4 vertices with a top-left fill rule) and --raster scanline|halfspace
+// the rasterizer itself. --threads N rasterizes tile binned on N threads and
+// --hiz rejects hidden triangles and spans with hierarchical z. --clear full
+// wipes the buffers every frame instead of starting a new epoch and
+// --depth linear|16|24|32|float picks the depth buffer format and
+// --sort none|front-to-back|back-to-front orders the polygon list by depth
+// (back to front is painted without z-buffer). --shading deferred draws
+// triangle ids first and shades every visible pixel once afterwards.
+// --hsr sbuffer resolves visible spans per row with a span buffer instead of
+// the z-buffer, so every pixel is written once. --texture off|affine|16|8|exact
+// picks how textured polygons are mapped (perspective divide every 16 or 8
+// pixels by default 16, per pixel, never, or not textured at all).
+// When built with -DPROFILER a per-stage breakdown is printed on exit.
+// When built with -DRASTER_STATS rasterizer counters are printed on exit and
+// --overdraw shows a heatmap of writes per pixel instead of the image.
+// Program Lifecycle is then run through a while loop that iterates as long as boolean quit is not true.
+// Each iteration the backend handles events, the pipeline renders the frame and
+// the backend presents it (SDL paces frames to FPS, headless runs uncapped).
+int main( int arc, char* args[] ) {
+    int headless = 0;
+    uint64_t max_frames = 0;
+    const char* dump_path = NULL;
+    const char* record_path = NULL;
+    const char* capture_path = NULL;
+    FILE* capture = NULL;
+    int overdraw = 0, mode;
+    CameraPath recording;
 
-    for(int index = 0; index < amount_of_objects; index++) {
-        if(!object_culling(&test_objects[index], &state.camera->lookAt, OBJECT_CULL_XYZ_MODE)) 
-        {
-            mirror_two_sided_polygons(&test_objects[index]);
-            printf("num polys: %d, verts: %d\n", test_objects[index].num_polys, test_objects[index].num_vertices);
-            object_local_to_world_transformation(&test_objects[index]);
-            remove_backfaces(&test_objects[index], &state.camera->position, CONSTANT_SHADING);
-            light(&test_objects[index], palette, &source, ambient_light);
-            object_view_transformation(&test_objects[index], &state.camera->lookAt);
-            clip_object_3D(&test_objects[index], CLIP_XYZ_MODE);
-            generate_poly_list(world_poly_storage, world_polys, &num_polys_frame, &test_objects[index]);
-            clip_polygon(world_poly_storage, world_polys, &num_polys_frame);
+    for(int i = 1; i < arc; i++) {
+        if(strcmp(args[i], "--headless") == 0) {
+            headless = 1;
+            if(i + 1 < arc && args[i + 1][0] != '-') {
+                max_frames = strtoull(args[++i], NULL, 10);
+            }
+        }
+        else if(strcmp(args[i], "--dump") == 0 && i + 1 < arc) {
+            dump_path = args[++i];
+        }
+        else if(strcmp(args[i], "--record") == 0 && i + 1 < arc) {
+            record_path = args[++i];
+        }
+        else if(strcmp(args[i], "--capture") == 0 && i + 1 < arc) {
+            capture_path = args[++i];
+        }
+        else if(strcmp(args[i], "--overdraw") == 0) {
+            overdraw = 1;
+        }
+        else if(strcmp(args[i], "--transform") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], TRANSFORM_SCALAR, TRANSFORM_AVX, vertices_kernel_name)) < 0) {
+                printf("unknown --transform value %s\n", args[i]);
+                return 1;
+            }
+            if(vertices_set_kernel(mode) != mode) {
+                printf("%s transform is not supported by this cpu\n", args[i]);
+            }
+        }
+        else if(strcmp(args[i], "--stepping") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], RASTER_FLOAT, RASTER_SUBPIXEL, raster_stepping_name)) < 0) {
+                printf("unknown --stepping value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_stepping(mode);
+        }
+        else if(strcmp(args[i], "--raster") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], RASTER_SCANLINE, RASTER_HALFSPACE, raster_algorithm_name)) < 0) {
+                printf("unknown --raster value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_algorithm(mode);
+        }
+        else if(strcmp(args[i], "--threads") == 0 && i + 1 < arc) {
+            raster_set_threads(atoi(args[++i]));
+        }
+        else if(strcmp(args[i], "--hiz") == 0) {
+            raster_set_hiz(1);
+        }
+        else if(strcmp(args[i], "--clear") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], CLEAR_FULL, CLEAR_EPOCH, raster_clear_name)) < 0) {
+                printf("unknown --clear value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_clear(mode);
+        }
+        else if(strcmp(args[i], "--depth") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], DEPTH_LINEAR, DEPTH_FORMATS - 1, depth_format_name)) < 0) {
+                printf("unknown --depth value %s\n", args[i]);
+                return 1;
+            }
+            depth_set_format(mode);
+        }
+        else if(strcmp(args[i], "--sort") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], POLY_SORT_NONE, POLY_SORT_BACK_TO_FRONT, poly_sort_name)) < 0) {
+                printf("unknown --sort value %s\n", args[i]);
+                return 1;
+            }
+            poly_set_sort(mode);
+        }
+        else if(strcmp(args[i], "--shading") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], SHADE_FORWARD, SHADE_DEFERRED, raster_shading_name)) < 0) {
+                printf("unknown --shading value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_shading(mode);
+        }
+        else if(strcmp(args[i], "--hsr") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], HSR_ZBUFFER, HSR_SBUFFER, raster_hsr_name)) < 0) {
+                printf("unknown --hsr value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_hsr(mode);
+        }
+        else if(strcmp(args[i], "--texture") == 0 && i + 1 < arc) {
+            if((mode = mode_from_name(args[++i], TEXTURE_OFF, TEXTURE_EXACT, raster_texture_name)) < 0) {
+                printf("unknown --texture value %s\n", args[i]);
+                return 1;
+            }
+            raster_set_texture(mode);
         }
     }
-    // draw polygon list with z-buffer.
-    draw_poly_list_z(world_polys, &num_polys_frame, state.pixels, z_buffer);
-}
-
-// Confirm correct initalization of sdl variables via 
-// the use of assertions.
-static inline void initialize_sdl() {
-    ASSERT(!SDL_Init(SDL_INIT_VIDEO), "SDL failed to initalize %s\n", SDL_GetError());
-    state.window = SDL_CreateWindow("DEMO",
-                   SDL_WINDOWPOS_CENTERED_DISPLAY(0), 
-                   SDL_WINDOWPOS_CENTERED_DISPLAY(0), 
-                   SCREENWIDTH,
-                   SCREENHEIGHT,   
-                   SDL_WINDOW_ALLOW_HIGHDPI);
-    ASSERT(state.window, "failed to create SDL window: %s\n", SDL_GetError());
-    state.renderer = SDL_CreateRenderer(state.window, -1, SDL_RENDERER_PRESENTVSYNC);
-    ASSERT(state.renderer, "failed to create SDL renderer: %s\n", SDL_GetError());
-    state.texture = SDL_CreateTexture(state.renderer,
-                    SDL_PIXELFORMAT_ABGR8888, 
-                    SDL_TEXTUREACCESS_STREAMING, 
-                    WINDOW_WIDTH, 
-                    WINDOW_HEIGHT);
-    ASSERT( state.texture, "failed to create SDL texture %s\n", SDL_GetError());
-}
-
-
-// Update, render and present screen of pixels and then
-// reset pixelmap. Also update tracking variables.
-static inline void sdl_rendering_process() {
-    SDL_UpdateTexture(state.texture, NULL, state.pixels, WINDOW_WIDTH * BYTE4);
-    SDL_RenderCopyEx( state.renderer, state.texture, NULL, NULL, 0.0,  NULL, SDL_FLIP_VERTICAL); //makes window 1st quadrant.
-    SDL_RenderPresent(state.renderer);
-    memset(state.pixels, 0, sizeof(state.pixels));
-    char title[100];
-    snprintf(title, sizeof(title), "Pos: x=%.2f, y=%.2f, z=%.2f || Dir: x=%.2f, y=%.2f, z=%.2f || fYaw=%.2f || pitch=%.2f", 
-                state.camera->position.x, 
-                state.camera->position.y, 
-                state.camera->position.z,
-                state.camera->direction.x,
-                state.camera->direction.y,
-                state.camera->direction.z,
-                state.camera->fYaw,
-                state.camera->pitch);
-    SDL_SetWindowTitle(state.window, title);
-}
 
-// Main method firstly initializes SDL through SDL_Init.
-// Then sets SDL window to given proportions, along with renderer and texture.
-// Program Lifecycle is then run through a while loop that iterates as long as boolean quit is not true.
-// Another while loop and switch case is used for event detection (using SDL_PollEvent)
-// that finally sets lifecycle boolean to false if program is shut down.
-// SDL_UpdateTexture updates texture with current pixel state. SDL_RenderCopyEx then performs 
-// the actual rendering. memset() is then used to wipe the pixel array.
-int main( int arc, char* args[] ) {
-    uint64_t frameStart, frameTime;
-    initialize_sdl();
+#ifndef RASTER_STATS
+    if(overdraw) {
+        printf("--overdraw needs a build with -DRASTER_STATS\n");
+    }
+#endif
     initialize_state();
     Load_palette(palette, 256, "src/assets/grey256.pal");
+    if(headless) {
+        state.backend = backend_headless_create(&state.quit, state.camera, max_frames, dump_path);
+    } else {
+        state.backend = backend_sdl_create(&state.quit, state.camera);
+    }
+
+    camerapath_init(&recording);
+    if(capture_path != NULL) {
+        capture = capture_create(capture_path);
+    }
+
     while(!state.quit)
     {
-        frameStart = SDL_GetTicks64(); // SDL_GetTicks - Uint32.
-        lifecycle_process();
-        sdl_rendering_process();
-        frameTime = SDL_GetTicks64() - frameStart;
-        if(frameTime < DELAY_TIME) {
-            SDL_Delay((int) (DELAY_TIME - frameTime));
-        }  
+        PROFILE_FRAME_BEGIN();
+        backend_begin_frame(state.backend);
+        if(record_path != NULL) {
+            camerapath_record(&recording, state.camera);
+        }
+        pipeline_render_frame(&frame, &scene, state.camera);
+        if(capture != NULL && !capture_write_frame(capture, frame.world_polys, frame.num_polys_frame)) {
+            printf("could not write frame to %s\n", capture_path);
+            fclose(capture);
+            capture = NULL;
+        }
+#ifdef RASTER_STATS
+        if(overdraw) {
+            raster_stats_heatmap(frame.pixels);
+        }
+#endif
+        PROFILE(PROFILE_PRESENT, backend_present(state.backend, frame.pixels));
+        PROFILE_FRAME_END();
+    }
+    backend_destroy(state.backend);
+    PROFILE_PRINT(stdout);
+    RASTER_STATS_PRINT(stdout);
+    if(record_path != NULL) {
+        camerapath_save(&recording, record_path);
+    }
+    camerapath_free(&recording);
+    for(int index = 0; index < amount_of_objects; index++) {
+        object_free(&test_objects[index]);
+    }
+    mesh_cache_clear();
+    texture_cache_clear();
+    if(capture != NULL) {
+        fclose(capture);
     }
-    SDL_DestroyTexture(state.texture);
-    SDL_DestroyRenderer(state.renderer);
-    SDL_DestroyWindow(state.window);
-    SDL_Quit();
     return 0;
 }
-
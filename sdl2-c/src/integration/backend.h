@@ -0,0 +1,51 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include "../model/camera.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BACKEND_SDL      0      // SDL window with vsync'd renderer, frames paced to FPS.
+#define BACKEND_HEADLESS 1      // no window, no vsync and no delay (uncapped).
+
+// Backend structure.
+// Display backend that receives each finished pixelmap from the pipeline.
+// All backend specific data (window, renderer, io...) is hidden behind context
+// which means that the rest of the engine never has to know about SDL.
+typedef struct Backend {
+    int      type;
+    bool*    quit;
+    Camera*  camera;
+    uint64_t frames;        // amount of frames presented so far
+    void*    context;       // backend specific data
+
+    void (*begin_frame)(struct Backend* backend);
+    void (*present)    (struct Backend* backend, const uint32_t* pixels);
+    void (*destroy)    (struct Backend* backend);
+}Backend;
+
+// Creates SDL backend. Initializes window, renderer, texture and IO
+// which acts on camera. Confirms initialization via assertions.
+Backend* backend_sdl_create(bool* quit, Camera* camera);
+
+// Creates headless backend that renders without any window. Sets quit once
+// max_frames have been presented (0 means run until quit is set elsewhere).
+// If dump_path is not NULL every frame is written as a PPM into that directory.
+Backend* backend_headless_create(bool* quit, Camera* camera, uint64_t max_frames, const char* dump_path);
+
+// Called before frame is rendered (events, frame pacing).
+static inline void backend_begin_frame(Backend* backend) {
+    backend->begin_frame(backend);
+}
+
+// Present finished pixelmap.
+static inline void backend_present(Backend* backend, const uint32_t* pixels) {
+    backend->present(backend, pixels);
+}
+
+// Release all backend resources including backend itself.
+static inline void backend_destroy(Backend* backend) {
+    backend->destroy(backend);
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include "backend.h"
+#include "image.h"
+#include "timer.h"
+#include "../model/global.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Headless context structure.
+// No window or renderer, only what is needed to stop after a set amount
+// of frames, dump frames to disk and report uncapped frames per second.
+typedef struct {
+    uint64_t    max_frames;     // 0 means unlimited
+    const char* dump_path;      // directory for PPM frames, NULL means no dumping
+    uint64_t    start_ns;
+}HeadlessContext;
+
+// Nothing to poll, there are no events without a window.
+static void backend_headless_begin_frame(Backend* backend) {
+    (void) backend;
+}
+
+// Pixelmap is already finished in memory so presenting only means optionally
+// dumping it to disk. No vsync and no delay.
+static void backend_headless_present(Backend* backend, const uint32_t* pixels) {
+    HeadlessContext* headless = backend->context;
+    if(headless->dump_path != NULL) {
+        char filename[256];
+        snprintf(filename, sizeof(filename), "%s/frame_%05llu.ppm",
+                 headless->dump_path, (unsigned long long) backend->frames);
+        image_write_ppm(filename, pixels, WINDOW_WIDTH, WINDOW_HEIGHT);
+    }
+    backend->frames++;
+    if(headless->max_frames != 0 && backend->frames >= headless->max_frames) {
+        *backend->quit = true;
+    }
+}
+
+// Prints uncapped frames per second for the whole run and frees backend.
+static void backend_headless_destroy(Backend* backend) {
+    HeadlessContext* headless = backend->context;
+    double elapsed_ms = timer_ns_to_ms(timer_now_ns() - headless->start_ns);
+    if(backend->frames > 0 && elapsed_ms > 0) {
+        printf("headless: %llu frames in %.2f ms (%.2f ms/frame, %.2f fps)\n",
+               (unsigned long long) backend->frames, elapsed_ms,
+               elapsed_ms / (double) backend->frames,
+               (double) backend->frames * 1000.0 / elapsed_ms);
+    }
+    free(headless);
+    free(backend);
+}
+
+// Creates headless backend that renders without any window. Sets quit once
+// max_frames have been presented (0 means run until quit is set elsewhere).
+// If dump_path is not NULL every frame is written as a PPM into that directory.
+Backend* backend_headless_create(bool* quit, Camera* camera, uint64_t max_frames, const char* dump_path) {
+    Backend* backend          = malloc(sizeof(Backend));
+    HeadlessContext* headless = malloc(sizeof(HeadlessContext));
+
+    headless->max_frames = max_frames;
+    headless->dump_path  = dump_path;
+    headless->start_ns   = timer_now_ns();
+
+    backend->type        = BACKEND_HEADLESS;
+    backend->quit        = quit;
+    backend->camera      = camera;
+    backend->frames      = 0;
+    backend->context     = headless;
+    backend->begin_frame = backend_headless_begin_frame;
+    backend->present     = backend_headless_present;
+    backend->destroy     = backend_headless_destroy;
+    return backend;
+}
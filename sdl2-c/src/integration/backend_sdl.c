@@ -0,0 +1,101 @@
+#include "backend.h"
+#include "io.h"
+#include "../model/global.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// SDL context structure.
+// Holds a very simple SDL component structure for window, texture and renderer
+// along with the IO that controls the camera.
+typedef struct {
+    SDL_Window*   window;
+    SDL_Texture*  texture;
+    SDL_Renderer* renderer;
+    IO*           io;
+    uint64_t      frame_start;
+}SDLContext;
+
+// Handle all events regarding IO and remember when frame started
+// so that present can delay the remaining time of the frame.
+static void backend_sdl_begin_frame(Backend* backend) {
+    SDLContext* sdl = backend->context;
+    sdl->frame_start = SDL_GetTicks64(); // SDL_GetTicks - Uint32.
+    io_handle_events(sdl->io);
+}
+
+// Update, render and present screen of pixels. Also update tracking variables
+// and delay so that frames are paced to FPS.
+static void backend_sdl_present(Backend* backend, const uint32_t* pixels) {
+    SDLContext* sdl = backend->context;
+    SDL_UpdateTexture(sdl->texture, NULL, pixels, WINDOW_WIDTH * BYTE4);
+    SDL_RenderCopyEx( sdl->renderer, sdl->texture, NULL, NULL, 0.0,  NULL, SDL_FLIP_VERTICAL); //makes window 1st quadrant.
+    SDL_RenderPresent(sdl->renderer);
+    char title[100];
+    float yaw, pitch;
+    camera_yaw_pitch(backend->camera, &yaw, &pitch);
+    snprintf(title, sizeof(title), "Pos: x=%.2f, y=%.2f, z=%.2f || Dir: x=%.2f, y=%.2f, z=%.2f || fYaw=%.2f || pitch=%.2f",
+                backend->camera->position.x,
+                backend->camera->position.y,
+                backend->camera->position.z,
+                backend->camera->direction.x,
+                backend->camera->direction.y,
+                backend->camera->direction.z,
+                yaw,
+                pitch);
+    SDL_SetWindowTitle(sdl->window, title);
+    backend->frames++;
+
+    uint64_t frameTime = SDL_GetTicks64() - sdl->frame_start;
+    if(frameTime < DELAY_TIME) {
+        SDL_Delay((int) (DELAY_TIME - frameTime));
+    }
+}
+
+// Destroys texture, renderer and window and shuts down SDL.
+static void backend_sdl_destroy(Backend* backend) {
+    SDLContext* sdl = backend->context;
+    SDL_DestroyTexture(sdl->texture);
+    SDL_DestroyRenderer(sdl->renderer);
+    SDL_DestroyWindow(sdl->window);
+    SDL_Quit();
+    free(sdl->io);
+    free(sdl);
+    free(backend);
+}
+
+// Confirm correct initalization of sdl variables via
+// the use of assertions.
+Backend* backend_sdl_create(bool* quit, Camera* camera) {
+    Backend* backend = malloc(sizeof(Backend));
+    SDLContext* sdl  = malloc(sizeof(SDLContext));
+
+    ASSERT(!SDL_Init(SDL_INIT_VIDEO), "SDL failed to initalize %s\n", SDL_GetError());
+    sdl->window = SDL_CreateWindow("DEMO",
+                  SDL_WINDOWPOS_CENTERED_DISPLAY(0),
+                  SDL_WINDOWPOS_CENTERED_DISPLAY(0),
+                  SCREENWIDTH,
+                  SCREENHEIGHT,
+                  SDL_WINDOW_ALLOW_HIGHDPI);
+    ASSERT(sdl->window, "failed to create SDL window: %s\n", SDL_GetError());
+    sdl->renderer = SDL_CreateRenderer(sdl->window, -1, SDL_RENDERER_PRESENTVSYNC);
+    ASSERT(sdl->renderer, "failed to create SDL renderer: %s\n", SDL_GetError());
+    sdl->texture = SDL_CreateTexture(sdl->renderer,
+                   SDL_PIXELFORMAT_ABGR8888,
+                   SDL_TEXTUREACCESS_STREAMING,
+                   WINDOW_WIDTH,
+                   WINDOW_HEIGHT);
+    ASSERT( sdl->texture, "failed to create SDL texture %s\n", SDL_GetError());
+    sdl->io          = io_create(quit, camera);
+    sdl->frame_start = 0;
+
+    backend->type        = BACKEND_SDL;
+    backend->quit        = quit;
+    backend->camera      = camera;
+    backend->frames      = 0;
+    backend->context     = sdl;
+    backend->begin_frame = backend_sdl_begin_frame;
+    backend->present     = backend_sdl_present;
+    backend->destroy     = backend_sdl_destroy;
+    return backend;
+}
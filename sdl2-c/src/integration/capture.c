@@ -0,0 +1,115 @@
+#include "capture.h"
+#include <string.h>
+
+// Creates capture file and writes header. Returns NULL if file could not be opened.
+FILE* capture_create(const char* filename) {
+    FILE* fp;
+    uint32_t header[4] = { CAPTURE_MAGIC, CAPTURE_VERSION, WINDOW_WIDTH, WINDOW_HEIGHT };
+
+    if((fp = fopen(filename, "wb")) == NULL) {
+        printf("could not open file %s\n", filename);
+        return NULL;
+    }
+    if(fwrite(header, sizeof(uint32_t), 4, fp) != 4) {
+        printf("could not write header of %s\n", filename);
+        fclose(fp);
+        return NULL;
+    }
+    return fp;
+}
+
+// Opens capture file for reading and validates header.
+// Returns NULL if file is missing or was captured with another version or resolution.
+FILE* capture_open(const char* filename) {
+    FILE* fp;
+    uint32_t header[4];
+
+    if((fp = fopen(filename, "rb")) == NULL) {
+        printf("could not open file %s\n", filename);
+        return NULL;
+    }
+    if(fread(header, sizeof(uint32_t), 4, fp) != 4 || header[0] != CAPTURE_MAGIC) {
+        printf("%s is not a frame capture\n", filename);
+        fclose(fp);
+        return NULL;
+    }
+    if(header[1] != CAPTURE_VERSION || header[2] != WINDOW_WIDTH || header[3] != WINDOW_HEIGHT) {
+        printf("%s has version %u at %ux%u, expected version %d at %dx%d\n", filename,
+               header[1], header[2], header[3], CAPTURE_VERSION, WINDOW_WIDTH, WINDOW_HEIGHT);
+        fclose(fp);
+        return NULL;
+    }
+    return fp;
+}
+
+// Appends polygon list of a frame (in list order) to capture file.
+// Returns 1 on success and 0 on write error.
+int capture_write_frame(FILE* fp, facet** world_polys, int num_polys_frame) {
+    uint32_t amount = num_polys_frame;
+    if(fwrite(&amount, sizeof(uint32_t), 1, fp) != 1) {
+        return 0;
+    }
+
+    for(int curr_poly = 0; curr_poly < num_polys_frame; curr_poly++) {
+        const facet* poly = world_polys[curr_poly];
+        uint8_t num_points = poly->num_points;
+        int32_t shade[MAX_POINTS_PER_POLYGON];
+        float   points[MAX_POINTS_PER_POLYGON * 3];
+
+        for(int v = 0; v < num_points; v++) {
+            shade[v]          = poly->shade[v];
+            points[v * 3 + 0] = poly->vertex_list[v].x;
+            points[v * 3 + 1] = poly->vertex_list[v].y;
+            points[v * 3 + 2] = poly->vertex_list[v].z;
+        }
+        if(fwrite(&num_points, 1, 1, fp) != 1 ||
+           fwrite(shade, sizeof(int32_t), num_points, fp) != num_points ||
+           fwrite(points, sizeof(float), num_points * 3, fp) != (size_t) num_points * 3) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Reads next frame into world_poly_storage and points world_polys to it, the
+// same way generate_poly_list does (without textures). Returns 1 on success
+// and 0 at end of file or if the frame does not fit into MAX_POLYS_PER_FRAME.
+int capture_read_frame(FILE* fp, facet* world_poly_storage, facet** world_polys, int* num_polys_frame) {
+    uint32_t amount;
+    if(fread(&amount, sizeof(uint32_t), 1, fp) != 1) {
+        return 0;
+    }
+    if(amount > MAX_POLYS_PER_FRAME) {
+        printf("captured frame has %u polygons, max is %d\n", amount, MAX_POLYS_PER_FRAME);
+        return 0;
+    }
+
+    for(uint32_t curr_poly = 0; curr_poly < amount; curr_poly++) {
+        facet*  poly = &world_poly_storage[curr_poly];
+        uint8_t num_points;
+        int32_t shade[MAX_POINTS_PER_POLYGON];
+        float   points[MAX_POINTS_PER_POLYGON * 3];
+
+        if(fread(&num_points, 1, 1, fp) != 1 || num_points < 3 || num_points > MAX_POINTS_PER_POLYGON ||
+           fread(shade, sizeof(int32_t), num_points, fp) != num_points ||
+           fread(points, sizeof(float), num_points * 3, fp) != (size_t) num_points * 3) {
+            printf("captured frame is truncated or corrupt\n");
+            return 0;
+        }
+
+        memset(poly, 0, sizeof(facet));
+        poly->num_points = num_points;
+        poly->active     = 1;
+        poly->visible    = 1;
+        poly->texture    = NULL;
+        for(int v = 0; v < num_points; v++) {
+            poly->shade[v]          = shade[v];
+            poly->vertex_list[v].x  = points[v * 3 + 0];
+            poly->vertex_list[v].y  = points[v * 3 + 1];
+            poly->vertex_list[v].z  = points[v * 3 + 2];
+        }
+        world_polys[curr_poly] = poly;
+    }
+    *num_polys_frame = amount;
+    return 1;
+}
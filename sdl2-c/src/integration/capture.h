@@ -0,0 +1,35 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "../model/object/polygon.h"
+#include <stdint.h>
+#include <stdio.h>
+
+// Frame capture of the post-clip polygon list.
+// File starts with a header (magic "FCAP", version, window width and height)
+// followed by any amount of frames. Each frame is the amount of facets and
+// then for each facet only what draw_poly_list_z reads:
+//   uint8 num_points, int32 shade[num_points], float x,y,z[num_points]
+// Everything is stored in native byte order. Textures are not captured, textured
+// facets are replayed with their color.
+
+#define CAPTURE_MAGIC   0x50414346  // "FCAP"
+#define CAPTURE_VERSION 1
+
+// Creates capture file and writes header. Returns NULL if file could not be opened.
+FILE* capture_create(const char* filename);
+
+// Opens capture file for reading and validates header.
+// Returns NULL if file is missing or was captured with another version or resolution.
+FILE* capture_open(const char* filename);
+
+// Appends polygon list of a frame (in list order) to capture file.
+// Returns 1 on success and 0 on write error.
+int capture_write_frame(FILE* fp, facet** world_polys, int num_polys_frame);
+
+// Reads next frame into world_poly_storage and points world_polys to it, the
+// same way generate_poly_list does (without textures). Returns 1 on success
+// and 0 at end of file or if the frame does not fit into MAX_POLYS_PER_FRAME.
+int capture_read_frame(FILE* fp, facet* world_poly_storage, facet** world_polys, int* num_polys_frame);
+
+#endif
@@ -0,0 +1,64 @@
+#include "image.h"
+#include <stdio.h>
+
+// Writes pixelmap as a binary PPM (P6) image. Pixelmap is stored as a first
+// quadrant screen, so rows are flipped to get the same picture as the SDL window.
+// Colors are packed as _RGB32BIT meaning red is the lowest byte.
+int image_write_ppm(const char* filename, const uint32_t* pixelmap, int width, int height) {
+    FILE* fp;
+    unsigned char rgb[3];
+
+    if((fp = fopen(filename, "wb")) == NULL) {
+        printf("could not open file %s\n", filename);
+        return 0;
+    }
+    fprintf(fp, "P6\n%d %d\n255\n", width, height);
+    for(int y = height - 1; y >= 0; y--) {
+        for(int x = 0; x < width; x++) {
+            uint32_t color = pixelmap[(y * width) + x];
+            rgb[0] = color & 0xFF;
+            rgb[1] = (color >> 8) & 0xFF;
+            rgb[2] = (color >> 16) & 0xFF;
+            fwrite(rgb, 1, 3, fp);
+        }
+    }
+    fclose(fp);
+    return 1;
+}
+
+// Reads binary PPM (P6) image written by image_write_ppm back into pixelmap
+// (first quadrant). Returns 1 on success and 0 if file is missing, malformed
+// or does not have the given width and height.
+int image_read_ppm(const char* filename, uint32_t* pixelmap, int width, int height) {
+    FILE* fp;
+    unsigned char rgb[3];
+    int file_width, file_height, max_value;
+
+    if((fp = fopen(filename, "rb")) == NULL) {
+        printf("could not open file %s\n", filename);
+        return 0;
+    }
+    if(fscanf(fp, "P6 %d %d %d", &file_width, &file_height, &max_value) != 3 || max_value != 255 ||
+       fgetc(fp) == EOF) {
+        printf("%s is not a binary PPM image\n", filename);
+        fclose(fp);
+        return 0;
+    }
+    if(file_width != width || file_height != height) {
+        printf("%s is %dx%d, expected %dx%d\n", filename, file_width, file_height, width, height);
+        fclose(fp);
+        return 0;
+    }
+    for(int y = height - 1; y >= 0; y--) {
+        for(int x = 0; x < width; x++) {
+            if(fread(rgb, 1, 3, fp) != 3) {
+                printf("%s is truncated\n", filename);
+                fclose(fp);
+                return 0;
+            }
+            pixelmap[(y * width) + x] = rgb[0] + (rgb[1] << 8) + (rgb[2] << 16);
+        }
+    }
+    fclose(fp);
+    return 1;
+}
@@ -0,0 +1,16 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdint.h>
+
+// Writes pixelmap as a binary PPM (P6) image. Pixelmap is stored as a first
+// quadrant screen, so rows are flipped to get the same picture as the SDL window.
+// Returns 1 on success and 0 if file could not be written.
+int image_write_ppm(const char* filename, const uint32_t* pixelmap, int width, int height);
+
+// Reads binary PPM (P6) image written by image_write_ppm back into pixelmap
+// (first quadrant). Returns 1 on success and 0 if file is missing, malformed
+// or does not have the given width and height.
+int image_read_ppm(const char* filename, uint32_t* pixelmap, int width, int height);
+
+#endif
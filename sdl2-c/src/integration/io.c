@@ -87,43 +87,47 @@ void io_handle_events(IO* io) {
         rotation_y = matrix_create_rotation_matrix_y((M_PI / 2));  
         forward    = vector_matrix_mul(&forward, &rotation_y);
         movement   = vector_add(&io->camera->position, &forward);
-        io->camera->position = movement;
+        camera_set_position(io->camera, &movement);
     }
     if(io_is_key_down(io, SDL_SCANCODE_D)) {
         forward    = vector_scale(&io->camera->direction, speed);
         rotation_y = matrix_create_rotation_matrix_y(-(M_PI / 2));  
         forward    = vector_matrix_mul(&forward, &rotation_y);
         movement   = vector_add(&io->camera->position, &forward); 
-        io->camera->position = movement;  
+        camera_set_position(io->camera, &movement);  
     }
     if(io_is_key_down(io, SDL_SCANCODE_W)) {
         forward  = vector_scale(&io->camera->direction, speed);
         movement = vector_add(&io->camera->position, &forward);
-        io->camera->position = movement;
+        camera_set_position(io->camera, &movement);
     }
     if(io_is_key_down(io, SDL_SCANCODE_S)) {
         forward  = vector_scale(&io->camera->direction, speed);
         movement = vector_sub(&forward, &io->camera->position);
-        io->camera->position = movement;
+        camera_set_position(io->camera, &movement);
     }
 
     if(io_is_key_down(io, SDL_SCANCODE_LEFT)) {
-        io->camera->fYaw -= 0.05;
+        camera_turn(io->camera, -0.05, 0);
     }
     if(io_is_key_down(io, SDL_SCANCODE_RIGHT)) {
-        io->camera->fYaw += 0.05;
+        camera_turn(io->camera, 0.05, 0);
     }
     if(io_is_key_down(io, SDL_SCANCODE_UP)) {
-        io->camera->pitch -= 0.05;
+        camera_turn(io->camera, 0, -0.05);
     }
     if(io_is_key_down(io, SDL_SCANCODE_DOWN)) {
-        io->camera->pitch += 0.05;
+        camera_turn(io->camera, 0, 0.05);
     }
 
     if(io_is_key_down(io, SDL_SCANCODE_Y)) {
-        io->camera->position.y += 0.1;
+        movement   = vector_create(0, 0.1, 0);
+        movement   = vector_add(&io->camera->position, &movement);
+        camera_set_position(io->camera, &movement);
     }
     if(io_is_key_down(io, SDL_SCANCODE_U)) {
-        io->camera->position.y -= 0.1;
+        movement   = vector_create(0, -0.1, 0);
+        movement   = vector_add(&io->camera->position, &movement);
+        camera_set_position(io->camera, &movement);
     }
 }
\ No newline at end of file
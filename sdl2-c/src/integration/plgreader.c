@@ -66,13 +66,70 @@ char *PLG_Get_Line(char *string, int max_length, FILE *fp) {
     }
 }
 
+// Loads texture from binary PPM (P6) file, the file is only read the first
+// time and the texture is then shared by every polygon using it. Rows are
+// flipped, so v = 0 is the bottom row of the image. Returns NULL if the file
+// could not be read or its sizes are not powers of 2 (see texture_create).
+const Texture* PPM_Load_Texture(const char *filename) {
+    FILE *fp;
+    Texture *texture = texture_cache_find(filename);
+    uint32_t *texels;
+    unsigned char rgb[3];
+    int width, height, max_value;
+
+    if(texture != NULL) {
+        return texture;
+    }
+    if((fp = fopen(filename, "rb")) == NULL) {
+        printf("could not open file %s\n", filename);
+        return NULL;
+    }
+    if(fscanf(fp, "P6 %d %d %d", &width, &height, &max_value) != 3 || max_value != 255 ||
+       width <= 0 || height <= 0 || width > TEXTURE_MAX_SIZE || height > TEXTURE_MAX_SIZE || fgetc(fp) == EOF) {
+        printf("%s is not a binary PPM image of at most %dx%d\n", filename, TEXTURE_MAX_SIZE, TEXTURE_MAX_SIZE);
+        fclose(fp);
+        return NULL;
+    }
+    if((texels = malloc(sizeof(uint32_t) * width * height)) == NULL) {
+        printf("could not allocate texels of %s\n", filename);
+        fclose(fp);
+        return NULL;
+    }
+    for(int y = height - 1; y >= 0; y--) {
+        for(int x = 0; x < width; x++) {
+            if(fread(rgb, 1, 3, fp) != 3) {
+                printf("%s is truncated\n", filename);
+                free(texels);
+                fclose(fp);
+                return NULL;
+            }
+            texels[(y * width) + x] = _RGB32BIT(0, rgb[0], rgb[1], rgb[2]);
+        }
+    }
+    fclose(fp);
+
+    texture = texture_create(texels, width, height);
+    free(texels);
+    if(texture == NULL) {
+        printf("could not load texture %s\n", filename);
+        return NULL;
+    }
+    if(!texture_cache_add(texture, filename)) {
+        printf("could not load texture %s, more than %d textures\n", filename, MAX_TEXTURES);
+        texture_free(texture);
+        return NULL;
+    }
+    return texture;
+}
+
 // count how many lines there are in file.
 // helps with determining size for vector array.
-int OBJ_search_amount(char *filename, char type) {
+int OBJ_search_amount(char *filename, const char *keyword) {
     
     int num_polys = 0;
     char buffer[80];          // holds input string
     FILE *fp;
+    size_t length = strlen(keyword);
 
     // open the disk file
     if((fp=fopen(filename, "r")) == NULL) {
@@ -83,7 +140,8 @@ int OBJ_search_amount(char *filename, char type) {
         if(PLG_Get_Line(buffer, 80, fp) == NULL) {
             break;
         }
-        if(buffer[0] == type) {
+        // only count exact keyword, i.e "v" must not count "vt" or "vn" lines.
+        if(strncmp(buffer, keyword, length) == 0 && buffer[length] == ' ') {
             num_polys++;
         }
     }
@@ -94,13 +152,67 @@ int OBJ_search_amount(char *filename, char type) {
 }
 
 
-int OBJ_Load_Object(Object* object, char *filename, float scale) {
-    // this function loads an object off disk and allows it to be scaled.
+// Writes path of file name, given relative to the directory of file relative_to.
+static void PLG_Relative_Path(char *path, size_t size, const char *relative_to, const char *name) {
+    const char *slash = strrchr(relative_to, '/');
+    int directory = (slash != NULL) ? (int) (slash - relative_to) + 1 : 0;
+    snprintf(path, size, "%.*s%s", directory, relative_to, name);
+}
+
+// Material of an OBJ file, only its texture (map_Kd) is used.
+typedef struct {
+    char name[32];
+    const Texture* texture;
+}ObjMaterial;
+
+// Reads materials of the material library named in an OBJ file, the name is
+// relative to the directory of the OBJ file. Returns amount of materials read.
+static int OBJ_Load_Materials(const char *obj_filename, const char *library, ObjMaterial *materials, int max_materials) {
+    FILE *fp;
+    char path[256], texture_path[256], buffer[80], name[64];
+    int amount = 0;
+
+    PLG_Relative_Path(path, sizeof(path), obj_filename, library);
+    if((fp = fopen(path, "r")) == NULL) {
+        printf("could not open file %s\n", path);
+        return 0;
+    }
+    while(PLG_Get_Line(buffer, 80, fp) != NULL) {
+        if(sscanf(buffer, "newmtl %63s", name) == 1 && amount < max_materials) {
+            snprintf(materials[amount].name, sizeof(materials[amount].name), "%.31s", name);
+            materials[amount++].texture = NULL;
+        }
+        else if(sscanf(buffer, " map_Kd %63s", name) == 1 && amount > 0) {
+            PLG_Relative_Path(texture_path, sizeof(texture_path), obj_filename, name);
+            materials[amount - 1].texture = PPM_Load_Texture(texture_path);
+        }
+    }
+    fclose(fp);
+    return amount;
+}
+
+// Reads vertex and texture coordinate index of a face corner ("v", "v/vt",
+// "v/vt/vn" or "v//vn"), texture is 0 when the corner has none.
+static int OBJ_Read_Corner(const char *token, int *vertex, int *texture) {
+    *texture = 0;
+    if(sscanf(token, "%d/%d", vertex, texture) < 1) {
+        return 0;
+    }
+    return 1;
+}
+
+// Loads mesh from OBJ file (v, vt and f lines, textures from the map_Kd of
+// the mtllib material named by usemtl) and scales it.
+// Returns NULL if file could not be read.
+Mesh* OBJ_Load_Mesh(char *filename, float scale) {
+    // this function loads a mesh off disk and allows it to be scaled.
 
     FILE *fp; // disk file
-    static int id_number = 0; // used to set object id's
+    Mesh *mesh;
     char buffer[80],          // holds input string
-         type;
+         type,
+         name[64],
+         *token;
     float x,y,z;              // a single vertex
     int tl,
         tr,
@@ -108,128 +220,191 @@ int OBJ_Load_Object(Object* object, char *filename, float scale) {
     int vertex_0,
         vertex_1,
         vertex_2;
+    int corners[3],           // texture coordinate index of each corner
+        corner;
 
-    Vector u,v,normal;              // working vectors
+    Vector u,v,normal,p0,p1,p2;     // working vectors
 
-    const int num_vertices = OBJ_search_amount(filename, 'v');
-    const int num_polys    = OBJ_search_amount(filename, 'f');
-    printf("verts: %d, polys: %d\n", num_vertices, num_polys);
+    const int num_vertices = OBJ_search_amount(filename, "v");
+    const int num_uvs      = OBJ_search_amount(filename, "vt");
+    const int num_polys    = OBJ_search_amount(filename, "f");
 
     int ver_index = 0;
+    int uv_index = 0;
     int poly_index = 0;
 
-    object->num_vertices = num_vertices;
-    object->num_polys = num_polys;
-    object->state = 1;
-
-    object->world_pos.x = 0;
-    object->world_pos.y = 0;
-    object->world_pos.z = 0;
-
-    object->id = id_number++;
+    ObjMaterial materials[16];
+    int num_materials = 0;
+    const Texture* texture = NULL;  // texture of the material in use
+    float* uvs;
 
     // open the disk file
     if((fp=fopen(filename, "r")) == NULL) {
         printf("could not open file %s\n", filename);
-        return 0;
+        return NULL;
+    }
+
+    // size buffers to the mesh, every face is two sided so leave room
+    // for its mirrored copy.
+    uvs = malloc(sizeof(float) * 2 * (num_uvs > 0 ? num_uvs : 1));
+    if(uvs == NULL || (mesh = mesh_create(num_vertices, 2 * num_polys)) == NULL) {
+        free(uvs);
+        fclose(fp);
+        return NULL;
     }
 
-    // Find and add all vertice into the vertice array.
-    // Once "s off" is reached 
+    // Vertices and faces are read in a single pass since files do not always
+    // separate them with a line such as "s off" (e.g. teapot.obj).
     while(1) {
         if(PLG_Get_Line(buffer, 80, fp) == NULL) {
             break;
         }
-        if(sscanf(buffer, "%c %f %f %f", &type, &x, &y, &z) != 4) {
-            break;
-        }
         // Vertice, add it to array.
-        if(type == 'v') {
-            object->vertices_local[ver_index].x = x * scale;
-            object->vertices_local[ver_index].y = y * scale;
-            object->vertices_local[ver_index].z = z * scale;
+        if(buffer[0] == 'v' && buffer[1] == ' ') {
+            if(sscanf(buffer, "%c %f %f %f", &type, &x, &y, &z) != 4) {
+                continue;
+            }
+            mesh->vertices.x[ver_index] = x * scale;
+            mesh->vertices.y[ver_index] = y * scale;
+            mesh->vertices.z[ver_index] = z * scale;
             ver_index++;
         }
-    }
-
-    // Iterate through all polys and add them to the object.
-    while(1) {
-        if(PLG_Get_Line(buffer, 80, fp) == NULL) {
-            break;
+        // Texture coordinate, kept until faces refer to it.
+        else if(buffer[0] == 'v' && buffer[1] == 't' && buffer[2] == ' ') {
+            if(uv_index >= num_uvs || sscanf(buffer, "vt %f %f", &x, &y) != 2) {
+                continue;
+            }
+            uvs[2 * uv_index]     = x;
+            uvs[2 * uv_index + 1] = y;
+            uv_index++;
         }
-        if(sscanf(buffer, "%c %d %d %d", &type, &tl, &tr, &br) != 4) {
-            break;
+        // Materials, faces after usemtl get the texture of that material.
+        else if(sscanf(buffer, "mtllib %63s", name) == 1) {
+            num_materials = OBJ_Load_Materials(filename, name, materials, 16);
+        }
+        else if(sscanf(buffer, "usemtl %63s", name) == 1) {
+            texture = NULL;
+            for(int index = 0; index < num_materials; index++) {
+                if(strcmp(materials[index].name, name) == 0) {
+                    texture = materials[index].texture;
+                }
+            }
         }
-        if(type == 'f') {
+        // Face, add it to polys.
+        else if(buffer[0] == 'f' && buffer[1] == ' ') {
+            if(!(token = strtok(&buffer[2], " ")) || !OBJ_Read_Corner(token, &tl, &corners[0]) ||
+               !(token = strtok(NULL, " ")) || !OBJ_Read_Corner(token, &tr, &corners[1]) ||
+               !(token = strtok(NULL, " ")) || !OBJ_Read_Corner(token, &br, &corners[2])) {
+                continue;
+            }
+            // skip faces that refer to vertices outside of the mesh.
+            if(tl < 1 || tr < 1 || br < 1 || tl > num_vertices || tr > num_vertices || br > num_vertices ||
+               poly_index >= num_polys) {
+                continue;
+            }
 
-            object->polys[poly_index].num_points = 3;
-            object->polys[poly_index].color      = 0x0000FF00;
-            object->polys[poly_index].two_sided  = 1;
-            object->polys[poly_index].visible    = 1;
-            object->polys[poly_index].clipped    = 0;
-            object->polys[poly_index].active     = 1;
+            mesh->polys[poly_index].num_points = 3;
+            mesh->polys[poly_index].color      = 0x0000FF00;
+            mesh->polys[poly_index].two_sided  = 1;
+            mesh->polys[poly_index].active     = 1;
 
             // Top left corner = vertex_list[0]
             // Also -1 for each value because file is 1' index and objects are 0'.
-            object->polys[poly_index].vertex_list[0] = tl-1;
-            object->polys[poly_index].vertex_list[1] = tr-1;
-            object->polys[poly_index].vertex_list[2] = br-1;
+            mesh->polys[poly_index].vertex_list[0] = tl-1;
+            mesh->polys[poly_index].vertex_list[1] = tr-1;
+            mesh->polys[poly_index].vertex_list[2] = br-1;
+
+            // textured only if every corner has texture coordinates
+            mesh->polys[poly_index].texture = texture;
+            for(corner = 0; corner < 3; corner++) {
+                if(corners[corner] < 1 || corners[corner] > uv_index) {
+                    mesh->polys[poly_index].texture = NULL;
+                    break;
+                }
+                mesh->polys[poly_index].uv[corner][0] = uvs[2 * (corners[corner] - 1)];
+                mesh->polys[poly_index].uv[corner][1] = uvs[2 * (corners[corner] - 1) + 1];
+            }
 
 
-            vertex_0 = object->polys[poly_index].vertex_list[0];
-            vertex_1 = object->polys[poly_index].vertex_list[1];
-            vertex_2 = object->polys[poly_index].vertex_list[2];
+            vertex_0 = mesh->polys[poly_index].vertex_list[0];
+            vertex_1 = mesh->polys[poly_index].vertex_list[1];
+            vertex_2 = mesh->polys[poly_index].vertex_list[2];
     
             // the vector u = v0->v1
-            u = vector_sub(&object->vertices_local[vertex_0], &object->vertices_local[vertex_1]);
+            p0 = vertices_get(&mesh->vertices, vertex_0);
+            p1 = vertices_get(&mesh->vertices, vertex_1);
+            p2 = vertices_get(&mesh->vertices, vertex_2);
+            u = vector_sub(&p0, &p1);
             // the vector v = v0->v2
-            v = vector_sub(&object->vertices_local[vertex_0], &object->vertices_local[vertex_2]);
+            v = vector_sub(&p0, &p2);
     
             normal = vector_cross_product(&v, &u);
-            object->polys[poly_index].normal = normal;
+            mesh->polys[poly_index].normal = normal;
 
             poly_index++;
-
         }
-
     }
 
     fclose(fp);   
-    object->radius = compute_object_radius(object);
-    return 1;
+    free(uvs);
+    mesh->num_polys = poly_index;
+    mirror_two_sided_polygons(mesh);
+    mesh_compute_bounds(mesh);
+    return mesh;
     
 }
 
-// Loads PLG files by reading from the text file and declaring variables accordingly.
-// Also has the option to scale the object as it is being constructed.
-int PLG_Load_Object(Object* object, char *filename, float scale) {
-    // this function loads an object off disk and allows it to be scaled.
+// Loads object from OBJ file, file is only parsed the first time and the
+// mesh is then shared by every object loaded from it with the same scale.
+int OBJ_Load_Object(Object* object, char *filename, float scale) {
+    Mesh *mesh = mesh_cache_find(filename, scale);
+    if(mesh == NULL) {
+        if((mesh = OBJ_Load_Mesh(filename, scale)) == NULL) {
+            return 0;
+        }
+        mesh_cache_add(mesh, filename, scale);
+    }
+    return object_create(object, mesh);
+}
+
+// Loads mesh from PLG file by reading from the text file and declaring variables
+// accordingly. Also has the option to scale the mesh as it is being constructed.
+// Extended syntax for textures: the header may name a PPM texture (relative to
+// the PLG file) after the amount of polygons, and every polygon line may end
+// with a u v pair for each of its vertices (polygons without them stay untextured).
+// Returns NULL if file could not be read.
+Mesh* PLG_Load_Mesh(char *filename, float scale) {
+    // this function loads a mesh off disk and allows it to be scaled.
 
     FILE *fp; // disk file
-    static int id_number = 0; // used to set object id's
+    Mesh *mesh;
     char buffer[80],          // holds input string
          object_name[32],     // name of 3D object
+         texture_name[80],    // texture file of textured polygons
+         texture_path[256],
          *token;              // current parsing token
+    const Texture *texture = NULL;
 
     unsigned int total_vertices,    // total vertices in object
                  total_polys,       // total polygons per object
-                 num_vertices,      // number of vertices on a polygon
                  logical_color,     // the final color of polygon
                  index,             // looping variables
-                 index_2,
-                 vertex_num,        // vertex number
                  vertex_0,
                  vertex_1,
                  vertex_2;
+
+    int num_vertices,               // number of vertices on a polygon
+        index_2,                    // looping variable
+        vertex_num;                 // vertex number (signed, so atoi of "-1" is rejected)
     
     float x,y,z;                    // a single vertex
 
-    Vector u,v,normal;              // working vectors
+    Vector u,v,normal,p0,p1,p2;     // working vectors
 
     // open the disk file
     if((fp=fopen(filename, "r")) == NULL) {
         printf("Could not open file %s\n", filename);
-        return 0;
+        return NULL;
     }
 
     // first we are looking for the header line that has the object name and
@@ -238,25 +413,27 @@ int PLG_Load_Object(Object* object, char *filename, float scale) {
     if(!PLG_Get_Line(buffer, 80, fp)) {
         printf("Error with PLG file %s (stop 1)", filename);
         fclose(fp);
-        return 0;
+        return NULL;
     }
 
-    // extract object name and number of vertices and polygons
-    sscanf(buffer, "%s %d %d",object_name, &total_vertices, &total_polys);
+    // extract object name and number of vertices and polygons, and texture if any
+    // (texture file is relative to the directory of the PLG file)
+    if(sscanf(buffer, "%31s %u %u %79s", object_name, &total_vertices, &total_polys, texture_name) == 4) {
+        PLG_Relative_Path(texture_path, sizeof(texture_path), filename, texture_name);
+        if((texture = PPM_Load_Texture(texture_path)) == NULL) {
+            printf("PLG file %s is drawn without texture\n", filename);
+        }
+    }
 
-    // set proper fields in object
-    object->num_vertices = total_vertices;
-    object->num_polys = total_polys;
-    object->state = 1;
+    // buffers are sized to the mesh and every polygon is two sided so leave
+    // room for its mirrored copy.
+    if((mesh = mesh_create(total_vertices, 2 * total_polys)) == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    mesh->num_polys = total_polys;
 
     //printf("total_vertices: %d, total_polys: %d\n", total_vertices, total_polys);
-    
-    object->world_pos.x = 0;
-    object->world_pos.y = 0;
-    object->world_pos.z = 0;
-
-    // set id number, maybe later also add the name of object in the structure?
-    object->id = id_number++;
 
 
     // based on number of vertices, read vertex list into object
@@ -266,15 +443,16 @@ int PLG_Load_Object(Object* object, char *filename, float scale) {
         if(!PLG_Get_Line(buffer, 80, fp)) {
             printf("Error with PLG file %s (stop 2)", filename);
             fclose(fp);
-            return 0;
+            mesh_free(mesh);
+            return NULL;
         }
 
         sscanf(buffer,"%f %f %f", &x, &y, &z);
 
         // insert vertex into object
-        object->vertices_local[index].x = x * scale;
-        object->vertices_local[index].y = y * scale;
-        object->vertices_local[index].z = z * scale;
+        mesh->vertices.x[index] = x * scale;
+        mesh->vertices.y[index] = y * scale;
+        mesh->vertices.z[index] = z * scale;
 
         //printf("x: %.2f, y: %.2f, z: %.2f\n", x, y , z);
 
@@ -287,14 +465,16 @@ int PLG_Load_Object(Object* object, char *filename, float scale) {
         if(!PLG_Get_Line(buffer, 80, fp)) {
             printf("Error with PLG file %s (stop 3)", filename);
             fclose(fp);
-            return 0;
+            mesh_free(mesh);
+            return NULL;
         }
 
         // initialize token getter and get first token which is color descriptor
         if(!(token = strtok(buffer, " "))) {
             printf("Error with PLG file %s (stop 4)", filename);
             fclose(fp);
-            return 0;
+            mesh_free(mesh);
+            return NULL;
         }
 
         // test if number is hexadecimal
@@ -313,23 +493,23 @@ int PLG_Load_Object(Object* object, char *filename, float scale) {
         if(!(token = strtok(NULL, " "))) {
             printf("Error with PLG file %s (stop 5)", filename);
             fclose(fp);
-            return 0;
+            mesh_free(mesh);
+            return NULL;
         }
 
-        if((num_vertices = atoi(token)) <= 0) {
+        if((num_vertices = atoi(token)) <= 0 || num_vertices > MAX_POINTS_PER_POLYGON) {
             printf("Error with PLG file %s (stop 6)", filename);
             fclose(fp);
-            return 0;
+            mesh_free(mesh);
+            return NULL;
         }
 
         // set fields in polygon structure
 
-        object->polys[index].num_points = num_vertices;
-        object->polys[index].color      = logical_color;
-        object->polys[index].two_sided  = 1;
-        object->polys[index].visible    = 1;
-        object->polys[index].clipped    = 0;
-        object->polys[index].active     = 1;
+        mesh->polys[index].num_points = num_vertices;
+        mesh->polys[index].color      = logical_color;
+        mesh->polys[index].two_sided  = 1;
+        mesh->polys[index].active     = 1;
 
         //printf("num_points: %d\n", num_vertices);
 
@@ -341,37 +521,78 @@ int PLG_Load_Object(Object* object, char *filename, float scale) {
             {
                 printf("Error with PLG file %s (stop 7)", filename);
                 fclose(fp);
-                return 0;
+                mesh_free(mesh);
+                return NULL;
             }
 
             vertex_num = atoi(token);
             //printf("vertex_num: %d\n", vertex_num);
+            if(vertex_num < 0 || vertex_num >= (int) total_vertices) {
+                printf("Error with PLG file %s (stop 8)", filename);
+                fclose(fp);
+                mesh_free(mesh);
+                return NULL;
+            }
 
             // insert vertex number into polygon
-            object->polys[index].vertex_list[index_2] = vertex_num;
+            mesh->polys[index].vertex_list[index_2] = vertex_num;
+        }
+
+        // optional texture coordinates, one u v pair per vertex
+        for(index_2 = 0; index_2 < 2 * num_vertices; index_2++) {
+            if(!(token = strtok(NULL, " "))) {
+                break;
+            }
+            mesh->polys[index].uv[index_2 / 2][index_2 % 2] = atof(token);
+        }
+        if(index_2 != 0 && index_2 != 2 * num_vertices) {
+            printf("Error with PLG file %s (stop 9)", filename);
+            fclose(fp);
+            mesh_free(mesh);
+            return NULL;
+        }
+        if(index_2 != 0) {
+            mesh->polys[index].texture = texture;
         }
 
         // compute length of the two co-planar edges of the polygon, since they
         // will be used in the computation of the dot-product later
 
-        vertex_0 = object->polys[index].vertex_list[0];
-        vertex_1 = object->polys[index].vertex_list[1];
-        vertex_2 = object->polys[index].vertex_list[2];
+        vertex_0 = mesh->polys[index].vertex_list[0];
+        vertex_1 = mesh->polys[index].vertex_list[1];
+        vertex_2 = mesh->polys[index].vertex_list[2];
 
         // the vector u = v0->v1
-        u = vector_sub(&object->vertices_local[vertex_0], &object->vertices_local[vertex_1]);
+        p0 = vertices_get(&mesh->vertices, vertex_0);
+        p1 = vertices_get(&mesh->vertices, vertex_1);
+        p2 = vertices_get(&mesh->vertices, vertex_2);
+        u = vector_sub(&p0, &p1);
         // the vector v = v0->v2
-        v = vector_sub(&object->vertices_local[vertex_0], &object->vertices_local[vertex_2]);
+        v = vector_sub(&p0, &p2);
 
         normal = vector_cross_product(&v, &u);
-        object->polys[index].normal = normal;
+        mesh->polys[index].normal = normal;
     }
 
     // close file
     fclose(fp);
 
-    // compute object radius
-    object->radius = compute_object_radius(object);
+    // mirror two sided polygons and compute bounds
+    mirror_two_sided_polygons(mesh);
+    mesh_compute_bounds(mesh);
 
-    return 1;
+    return mesh;
+}
+
+// Loads object from PLG file, file is only parsed the first time and the
+// mesh is then shared by every object loaded from it with the same scale.
+int PLG_Load_Object(Object* object, char *filename, float scale) {
+    Mesh *mesh = mesh_cache_find(filename, scale);
+    if(mesh == NULL) {
+        if((mesh = PLG_Load_Mesh(filename, scale)) == NULL) {
+            return 0;
+        }
+        mesh_cache_add(mesh, filename, scale);
+    }
+    return object_create(object, mesh);
 }
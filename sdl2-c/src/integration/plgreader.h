@@ -6,10 +6,31 @@
 // Reads line of PLG file and converts file text into string. 
 char *PLG_Get_Line(char *string, int max_length, FILE *fp);
 
-// Loads PLG files by reading from the text file and declaring variables accordingly.
-// Also has the option to scale the object as it is being constructed.
+// Loads texture from binary PPM (P6) file, the file is only read the first
+// time and the texture is then shared by every polygon using it. Rows are
+// flipped, so v = 0 is the bottom row of the image. Returns NULL if the file
+// could not be read or its sizes are not powers of 2 (see texture_create).
+const Texture* PPM_Load_Texture(const char *filename);
+
+// Loads mesh from PLG file by reading from the text file and declaring variables
+// accordingly. Also has the option to scale the mesh as it is being constructed.
+// Extended syntax for textures: the header may name a PPM texture (relative to
+// the PLG file) after the amount of polygons, and every polygon line may end
+// with a u v pair for each of its vertices (polygons without them stay untextured).
+// Returns NULL if file could not be read.
+Mesh* PLG_Load_Mesh(char *filename, float scale);
+
+// Loads object from PLG file, file is only parsed the first time and the
+// mesh is then shared by every object loaded from it with the same scale.
 int PLG_Load_Object(Object* object, char *filename, float scale);
 
+// Loads mesh from OBJ file (v, vt and f lines, textures from the map_Kd of
+// the mtllib material named by usemtl) and scales it.
+// Returns NULL if file could not be read.
+Mesh* OBJ_Load_Mesh(char *filename, float scale);
+
+// Loads object from OBJ file, file is only parsed the first time and the
+// mesh is then shared by every object loaded from it with the same scale.
 int OBJ_Load_Object(Object* object, char *filename, float scale);
 
 #endif
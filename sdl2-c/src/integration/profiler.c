@@ -0,0 +1,122 @@
+#include "profiler.h"
+
+#ifdef PROFILER
+
+#include <string.h>
+
+// Profiler state.
+// Ring buffer of the last PROFILE_FRAMES frames together with the frame
+// that is currently being recorded.
+static struct {
+    ProfileFrame frames[PROFILE_FRAMES];
+    int          head;      // next slot to write
+    int          count;     // amount of valid frames
+    ProfileFrame current;
+    uint64_t     frame_start;
+}profiler;
+
+static const char* stage_names[PROFILE_STAGES] = {
+    "object_culling",
+    "object_view_transformation",
+    "remove_backfaces",
+    "light",
+    "clip_object_3D",
+    "generate_poly_list",
+    "clip_polygon",
+    "sort_poly_list",
+    "draw_poly_list_z",
+    "clear",
+    "present",
+    "frame",
+};
+
+// Starts a new frame, all stage times are added to it until profiler_frame_end.
+void profiler_frame_begin(void) {
+    memset(&profiler.current, 0, sizeof(ProfileFrame));
+    profiler.frame_start = timer_now_ns();
+}
+
+// Ends frame and pushes it into ring buffer (overwrites the oldest frame).
+void profiler_frame_end(void) {
+    profiler.current.stage_ns[PROFILE_FRAME] = timer_now_ns() - profiler.frame_start;
+    profiler.frames[profiler.head] = profiler.current;
+    profiler.head = (profiler.head + 1) % PROFILE_FRAMES;
+    if(profiler.count < PROFILE_FRAMES) {
+        profiler.count++;
+    }
+}
+
+// Adds time to stage of current frame.
+void profiler_add(int stage, uint64_t ns) {
+    profiler.current.stage_ns[stage] += ns;
+}
+
+// Amount of frames currently held in ring buffer.
+int profiler_frames(void) {
+    return profiler.count;
+}
+
+// Returns frame from ring buffer, age 0 is the most recent finished frame.
+// Returns NULL if there is no such frame.
+const ProfileFrame* profiler_get_frame(int age) {
+    if(age < 0 || age >= profiler.count) {
+        return NULL;
+    }
+    int index = (profiler.head - 1 - age + PROFILE_FRAMES) % PROFILE_FRAMES;
+    return &profiler.frames[index];
+}
+
+// Computes mean, min and max of stage over all frames in ring buffer.
+void profiler_stage_stats(int stage, ProfileStats* stats) {
+    uint64_t total = 0, min = UINT64_MAX, max = 0;
+    for(int age = 0; age < profiler.count; age++) {
+        uint64_t ns = profiler_get_frame(age)->stage_ns[stage];
+        total += ns;
+        if(ns < min) { min = ns; }
+        if(ns > max) { max = ns; }
+    }
+    if(profiler.count == 0) {
+        stats->mean_ms = stats->min_ms = stats->max_ms = 0;
+        return;
+    }
+    stats->mean_ms = timer_ns_to_ms(total) / profiler.count;
+    stats->min_ms  = timer_ns_to_ms(min);
+    stats->max_ms  = timer_ns_to_ms(max);
+}
+
+// Returns printable name of stage.
+const char* profiler_stage_name(int stage) {
+    if(stage < 0 || stage >= PROFILE_STAGES) {
+        return "unknown";
+    }
+    return stage_names[stage];
+}
+
+// Prints per-stage breakdown of all frames in ring buffer, share is
+// relative to the entire frame.
+void profiler_print(FILE* out) {
+    ProfileStats stats, frame;
+    profiler_stage_stats(PROFILE_FRAME, &frame);
+    fprintf(out, "profile of last %d frames\n", profiler.count);
+    fprintf(out, "%-28s %10s %10s %10s %7s\n", "stage", "mean ms", "min ms", "max ms", "share");
+    for(int stage = 0; stage < PROFILE_STAGES; stage++) {
+        profiler_stage_stats(stage, &stats);
+        fprintf(out, "%-28s %10.4f %10.4f %10.4f %6.1f%%\n",
+                stage_names[stage], stats.mean_ms, stats.min_ms, stats.max_ms,
+                (frame.mean_ms > 0) ? 100.0 * stats.mean_ms / frame.mean_ms : 0);
+    }
+}
+
+// Empties ring buffer.
+void profiler_reset(void) {
+    profiler.head  = 0;
+    profiler.count = 0;
+}
+
+#else
+
+// ISO C forbids an empty translation unit, the stubs in profiler.h need
+// nothing from this file.
+typedef int profiler_disabled;
+
+#endif
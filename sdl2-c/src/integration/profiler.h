@@ -0,0 +1,91 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Per-stage frame profiler.
+// Compiled in only when PROFILER is defined (e.g. -DPROFILER), otherwise every
+// macro below expands to the bare statement and nothing is timed or stored.
+
+#define PROFILE_CULLING         0   // object_culling
+#define PROFILE_VIEW            1   // object_view_transformation
+#define PROFILE_BACKFACES       2   // remove_backfaces
+#define PROFILE_LIGHT           3   // light
+#define PROFILE_CLIP_OBJECT     4   // clip_object_3D
+#define PROFILE_POLY_LIST       5   // generate_poly_list
+#define PROFILE_CLIP_POLYGON    6   // clip_polygon
+#define PROFILE_SORT            7   // sort_poly_list
+#define PROFILE_DRAW            8   // draw_poly_list_z
+#define PROFILE_CLEAR           9   // buffers_clear and buffers_resolve
+#define PROFILE_PRESENT         10  // backend present (SDL or headless)
+#define PROFILE_FRAME           11  // entire frame
+#define PROFILE_STAGES          12
+
+#define PROFILE_FRAMES 128          // amount of frames kept in ring buffer
+
+// Time spent in each stage during a single frame (nanoseconds).
+typedef struct {
+    uint64_t stage_ns[PROFILE_STAGES];
+}ProfileFrame;
+
+// Statistics of a single stage over all frames in ring buffer (milliseconds).
+typedef struct {
+    double mean_ms,
+           min_ms,
+           max_ms;
+}ProfileStats;
+
+#ifdef PROFILER
+
+#include "timer.h"
+
+// Starts a new frame, all stage times are added to it until profiler_frame_end.
+void profiler_frame_begin(void);
+
+// Ends frame and pushes it into ring buffer (overwrites the oldest frame).
+void profiler_frame_end(void);
+
+// Adds time to stage of current frame.
+void profiler_add(int stage, uint64_t ns);
+
+// Amount of frames currently held in ring buffer.
+int profiler_frames(void);
+
+// Returns frame from ring buffer, age 0 is the most recent finished frame.
+// Returns NULL if there is no such frame.
+const ProfileFrame* profiler_get_frame(int age);
+
+// Computes mean, min and max of stage over all frames in ring buffer.
+void profiler_stage_stats(int stage, ProfileStats* stats);
+
+// Returns printable name of stage.
+const char* profiler_stage_name(int stage);
+
+// Prints per-stage breakdown of all frames in ring buffer.
+void profiler_print(FILE* out);
+
+// Empties ring buffer.
+void profiler_reset(void);
+
+#define PROFILE(stage, statement) do {                          \
+        uint64_t profile_start = timer_now_ns();                \
+        statement;                                              \
+        profiler_add((stage), timer_now_ns() - profile_start);  \
+    } while(0)
+#define PROFILE_FRAME_BEGIN()   profiler_frame_begin()
+#define PROFILE_FRAME_END()     profiler_frame_end()
+#define PROFILE_PRINT(out)      profiler_print(out)
+#define PROFILE_RESET()         profiler_reset()
+
+#else
+
+#define PROFILE(stage, statement) statement
+#define PROFILE_FRAME_BEGIN()
+#define PROFILE_FRAME_END()
+#define PROFILE_PRINT(out)
+#define PROFILE_RESET()
+
+#endif
+
+#endif
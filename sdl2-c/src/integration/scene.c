@@ -0,0 +1,106 @@
+#include "scene.h"
+#include "plgreader.h"
+#include <string.h>
+
+static const char* scene_names[AMOUNT_OF_SCENES] = { "cubes", "mountains", "teapot", "crates" };
+
+// Returns name of preset ("cubes", "mountains", "teapot", "crates").
+const char* scene_preset_name(int preset) {
+    if(preset < 0 || preset >= AMOUNT_OF_SCENES) {
+        return "unknown";
+    }
+    return scene_names[preset];
+}
+
+// Finds preset from its name. Returns -1 if there is no such preset.
+int scene_preset_from_name(const char* name) {
+    for(int preset = 0; preset < AMOUNT_OF_SCENES; preset++) {
+        if(strcmp(name, scene_names[preset]) == 0) {
+            return preset;
+        }
+    }
+    return -1;
+}
+
+// Loads objects of preset into objects (needs MAX_AMOUNT_OF_OBJECTS slots) and
+// fills scene with them, palette and light source. Returns 1 on success.
+int scene_load_preset(Scene* scene, Object* objects, RGBA* palette, int preset) {
+    int amount_of_objects = 0;
+
+    switch(preset) {
+        case SCENE_CUBES:
+        case SCENE_CRATES:
+            // same grid as the interactive demo, 4 cubes wide.
+            for(int index = 0; index < MAX_AMOUNT_OF_OBJECTS; index++) {
+                if(!PLG_Load_Object(&objects[index], (preset == SCENE_CRATES) ? "src/assets/crate.plg" : "src/assets/cube.plg", 1)) {
+                    return 0;
+                }
+                object_position(&objects[index], -200 + (index%4)*100, 0, 200 + 300*(index>>2));
+            }
+            amount_of_objects = MAX_AMOUNT_OF_OBJECTS;
+        break;
+        case SCENE_MOUNTAINS:
+            if(!OBJ_Load_Object(&objects[0], "src/assets/mountains.obj", 1)) {
+                return 0;
+            }
+            object_position(&objects[0], 0, -40, 150);
+            amount_of_objects = 1;
+        break;
+        case SCENE_TEAPOT:
+            if(!OBJ_Load_Object(&objects[0], "src/assets/teapot.obj", 15)) {
+                return 0;
+            }
+            object_position(&objects[0], 0, -20, 100);
+            amount_of_objects = 1;
+        break;
+        default:
+            return 0;
+    }
+
+    Load_palette(palette, 256, "src/assets/grey256.pal");
+    scene->objects           = objects;
+    scene->amount_of_objects = amount_of_objects;
+    scene->palette           = palette;
+    scene->light_source      = vector_create(0, 0, 0);
+    scene->ambient_light     = 6.0f;
+    return 1;
+}
+
+// Fills path with the scripted camera path that is flown through preset.
+// Keyframes are x, y, z, fYaw, pitch.
+void scene_preset_camera_path(CameraPath* path, int preset) {
+    static const float cubes[][5] = {
+        {    0,  0,    0,  0.0f,  0.0f },
+        {  -50,  0,  150, -0.3f,  0.0f },
+        {  -50, 10,  400,  0.3f,  0.1f },
+        {    0,  0,  700,  0.0f,  0.0f },
+    };
+    static const float mountains[][5] = {
+        {    0,  0,    0,  0.0f,  0.0f },
+        {  -20, 10,   20, -0.4f,  0.2f },
+        {   20, 10,   40,  0.4f,  0.2f },
+        {    0,  0,   60,  0.0f,  0.0f },
+    };
+    static const float teapot[][5] = {
+        {    0,  0,    0,  0.0f,  0.0f },
+        {  -20,  0,   20, -0.3f,  0.0f },
+        {   20,  5,   30,  0.3f,  0.1f },
+        {    0,  0,   10,  0.0f,  0.0f },
+    };
+    const float (*keyframes)[5];
+    int amount;
+
+    switch(preset) {
+        case SCENE_CUBES:
+        case SCENE_CRATES:    keyframes = cubes;     amount = sizeof(cubes) / sizeof(cubes[0]);         break;
+        case SCENE_MOUNTAINS: keyframes = mountains; amount = sizeof(mountains) / sizeof(mountains[0]); break;
+        case SCENE_TEAPOT:    keyframes = teapot;    amount = sizeof(teapot) / sizeof(teapot[0]);       break;
+        default: return;
+    }
+
+    camerapath_init(path);
+    for(int i = 0; i < amount; i++) {
+        Vector position = vector_create(keyframes[i][0], keyframes[i][1], keyframes[i][2]);
+        camerapath_add(path, &position, keyframes[i][3], keyframes[i][4]);
+    }
+}
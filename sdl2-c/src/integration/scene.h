@@ -0,0 +1,27 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "../model/pipeline.h"
+#include "../model/camerapath.h"
+
+// Fixed scene presets used for benchmarking and regression runs.
+#define SCENE_CUBES       0     // cube.plg x24 laid out in a grid
+#define SCENE_MOUNTAINS   1     // mountains.obj
+#define SCENE_TEAPOT      2     // teapot.obj
+#define SCENE_CRATES      3     // crate.plg x24 (textured cube.plg) in the grid of cubes
+#define AMOUNT_OF_SCENES  4
+
+// Returns name of preset ("cubes", "mountains", "teapot", "crates").
+const char* scene_preset_name(int preset);
+
+// Finds preset from its name. Returns -1 if there is no such preset.
+int scene_preset_from_name(const char* name);
+
+// Loads objects of preset into objects (needs MAX_AMOUNT_OF_OBJECTS slots) and
+// fills scene with them, palette and light source. Returns 1 on success.
+int scene_load_preset(Scene* scene, Object* objects, RGBA* palette, int preset);
+
+// Fills path with the scripted camera path that is flown through preset.
+void scene_preset_camera_path(CameraPath* path, int preset);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+
+// High resolution monotonic timer that does not depend on SDL, so it can be
+// used by the headless backend and any tool that measures the pipeline.
+
+// Returns current monotonic time in nanoseconds.
+static inline uint64_t timer_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000ull) + (uint64_t) ts.tv_nsec;
+}
+
+// Converts nanoseconds into milliseconds.
+static inline double timer_ns_to_ms(uint64_t ns) {
+    return (double) ns / 1000000.0;
+}
+
+#endif
@@ -3,44 +3,77 @@
 #include "math/vector.h"
 #include <stdlib.h>
 
-// Initializes camera by finding position, direction, up 
-// and plane vectors, with these the pointAt and lookAt
-// matrices can be created.
+// Initializes camera at position looking along the z-axis and
+// builds the pointAt and lookAt matrices.
 Camera* camera_init(const Vector* position) {
     Camera* camera = malloc(sizeof(Camera));   
-    Vector locked_z = vector_create(0,0,1);
     camera->position     = vector_copy(position);
     camera->direction    = vector_create(0, 0, 1);
     camera->up           = vector_create(0, 1, 0);
-    camera->camera_plane = vector_create(1, 0, 0);
-
-    camera->pointAt = matrix_point_at(&camera->position, &locked_z, &camera->up);
-    camera->lookAt  = matrix_quick_lookat_inverse(&camera->pointAt);
-    camera->fYaw  = 0.0f;
-    camera->pitch = 0.0f;
+    camera->camera_plane = vector_create(-1, 0, 0);
+    camera->orientation  = quaternion_identity();
+    camera->dirty        = 1;
+    camera_update(camera);
     return camera;
 }
 
+// Moves camera to position.
+void camera_set_position(Camera* camera, const Vector* position) {
+    camera->position = vector_copy(position);
+    camera->dirty    = 1;
+}
+
+// Sets orientation of camera (normalized).
+void camera_set_orientation(Camera* camera, const Quaternion* orientation) {
+    camera->orientation = quaternion_normalize(orientation);
+    camera->dirty       = 1;
+}
+
+// Turns camera by yaw around the world y-axis and by pitch around its own x-axis.
+void camera_turn(Camera* camera, float yaw, float pitch) {
+    Vector x_axis = vector_create(1, 0, 0);
+    Quaternion q_yaw   = quaternion_from_axis_angle(&camera->up, yaw);
+    Quaternion q_pitch = quaternion_from_axis_angle(&x_axis, pitch);
+    Quaternion turned  = quaternion_mul(&q_yaw, &camera->orientation);
+    turned = quaternion_mul(&turned, &q_pitch);
+    camera_set_orientation(camera, &turned);
+}
+
+// Returns yaw and pitch of the camera orientation.
+void camera_yaw_pitch(const Camera* camera, float* yaw, float* pitch) {
+    quaternion_to_yaw_pitch(&camera->orientation, yaw, pitch);
+}
+
 // Update of Camera logistics.
-// To determine pointAt matrix 2 constant vectors (0,1,0) & (0,0,1) is used.
-// Only after this is the rotation applied to the world lookAt matrix.
+// Rebuilds direction, camera plane and the pointAt and lookAt matrices from
+// position and orientation, does nothing if camera did not change.
 void camera_update(Camera* camera) {
-    Matrix rotation_y = matrix_create_rotation_matrix_y(camera->fYaw);
-    Matrix rotation_x = matrix_create_rotation_matrix_x(camera->pitch);
+    if(!camera->dirty) {
+        return;
+    }
     Vector locked_z = vector_create(0, 0, 1);
-    //camera->up      = vector_create(0, 1, 0);
+    Quaternion inverse = quaternion_conjugate(&camera->orientation);
 
-    // calculate pointAt matrix and find inverse lookAt.
-    camera->pointAt = matrix_point_at(&camera->position, &locked_z, &camera->up);
-    camera->lookAt  = matrix_quick_lookat_inverse(&camera->pointAt);
+    // pointAt rotates camera into world and moves it to position, lookAt is
+    // the inverse: move by -position and rotate by the inverse orientation.
+    camera->pointAt = quaternion_to_matrix(&camera->orientation);
+    camera->pointAt.matrix[3][0] = camera->position.x;
+    camera->pointAt.matrix[3][1] = camera->position.y;
+    camera->pointAt.matrix[3][2] = camera->position.z;
 
-    // apply rotation onto lookAt matrix.
-    camera->direction = vector_matrix_mul(&locked_z, &rotation_y);
-    camera->lookAt = matrix_mul(&camera->lookAt, &rotation_y);
-    camera->lookAt = matrix_mul(&camera->lookAt, &rotation_x);
-    camera->direction.x = -camera->direction.x;
+    Vector offset = vector_negate(&camera->position);
+    camera->lookAt = quaternion_to_matrix(&inverse);
+    Vector translation = vector_matrix_mul(&offset, &camera->lookAt);
+    camera->lookAt.matrix[3][0] = translation.x;
+    camera->lookAt.matrix[3][1] = translation.y;
+    camera->lookAt.matrix[3][2] = translation.z;
+
+    // direction camera moves in stays horizontal (pitch is ignored).
+    Vector forward = quaternion_rotate(&camera->orientation, &locked_z);
+    forward.y = 0;
+    camera->direction = (forward.x != 0 || forward.z != 0) ? vector_normalize(&forward) : locked_z;
 
     // camera_plane perpendicular to direction
-    Matrix planerot = matrix_create_rotation_matrix_y((M_PI / 2));
-    camera->camera_plane = vector_matrix_mul(&camera->direction, &planerot);
-}
\ No newline at end of file
+    camera->camera_plane = vector_cross_product(&camera->direction, &camera->up);
+    camera->dirty = 0;
+}
@@ -1,31 +1,46 @@
 #include "math/vector.h"
 #include "math/matrix.h"
+#include "math/quaternion.h"
 #include <math.h>
 
 #ifndef CAMERA_H
 #define CAMERA_H
 
-// Camera consist of player position, direction 
+// Camera consist of player position, orientation, direction 
 // and a camera plane (perpendicular to direction).
+// position and orientation must be changed through camera_set_position,
+// camera_set_orientation and camera_turn, which mark the cached vectors and
+// matrices as dirty so camera_update only rebuilds them when needed.
 typedef struct {
     Vector position,       // position of camera (viewpoint
-           direction,      // direction camera is facing
+           direction,      // horizontal direction camera is facing
            camera_plane,   // plane perpendicular to direction
            up;             // constant up vector (0,1,0)
-    Matrix pointAt,        // point At matrix
-           lookAt;         // inverse look At matrix
-    float fYaw;             // rotation on Y-axis
-    float pitch;            // rotation on X-axis
+    Quaternion orientation; // rotation from camera to world (pitch, then yaw)
+    Matrix pointAt,        // point At matrix (camera to world)
+           lookAt;         // inverse look At matrix (world to camera)
+    int dirty;             // 1 if matrices do not match position and orientation
 }Camera;
 
-// Initializes camera by finding position, direction, up 
-// and plane vectors, with these the pointAt and lookAt
-// matrices can be created.
+// Initializes camera at position looking along the z-axis and
+// builds the pointAt and lookAt matrices.
 Camera* camera_init(const Vector* position);
 
+// Moves camera to position.
+void camera_set_position(Camera* camera, const Vector* position);
+
+// Sets orientation of camera (normalized).
+void camera_set_orientation(Camera* camera, const Quaternion* orientation);
+
+// Turns camera by yaw around the world y-axis and by pitch around its own x-axis.
+void camera_turn(Camera* camera, float yaw, float pitch);
+
+// Returns yaw and pitch of the camera orientation.
+void camera_yaw_pitch(const Camera* camera, float* yaw, float* pitch);
+
 // Update of Camera logistics.
-// To determine pointAt matrix 2 constant vectors (0,1,0) & (0,0,1) is used.
-// Only after this is the rotation applied to the world lookAt matrix.
+// Rebuilds direction, camera plane and the pointAt and lookAt matrices from
+// position and orientation, does nothing if camera did not change.
 void camera_update(Camera* camera);
 
-#endif
\ No newline at end of file
+#endif
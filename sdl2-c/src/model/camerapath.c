@@ -0,0 +1,104 @@
+#include "camerapath.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Initializes an empty camera path.
+void camerapath_init(CameraPath* path) {
+    path->num_keyframes = 0;
+    path->capacity      = 0;
+    path->keyframes     = NULL;
+}
+
+// Frees keyframes of camera path.
+void camerapath_free(CameraPath* path) {
+    free(path->keyframes);
+    camerapath_init(path);
+}
+
+// Appends keyframe to end of path, doubles capacity when full.
+void camerapath_add_pose(CameraPath* path, const Vector* position, const Quaternion* orientation) {
+    if(path->num_keyframes == path->capacity) {
+        path->capacity  = (path->capacity == 0) ? 16 : path->capacity * 2;
+        path->keyframes = realloc(path->keyframes, sizeof(Keyframe) * path->capacity);
+    }
+    path->keyframes[path->num_keyframes].position = vector_copy(position);
+    path->keyframes[path->num_keyframes].orientation = quaternion_normalize(orientation);
+    path->num_keyframes++;
+}
+
+// Places camera at position t (0 = first keyframe, 1 = last keyframe) along path
+// by interpolating between the two closest keyframes, position linearly and
+// orientation with slerp.
+void camerapath_apply(const CameraPath* path, float t, Camera* camera) {
+    if(path->num_keyframes == 0) {
+        return;
+    }
+    if(t < 0) { t = 0; }
+    if(t > 1) { t = 1; }
+
+    // find segment and how far along segment t lands.
+    float position = t * (path->num_keyframes - 1);
+    int   index    = (int) position;
+    if(index >= path->num_keyframes - 1) {
+        index = path->num_keyframes - 1;
+    }
+    float s = position - index;
+
+    const Keyframe* k0 = &path->keyframes[index];
+    const Keyframe* k1 = (index + 1 < path->num_keyframes) ? &path->keyframes[index + 1] : k0;
+
+    Vector location = vector_create(k0->position.x + (k1->position.x - k0->position.x) * s,
+                                    k0->position.y + (k1->position.y - k0->position.y) * s,
+                                    k0->position.z + (k1->position.z - k0->position.z) * s);
+    Quaternion orientation = quaternion_slerp(&k0->orientation, &k1->orientation, s);
+    camera_set_position(camera, &location);
+    camera_set_orientation(camera, &orientation);
+}
+
+// Loads path from text file, one keyframe per line: x y z fYaw pitch.
+// Lines starting with # are ignored. Returns 1 on success.
+int camerapath_load(CameraPath* path, const char* filename) {
+    FILE* fp;
+    char buffer[128];
+    float x, y, z, fYaw, pitch;
+
+    if((fp = fopen(filename, "r")) == NULL) {
+        printf("could not open file %s\n", filename);
+        return 0;
+    }
+    camerapath_init(path);
+    while(fgets(buffer, sizeof(buffer), fp) != NULL) {
+        if(buffer[0] == '#') {
+            continue;
+        }
+        if(sscanf(buffer, "%f %f %f %f %f", &x, &y, &z, &fYaw, &pitch) == 5) {
+            Vector position = vector_create(x, y, z);
+            camerapath_add(path, &position, fYaw, pitch);
+        }
+    }
+    fclose(fp);
+    return path->num_keyframes > 0;
+}
+
+// Saves path to text file in the same format as camerapath_load.
+// Returns 1 on success.
+int camerapath_save(const CameraPath* path, const char* filename) {
+    FILE* fp;
+    if((fp = fopen(filename, "w")) == NULL) {
+        printf("could not open file %s\n", filename);
+        return 0;
+    }
+    fprintf(fp, "# x y z fYaw pitch\n");
+    for(int i = 0; i < path->num_keyframes; i++) {
+        float fYaw, pitch;
+        quaternion_to_yaw_pitch(&path->keyframes[i].orientation, &fYaw, &pitch);
+        fprintf(fp, "%f %f %f %f %f\n",
+                path->keyframes[i].position.x,
+                path->keyframes[i].position.y,
+                path->keyframes[i].position.z,
+                fYaw,
+                pitch);
+    }
+    fclose(fp);
+    return 1;
+}
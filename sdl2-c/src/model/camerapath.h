@@ -0,0 +1,57 @@
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include "camera.h"
+#include "math/vector.h"
+#include "math/quaternion.h"
+
+// Keyframe structure.
+// A single recorded or scripted pose of the camera.
+typedef struct {
+    Vector     position;
+    Quaternion orientation;
+}Keyframe;
+
+// CameraPath structure.
+// List of keyframes that the camera is flown along instead of being
+// controlled by IO. Keyframes are evenly spaced over the length of the path.
+typedef struct {
+    int       num_keyframes;
+    int       capacity;
+    Keyframe* keyframes;
+}CameraPath;
+
+// Initializes an empty camera path.
+void camerapath_init(CameraPath* path);
+
+// Frees keyframes of camera path.
+void camerapath_free(CameraPath* path);
+
+// Appends keyframe to end of path.
+void camerapath_add_pose(CameraPath* path, const Vector* position, const Quaternion* orientation);
+
+// Appends keyframe given as yaw and pitch to end of path.
+static inline void camerapath_add(CameraPath* path, const Vector* position, float fYaw, float pitch) {
+    Quaternion orientation = quaternion_from_yaw_pitch(fYaw, pitch);
+    camerapath_add_pose(path, position, &orientation);
+}
+
+// Appends current pose of camera to end of path (recording).
+static inline void camerapath_record(CameraPath* path, const Camera* camera) {
+    camerapath_add_pose(path, &camera->position, &camera->orientation);
+}
+
+// Places camera at position t (0 = first keyframe, 1 = last keyframe) along path
+// by interpolating between the two closest keyframes, position linearly and
+// orientation with slerp.
+void camerapath_apply(const CameraPath* path, float t, Camera* camera);
+
+// Loads path from text file, one keyframe per line: x y z fYaw pitch.
+// Lines starting with # are ignored. Returns 1 on success.
+int camerapath_load(CameraPath* path, const char* filename);
+
+// Saves path to text file in the same format as camerapath_load.
+// Returns 1 on success.
+int camerapath_save(const CameraPath* path, const char* filename);
+
+#endif
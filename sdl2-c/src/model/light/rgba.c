@@ -9,8 +9,15 @@ void Load_palette(RGBA *palette, const int pal_length, const char *filename) {
         printf("Error opening file!\n");
         return;
     }
+    int a, b, g, r;
     for (int i = 0; i < pal_length; i++) {
-        fscanf(file, "%d %d %d %d", (int*) &palette[i].a, (int*) &palette[i].b, (int*) &palette[i].g, (int*) &palette[i].r);    
+        if(fscanf(file, "%d %d %d %d", &a, &b, &g, &r) != 4) {
+            break;
+        }
+        palette[i].a = a;
+        palette[i].b = b;
+        palette[i].g = g;
+        palette[i].r = r;
     }
     fclose(file);
 }
@@ -22,105 +29,118 @@ int palette_get_color(RGBA *palette, const int index) {
 
 }
 
+// Scratch streams of light(), grown when an object has more visible polygons
+// than any object before it. One normal per polygon, one vector to the light
+// source per corner (3 * polygon + corner).
+static struct {
+    int capacity;
+    int* polys;
+    Vertices normals;
+    Vertices to_source;
+    float* distances;
+} light_scratch;
+
+// Makes room for amount polygons in light_scratch. Returns 1 on success.
+static int light_scratch_reserve(int amount) {
+    if(amount <= light_scratch.capacity) {
+        return 1;
+    }
+    free(light_scratch.polys);
+    free(light_scratch.distances);
+    light_scratch.polys     = malloc(sizeof(int) * amount);
+    light_scratch.capacity  = 0;
+    if(light_scratch.polys == NULL ||
+       !vertices_allocate(&light_scratch.normals, amount) ||
+       !vertices_allocate(&light_scratch.to_source, 3 * amount)) {
+        printf("could not allocate light buffers (polys: %d)\n", amount);
+        return 0;
+    }
+    light_scratch.distances = aligned_alloc(VERTICES_ALIGN, sizeof(float) * light_scratch.to_source.capacity);
+    if(light_scratch.distances == NULL) {
+        printf("could not allocate light buffers (polys: %d)\n", amount);
+        return 0;
+    }
+    light_scratch.capacity = amount;
+    return 1;
+}
+
+// Shades visible polygons of object in camera coordinates, so light_source
+// must be transformed into camera coordinates as well.
+// Normals and distances to the light source are first gathered for all visible
+// polygons, then normalized and measured in one batch (vertices_normalize,
+// vertices_length with LIGHT_PRECISION) and finally turned into intensities.
 void light(Object *object, RGBA *palette, Vector *light_source, float ambient_light) {
     // we need to compute the normal of this polygon face, and recall
     // that the vertices should be in counter-clockwise order:
-    // u = p0->p1, v = p0->p2, n = u x v  sight = p0->source;
-    Vector u, v, normal, norm, sight, to_source;
-    int vertex_0, vertex_1, vertex_2;
+    // u = p0->p1, v = p0->p2, n = u x v  to_source = p0->source;
+    Vector u, v, normal, to_source, p0, p1, p2;
     const int point_light = 16;
-    float dp, mg, intensity;
+    float dp, intensity;
+    int amount = 0;
 
+    if(!light_scratch_reserve(object->num_polys)) {
+        return;
+    }
 
+    // Pass 1: normal of every visible polygon and vector from each of its
+    // first 3 corners to the light source.
     for(int curr_poly = 0; curr_poly < object->num_polys; curr_poly++) {
-        
-        // Intensity initalially set to ambient level.
-        intensity = ambient_light;
-        
         // Object is not visible.
-        if(object->polys[curr_poly].clipped || (!object->polys[curr_poly].active) ||
-         (!object->polys[curr_poly].visible)) { 
-            continue; 
+        if(object->poly_states[curr_poly].clipped || (!object->polys[curr_poly].active) ||
+         (!object->poly_states[curr_poly].visible)) {
+            continue;
         }
 
-        // extract vertex indices into master list, remember the polygons are 
+        // extract vertex indices into master list, remember the polygons are
         // NOT self contained, but based on the vertex list stored in the object itself.
-        vertex_0 = object->polys[curr_poly].vertex_list[0];
-        vertex_1 = object->polys[curr_poly].vertex_list[1];
-        vertex_2 = object->polys[curr_poly].vertex_list[2];
-
-
-        u = vector_sub(&object->vertices_world[vertex_0], &object->vertices_world[vertex_1]);
-        v = vector_sub(&object->vertices_world[vertex_0], &object->vertices_world[vertex_2]);
-        normal = vector_cross_product(&v, &u); // originally u x v but n grows in wrong direction then?
-        norm = vector_normalize(&normal);
-        to_source = vector_sub(&object->vertices_world[vertex_0], light_source);
-        dp = vector_dot_product(&norm, &to_source);
-
-        // Directional light hits object.
-        if(dp > 0) {
-            // now cos() = (w*v) / ||w|| ||v||
-            mg = vector_length(&norm) * vector_length(&to_source);
-            intensity += (point_light * (dp / mg));
-        } 
-        
-        if(intensity > 16) { intensity = 16; } 
-        object->polys[curr_poly].shade[0] = palette_get_color(palette, ((16 * (int) intensity) - 1));
-
-
-        // ###################################################################
-        
-        // Enligt chat: for eaech vertex, you average the normals of all the polygons
-        //              that share that vertex. (Run through vertex list?)
-        // For gouraud shading then we need to know intensity for each vertex.
-        vertex_0 = object->polys[curr_poly].vertex_list[1];
-        vertex_1 = object->polys[curr_poly].vertex_list[2];
-        vertex_2 = object->polys[curr_poly].vertex_list[0];
-
-
-        u = vector_sub(&object->vertices_world[vertex_0], &object->vertices_world[vertex_1]);
-        v = vector_sub(&object->vertices_world[vertex_0], &object->vertices_world[vertex_2]);
-        normal = vector_cross_product(&v, &u); // originally u x v but n grows in wrong direction then?
-        norm = vector_normalize(&normal);
-        to_source = vector_sub(&object->vertices_world[vertex_0], light_source);
-        dp = vector_dot_product(&norm, &to_source);
-
-        // Directional light hits object.
-        if(dp > 0) {
-            // now cos() = (w*v) / ||w|| ||v||
-            mg = vector_length(&norm) * vector_length(&to_source);
-            intensity += (point_light * (dp / mg));
-        } 
-
-        if(intensity > 16) { intensity = 16; } 
-        object->polys[curr_poly].shade[1] = palette_get_color(palette, ((16 * (int) intensity) - 1));
-
-
-        // For gouraud shading then we need to know intensity for each vertex.
-        vertex_0 = object->polys[curr_poly].vertex_list[2];
-        vertex_1 = object->polys[curr_poly].vertex_list[0];
-        vertex_2 = object->polys[curr_poly].vertex_list[1];
-
-
-        u = vector_sub(&object->vertices_world[vertex_0], &object->vertices_world[vertex_1]);
-        v = vector_sub(&object->vertices_world[vertex_0], &object->vertices_world[vertex_2]);
-        normal = vector_cross_product(&v, &u); // originally u x v but n grows in wrong direction then?
-        norm = vector_normalize(&normal);
-        to_source = vector_sub(&object->vertices_world[vertex_0], light_source);
-        dp = vector_dot_product(&norm, &to_source);
-
-        // Directional light hits object.
-        if(dp > 0) {
-            // now cos() = (w*v) / ||w|| ||v||
-            mg = vector_length(&norm) * vector_length(&to_source);
-            intensity += (point_light * (dp / mg));
-        } 
-
-        if(intensity > 16) { intensity = 16; } 
-        object->polys[curr_poly].shade[2] = palette_get_color(palette, ((16 * (int) intensity) - 1));
+        p0 = vertices_get(&object->vertices_camera, object->polys[curr_poly].vertex_list[0]);
+        p1 = vertices_get(&object->vertices_camera, object->polys[curr_poly].vertex_list[1]);
+        p2 = vertices_get(&object->vertices_camera, object->polys[curr_poly].vertex_list[2]);
+        u = vector_sub(&p0, &p1);
+        v = vector_sub(&p0, &p2);
+        // originally u x v but n grows in wrong direction then? Rotating the
+        // corners (p1,p2,p0), (p2,p0,p1) gives the very same normal.
+        normal = vector_cross_product(&v, &u);
+        vertices_set(&light_scratch.normals, amount, &normal);
+
+        to_source = vector_sub(&p0, light_source);
+        vertices_set(&light_scratch.to_source, 3 * amount, &to_source);
+        to_source = vector_sub(&p1, light_source);
+        vertices_set(&light_scratch.to_source, 3 * amount + 1, &to_source);
+        to_source = vector_sub(&p2, light_source);
+        vertices_set(&light_scratch.to_source, 3 * amount + 2, &to_source);
+
+        light_scratch.polys[amount++] = curr_poly;
+    }
+    if(amount == 0) {
+        return;
     }
-}
 
+    // Pass 2: batch normalize normals and measure distances to light source.
+    light_scratch.normals.count   = amount;
+    light_scratch.to_source.count = 3 * amount;
+    vertices_normalize(&light_scratch.normals, &light_scratch.normals, LIGHT_PRECISION);
+    vertices_length(&light_scratch.to_source, light_scratch.distances, LIGHT_PRECISION);
 
+    // Pass 3: intensity for each corner, accumulated over the corners for
+    // gouraud shading. Normal is of unit length, so cos() = (n*v) / ||v||.
+    for(int index = 0; index < amount; index++) {
+        int curr_poly = light_scratch.polys[index];
+        Vector norm = vertices_get(&light_scratch.normals, index);
 
+        // Intensity initalially set to ambient level.
+        intensity = ambient_light;
+        for(int corner = 0; corner < 3; corner++) {
+            to_source = vertices_get(&light_scratch.to_source, 3 * index + corner);
+            dp = vector_dot_product(&norm, &to_source);
 
+            // Directional light hits object.
+            if(dp > 0) {
+                intensity += (point_light * (dp / light_scratch.distances[3 * index + corner]));
+            }
+
+            if(intensity > 16) { intensity = 16; }
+            object->poly_states[curr_poly].shade[corner] = palette_get_color(palette, ((16 * (int) intensity) - 1));
+        }
+    }
+}
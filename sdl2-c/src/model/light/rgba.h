@@ -5,6 +5,9 @@
 #include "../camera.h"
 #include "../object/polygon.h"
 #include "../math/vector.h"
+#include "../math/vertices.h"
+
+#define LIGHT_PRECISION PRECISION_FAST  // precision of normals and distances in light()
 
 typedef struct {
     unsigned char a, b, g, r;
@@ -12,6 +15,11 @@ typedef struct {
 
 void Load_palette(RGBA *palette, const int pal_length, const char *filename);
 
+// Shades visible polygons of object in camera coordinates, so light_source
+// must be transformed into camera coordinates as well.
+// Normals and distances to the light source are first gathered for all visible
+// polygons, then normalized and measured in one batch (vertices_normalize,
+// vertices_length with LIGHT_PRECISION) and finally turned into intensities.
 void light(Object *object, RGBA *palette, Vector *light_source, float ambient_light);
 
 #endif
\ No newline at end of file
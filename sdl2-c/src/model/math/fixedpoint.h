@@ -0,0 +1,54 @@
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include <stdint.h>
+
+// 16.16 fixed point number (Lamothe style).
+// Upper 16 bits hold the signed integer part, lower 16 bits the fraction, so
+// values must stay within +-32767. Products and quotients go through 64 bits.
+typedef int32_t fixp16;
+
+#define FIXP16_SHIFT     16
+#define FIXP16_MAG       65536          // 1.0 in fixed point
+#define FIXP16_ROUND_UP  0x00008000     // 0.5 in fixed point
+#define FIXP16_MAX_INT   8191           // largest integer part that leaves room for stepping
+
+// Converts integer to fixed point.
+static inline fixp16 fixp16_from_int(int i) {
+    return (fixp16) ((uint32_t) i << FIXP16_SHIFT);
+}
+
+// Converts fixed point to integer, rounding towards negative infinity.
+static inline int fixp16_to_int(fixp16 f) {
+    return f >> FIXP16_SHIFT;
+}
+
+// Multiplies 2 fixed point numbers.
+static inline fixp16 fixp16_mul(fixp16 a, fixp16 b) {
+    return (fixp16) (((int64_t) a * b) >> FIXP16_SHIFT);
+}
+
+// Multiplies fixed point number with an integer, without the risk of
+// overflowing before the result is known.
+static inline fixp16 fixp16_mul_int(fixp16 a, int i) {
+    return (fixp16) ((int64_t) a * i);
+}
+
+// Divides 2 fixed point numbers (b must not be 0).
+static inline fixp16 fixp16_div(fixp16 a, fixp16 b) {
+    return (fixp16) (((int64_t) a * FIXP16_MAG) / b);
+}
+
+// Reciprocal 1/i of a non zero integer with 32 fraction bits, used to replace
+// several divisions by i with one division and some multiplications.
+static inline int64_t fixp16_reciprocal(int i) {
+    return ((int64_t) 1 << 32) / i;
+}
+
+// Multiplies fixed point number with a reciprocal from fixp16_reciprocal,
+// i.e a / i. a must be within +-2^30.
+static inline fixp16 fixp16_mul_reciprocal(fixp16 a, int64_t reciprocal) {
+    return (fixp16) ((a * reciprocal) >> 32);
+}
+
+#endif
@@ -307,9 +307,10 @@ Matrix matrix_quick_lookat_inverse(const Matrix* pointAt) {
     lookAt.matrix[2][2] = m22;
     lookAt.matrix[2][3] = 0;
 
-    lookAt.matrix[3][0] = -(m30*m00 + m31*m10 + m32*m20);
-    lookAt.matrix[3][1] = -(m30*m01 + m31*m11 + m32*m21);
-    lookAt.matrix[3][2] = -(m30*m02 + m31*m12 + m32*m22);
+    // translation is -position * transposed rotation, i.e dot with each row.
+    lookAt.matrix[3][0] = -(m30*m00 + m31*m01 + m32*m02);
+    lookAt.matrix[3][1] = -(m30*m10 + m31*m11 + m32*m12);
+    lookAt.matrix[3][2] = -(m30*m20 + m31*m21 + m32*m22);
     lookAt.matrix[3][3] = 1.0f;  
     return lookAt;
 }
@@ -0,0 +1,111 @@
+#include "quaternion.h"
+#include <math.h>
+
+// Creates rotation of angle_radian around axis (axis must be of unit length).
+Quaternion quaternion_from_axis_angle(const Vector* axis, float angle_radian) {
+    float s = sinf(angle_radian * 0.5f);
+    return (Quaternion) {cosf(angle_radian * 0.5f), axis->x * s, axis->y * s, axis->z * s};
+}
+
+// Creates camera style orientation: pitch around x-axis, then yaw around y-axis.
+Quaternion quaternion_from_yaw_pitch(float yaw, float pitch) {
+    Vector x_axis = vector_create(1, 0, 0);
+    Vector y_axis = vector_create(0, 1, 0);
+    Quaternion q_yaw   = quaternion_from_axis_angle(&y_axis, yaw);
+    Quaternion q_pitch = quaternion_from_axis_angle(&x_axis, pitch);
+    return quaternion_mul(&q_yaw, &q_pitch);
+}
+
+// Extracts yaw and pitch of an orientation without roll (inverse of
+// quaternion_from_yaw_pitch). The rotated z-axis is (cos(p)sin(y), -sin(p), cos(p)cos(y)).
+void quaternion_to_yaw_pitch(const Quaternion* q, float* yaw, float* pitch) {
+    Vector z_axis  = vector_create(0, 0, 1);
+    Vector forward = quaternion_rotate(q, &z_axis);
+    if(forward.y > 1)  { forward.y = 1; }
+    if(forward.y < -1) { forward.y = -1; }
+    *yaw   = atan2f(forward.x, forward.z);
+    *pitch = -asinf(forward.y);
+}
+
+// Multiplies 2 quaternions, the result rotates by q2 first and then by q1.
+Quaternion quaternion_mul(const Quaternion* q1, const Quaternion* q2) {
+    return (Quaternion) {
+        (q1->w * q2->w) - (q1->x * q2->x) - (q1->y * q2->y) - (q1->z * q2->z),
+        (q1->w * q2->x) + (q1->x * q2->w) + (q1->y * q2->z) - (q1->z * q2->y),
+        (q1->w * q2->y) - (q1->x * q2->z) + (q1->y * q2->w) + (q1->z * q2->x),
+        (q1->w * q2->z) + (q1->x * q2->y) - (q1->y * q2->x) + (q1->z * q2->w)
+    };
+}
+
+// Scales quaternion to unit length, removes drift after many multiplications.
+Quaternion quaternion_normalize(const Quaternion* q) {
+    float length = sqrtf(quaternion_dot(q, q));
+    if(length == 0) {
+        return quaternion_identity();
+    }
+    float inverse = 1.0f / length;
+    return (Quaternion) {q->w * inverse, q->x * inverse, q->y * inverse, q->z * inverse};
+}
+
+// Rotates vector by quaternion, v' = v + w*t + (q x t) with t = 2 * (q x v).
+Vector quaternion_rotate(const Quaternion* q, const Vector* v) {
+    Vector axis = vector_create(q->x, q->y, q->z);
+    Vector t    = vector_cross_product(&axis, v);
+    t = vector_scale(&t, 2);
+    Vector u    = vector_cross_product(&axis, &t);
+    return vector_create(v->x + (q->w * t.x) + u.x,
+                         v->y + (q->w * t.y) + u.y,
+                         v->z + (q->w * t.z) + u.z);
+}
+
+// Converts quaternion into a rotation matrix for row vectors, i.e
+// vector_matrix_mul(v, m) gives the same result as quaternion_rotate(q, v).
+// This is the transpose of the usual column vector rotation matrix.
+Matrix quaternion_to_matrix(const Quaternion* q) {
+    Matrix m = matrix_create_identity_matrix();
+    float xx = q->x * q->x, yy = q->y * q->y, zz = q->z * q->z;
+    float xy = q->x * q->y, xz = q->x * q->z, yz = q->y * q->z;
+    float wx = q->w * q->x, wy = q->w * q->y, wz = q->w * q->z;
+
+    m.matrix[0][0] = 1 - 2 * (yy + zz);
+    m.matrix[0][1] = 2 * (xy + wz);
+    m.matrix[0][2] = 2 * (xz - wy);
+    m.matrix[1][0] = 2 * (xy - wz);
+    m.matrix[1][1] = 1 - 2 * (xx + zz);
+    m.matrix[1][2] = 2 * (yz + wx);
+    m.matrix[2][0] = 2 * (xz + wy);
+    m.matrix[2][1] = 2 * (yz - wx);
+    m.matrix[2][2] = 1 - 2 * (xx + yy);
+    return m;
+}
+
+// Spherical linear interpolation from q1 (t = 0) to q2 (t = 1) along the
+// shortest arc with constant angular speed.
+Quaternion quaternion_slerp(const Quaternion* q1, const Quaternion* q2, float t) {
+    Quaternion end = *q2;
+    float cos_theta = quaternion_dot(q1, q2);
+    float s1, s2;
+
+    // q and -q are the same rotation, take the one on the shortest arc.
+    if(cos_theta < 0) {
+        cos_theta = -cos_theta;
+        end = (Quaternion) {-q2->w, -q2->x, -q2->y, -q2->z};
+    }
+    if(cos_theta > 0.9995f) {
+        // nearly parallel, sin(theta) goes to 0 so fall back to linear interpolation.
+        s1 = 1 - t;
+        s2 = t;
+    } else {
+        float theta     = acosf(cos_theta);
+        float sin_theta = sinf(theta);
+        s1 = sinf((1 - t) * theta) / sin_theta;
+        s2 = sinf(t * theta) / sin_theta;
+    }
+    Quaternion result = {
+        (s1 * q1->w) + (s2 * end.w),
+        (s1 * q1->x) + (s2 * end.x),
+        (s1 * q1->y) + (s2 * end.y),
+        (s1 * q1->z) + (s2 * end.z)
+    };
+    return quaternion_normalize(&result);
+}
@@ -0,0 +1,57 @@
+#ifndef QUATERNION_H
+#define QUATERNION_H
+
+#include "vector.h"
+#include "matrix.h"
+
+// Quaternion structure.
+// Unit quaternions hold an orientation (rotation) without the drift and gimbal
+// lock of accumulated Euler angles. w is the scalar part, x,y,z the vector part.
+// q rotates vector v as q * v * q^-1 (right handed, like vector_cross_product).
+typedef struct {
+    float w, x, y, z;
+}Quaternion;
+
+// Creates identity quaternion (no rotation).
+static inline Quaternion quaternion_identity(void) {
+    return (Quaternion) {1, 0, 0, 0};
+}
+
+// Conjugate of quaternion, for unit quaternions this is the inverse rotation.
+static inline Quaternion quaternion_conjugate(const Quaternion* q) {
+    return (Quaternion) {q->w, -q->x, -q->y, -q->z};
+}
+
+// Dot product of 2 quaternions (cosine of half the angle between them).
+static inline float quaternion_dot(const Quaternion* q1, const Quaternion* q2) {
+    return (q1->w * q2->w) + (q1->x * q2->x) + (q1->y * q2->y) + (q1->z * q2->z);
+}
+
+// Creates rotation of angle_radian around axis (axis must be of unit length).
+Quaternion quaternion_from_axis_angle(const Vector* axis, float angle_radian);
+
+// Creates camera style orientation: pitch around x-axis, then yaw around y-axis.
+Quaternion quaternion_from_yaw_pitch(float yaw, float pitch);
+
+// Extracts yaw and pitch of an orientation without roll (inverse of
+// quaternion_from_yaw_pitch).
+void quaternion_to_yaw_pitch(const Quaternion* q, float* yaw, float* pitch);
+
+// Multiplies 2 quaternions, the result rotates by q2 first and then by q1.
+Quaternion quaternion_mul(const Quaternion* q1, const Quaternion* q2);
+
+// Scales quaternion to unit length, removes drift after many multiplications.
+Quaternion quaternion_normalize(const Quaternion* q);
+
+// Rotates vector by quaternion.
+Vector quaternion_rotate(const Quaternion* q, const Vector* v);
+
+// Converts quaternion into a rotation matrix for row vectors, i.e
+// vector_matrix_mul(v, m) gives the same result as quaternion_rotate(q, v).
+Matrix quaternion_to_matrix(const Quaternion* q);
+
+// Spherical linear interpolation from q1 (t = 0) to q2 (t = 1) along the
+// shortest arc with constant angular speed.
+Quaternion quaternion_slerp(const Quaternion* q1, const Quaternion* q2, float t);
+
+#endif
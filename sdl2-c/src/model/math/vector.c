@@ -1,20 +1,22 @@
 #include "vector.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 
 /**
 * Carmack's Inverse Square root
+* Bits are copied with memcpy, casting the pointer breaks strict aliasing.
 * @return square root of number. */
 float d_sqrt(float number)  {
-    int i;
+    uint32_t i;
     float x,y;
-    x = number * 0.5;
-    y = number;
-    i = *(int*) &y;
+    x = number * 0.5f;
+    memcpy(&i, &number, sizeof(i));
     i = 0x5f3759df - (i >> 1);
-    y = * (float*) &i;
-    y = y * (1.5 - (x * y * y));
-    y = y * (1.5 - (x * y * y));
+    memcpy(&y, &i, sizeof(y));
+    y = y * (1.5f - (x * y * y));
+    y = y * (1.5f - (x * y * y));
     return number * y;
 }
 
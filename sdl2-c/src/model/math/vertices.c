@@ -0,0 +1,346 @@
+#include "vertices.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VERTICES_X86 1
+#include <immintrin.h>
+#endif
+
+// Kernel in use, resolved on first use when still TRANSFORM_AUTO.
+static int transform_kernel = TRANSFORM_AUTO;
+
+// Allocates streams for count vertices, all set to 0.
+// Streams of v are freed first, so v must either be zeroed or allocated before.
+// Returns 1 on success.
+int vertices_allocate(Vertices* v, int count) {
+    int capacity = (count > 0) ? count : 1;
+    capacity = (capacity + VERTICES_PAD - 1) / VERTICES_PAD * VERTICES_PAD;
+
+    vertices_free(v);
+    // one block for all three streams, capacity keeps each of them aligned.
+    float* block = aligned_alloc(VERTICES_ALIGN, sizeof(float) * 3 * capacity);
+    if(block == NULL) {
+        printf("could not allocate vertices (verts: %d)\n", count);
+        return 0;
+    }
+    memset(block, 0, sizeof(float) * 3 * capacity);
+    v->x        = block;
+    v->y        = block + capacity;
+    v->z        = block + 2 * capacity;
+    v->count    = count;
+    v->capacity = capacity;
+    return 1;
+}
+
+// Frees streams and sets them to NULL.
+void vertices_free(Vertices* v) {
+    free(v->x);
+    v->x = NULL;
+    v->y = NULL;
+    v->z = NULL;
+    v->count    = 0;
+    v->capacity = 0;
+}
+
+// Copies vertices of src into dst, dst must have been allocated with the same count.
+void vertices_copy(Vertices* dst, const Vertices* src) {
+    memcpy(dst->x, src->x, sizeof(float) * src->count);
+    memcpy(dst->y, src->y, sizeof(float) * src->count);
+    memcpy(dst->z, src->z, sizeof(float) * src->count);
+}
+
+/* Scalar kernels, operation order matches vector_matrix_mul so all kernels give
+   the same result bit for bit (no fused multiply add). */
+
+static void transform_scalar(const Vertices* in, Vertices* out, const Matrix* m) {
+    for(int i = 0; i < in->count; i++) {
+        float x = in->x[i], y = in->y[i], z = in->z[i];
+        out->x[i] = (x * m->matrix[0][0]) + (y * m->matrix[1][0]) + (z * m->matrix[2][0]) + m->matrix[3][0];
+        out->y[i] = (x * m->matrix[0][1]) + (y * m->matrix[1][1]) + (z * m->matrix[2][1]) + m->matrix[3][1];
+        out->z[i] = (x * m->matrix[0][2]) + (y * m->matrix[1][2]) + (z * m->matrix[2][2]) + m->matrix[3][2];
+    }
+}
+
+static void translate_scalar(const Vertices* in, Vertices* out, const Vector* t) {
+    for(int i = 0; i < in->count; i++) {
+        out->x[i] = in->x[i] + t->x;
+        out->y[i] = in->y[i] + t->y;
+        out->z[i] = in->z[i] + t->z;
+    }
+}
+
+// Reciprocal square root, fast mode uses the well known bit level estimate
+// (bits are copied with memcpy, no pointer type punning) and 2 Newton steps.
+static inline float rsqrt_scalar(float number, int precision) {
+    if(precision == PRECISION_EXACT) {
+        return 1.0f / sqrtf(number);
+    }
+    uint32_t i;
+    float y;
+    memcpy(&i, &number, sizeof(i));
+    i = 0x5f3759df - (i >> 1);
+    memcpy(&y, &i, sizeof(y));
+    y = y * (1.5f - (0.5f * number * y * y));
+    y = y * (1.5f - (0.5f * number * y * y));
+    return y;
+}
+
+static void length_scalar(const Vertices* in, float* out, int precision) {
+    for(int i = 0; i < in->count; i++) {
+        float square = (in->x[i] * in->x[i]) + (in->y[i] * in->y[i]) + (in->z[i] * in->z[i]);
+        out[i] = (square > 0) ? square * rsqrt_scalar(square, precision) : 0;
+    }
+}
+
+static void normalize_scalar(const Vertices* in, Vertices* out, int precision) {
+    for(int i = 0; i < in->count; i++) {
+        float square = (in->x[i] * in->x[i]) + (in->y[i] * in->y[i]) + (in->z[i] * in->z[i]);
+        float inverse = (square > 0) ? rsqrt_scalar(square, precision) : 0;
+        out->x[i] = in->x[i] * inverse;
+        out->y[i] = in->y[i] * inverse;
+        out->z[i] = in->z[i] * inverse;
+    }
+}
+
+#ifdef VERTICES_X86
+
+/* SSE kernels, 4 vertices at a time. Streams are padded so the last block may
+   run over count but never over capacity. */
+
+__attribute__((target("sse")))
+static void transform_sse(const Vertices* in, Vertices* out, const Matrix* m) {
+    __m128 m00 = _mm_set1_ps(m->matrix[0][0]), m01 = _mm_set1_ps(m->matrix[0][1]), m02 = _mm_set1_ps(m->matrix[0][2]);
+    __m128 m10 = _mm_set1_ps(m->matrix[1][0]), m11 = _mm_set1_ps(m->matrix[1][1]), m12 = _mm_set1_ps(m->matrix[1][2]);
+    __m128 m20 = _mm_set1_ps(m->matrix[2][0]), m21 = _mm_set1_ps(m->matrix[2][1]), m22 = _mm_set1_ps(m->matrix[2][2]);
+    __m128 m30 = _mm_set1_ps(m->matrix[3][0]), m31 = _mm_set1_ps(m->matrix[3][1]), m32 = _mm_set1_ps(m->matrix[3][2]);
+
+    for(int i = 0; i < in->count; i += 4) {
+        __m128 x = _mm_load_ps(&in->x[i]);
+        __m128 y = _mm_load_ps(&in->y[i]);
+        __m128 z = _mm_load_ps(&in->z[i]);
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m00), _mm_mul_ps(y, m10)), _mm_mul_ps(z, m20)), m30);
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m01), _mm_mul_ps(y, m11)), _mm_mul_ps(z, m21)), m31);
+        __m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m02), _mm_mul_ps(y, m12)), _mm_mul_ps(z, m22)), m32);
+        _mm_store_ps(&out->x[i], rx);
+        _mm_store_ps(&out->y[i], ry);
+        _mm_store_ps(&out->z[i], rz);
+    }
+}
+
+__attribute__((target("sse")))
+static void translate_sse(const Vertices* in, Vertices* out, const Vector* t) {
+    __m128 tx = _mm_set1_ps(t->x), ty = _mm_set1_ps(t->y), tz = _mm_set1_ps(t->z);
+    for(int i = 0; i < in->count; i += 4) {
+        _mm_store_ps(&out->x[i], _mm_add_ps(_mm_load_ps(&in->x[i]), tx));
+        _mm_store_ps(&out->y[i], _mm_add_ps(_mm_load_ps(&in->y[i]), ty));
+        _mm_store_ps(&out->z[i], _mm_add_ps(_mm_load_ps(&in->z[i]), tz));
+    }
+}
+
+// Reciprocal square root of 4 squares, 0 where square is 0. Fast mode refines
+// the 12 bit rsqrtps estimate with one Newton step: y = y * (1.5 - 0.5 * s * y * y).
+__attribute__((target("sse")))
+static inline __m128 rsqrt_sse(__m128 square, int precision) {
+    __m128 y;
+    if(precision == PRECISION_EXACT) {
+        y = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(square));
+    } else {
+        y = _mm_rsqrt_ps(square);
+        y = _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f),
+                       _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), square), _mm_mul_ps(y, y))));
+    }
+    return _mm_and_ps(y, _mm_cmpgt_ps(square, _mm_setzero_ps()));
+}
+
+__attribute__((target("sse")))
+static void length_sse(const Vertices* in, float* out, int precision) {
+    for(int i = 0; i < in->count; i += 4) {
+        __m128 x = _mm_load_ps(&in->x[i]), y = _mm_load_ps(&in->y[i]), z = _mm_load_ps(&in->z[i]);
+        __m128 square = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        __m128 length = (precision == PRECISION_EXACT) ? _mm_sqrt_ps(square)
+                                                       : _mm_mul_ps(square, rsqrt_sse(square, precision));
+        _mm_store_ps(&out[i], length);
+    }
+}
+
+__attribute__((target("sse")))
+static void normalize_sse(const Vertices* in, Vertices* out, int precision) {
+    for(int i = 0; i < in->count; i += 4) {
+        __m128 x = _mm_load_ps(&in->x[i]), y = _mm_load_ps(&in->y[i]), z = _mm_load_ps(&in->z[i]);
+        __m128 square  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        __m128 inverse = rsqrt_sse(square, precision);
+        _mm_store_ps(&out->x[i], _mm_mul_ps(x, inverse));
+        _mm_store_ps(&out->y[i], _mm_mul_ps(y, inverse));
+        _mm_store_ps(&out->z[i], _mm_mul_ps(z, inverse));
+    }
+}
+
+/* AVX kernels, 8 vertices at a time. */
+
+__attribute__((target("avx")))
+static void transform_avx(const Vertices* in, Vertices* out, const Matrix* m) {
+    __m256 m00 = _mm256_set1_ps(m->matrix[0][0]), m01 = _mm256_set1_ps(m->matrix[0][1]), m02 = _mm256_set1_ps(m->matrix[0][2]);
+    __m256 m10 = _mm256_set1_ps(m->matrix[1][0]), m11 = _mm256_set1_ps(m->matrix[1][1]), m12 = _mm256_set1_ps(m->matrix[1][2]);
+    __m256 m20 = _mm256_set1_ps(m->matrix[2][0]), m21 = _mm256_set1_ps(m->matrix[2][1]), m22 = _mm256_set1_ps(m->matrix[2][2]);
+    __m256 m30 = _mm256_set1_ps(m->matrix[3][0]), m31 = _mm256_set1_ps(m->matrix[3][1]), m32 = _mm256_set1_ps(m->matrix[3][2]);
+
+    for(int i = 0; i < in->count; i += 8) {
+        __m256 x = _mm256_load_ps(&in->x[i]);
+        __m256 y = _mm256_load_ps(&in->y[i]);
+        __m256 z = _mm256_load_ps(&in->z[i]);
+        __m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m00), _mm256_mul_ps(y, m10)), _mm256_mul_ps(z, m20)), m30);
+        __m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m01), _mm256_mul_ps(y, m11)), _mm256_mul_ps(z, m21)), m31);
+        __m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m02), _mm256_mul_ps(y, m12)), _mm256_mul_ps(z, m22)), m32);
+        _mm256_store_ps(&out->x[i], rx);
+        _mm256_store_ps(&out->y[i], ry);
+        _mm256_store_ps(&out->z[i], rz);
+    }
+}
+
+__attribute__((target("avx")))
+static void translate_avx(const Vertices* in, Vertices* out, const Vector* t) {
+    __m256 tx = _mm256_set1_ps(t->x), ty = _mm256_set1_ps(t->y), tz = _mm256_set1_ps(t->z);
+    for(int i = 0; i < in->count; i += 8) {
+        _mm256_store_ps(&out->x[i], _mm256_add_ps(_mm256_load_ps(&in->x[i]), tx));
+        _mm256_store_ps(&out->y[i], _mm256_add_ps(_mm256_load_ps(&in->y[i]), ty));
+        _mm256_store_ps(&out->z[i], _mm256_add_ps(_mm256_load_ps(&in->z[i]), tz));
+    }
+}
+
+__attribute__((target("avx")))
+static inline __m256 rsqrt_avx(__m256 square, int precision) {
+    __m256 y;
+    if(precision == PRECISION_EXACT) {
+        y = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(square));
+    } else {
+        y = _mm256_rsqrt_ps(square);
+        y = _mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(1.5f),
+                          _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), square), _mm256_mul_ps(y, y))));
+    }
+    return _mm256_and_ps(y, _mm256_cmp_ps(square, _mm256_setzero_ps(), _CMP_GT_OQ));
+}
+
+__attribute__((target("avx")))
+static void length_avx(const Vertices* in, float* out, int precision) {
+    for(int i = 0; i < in->count; i += 8) {
+        __m256 x = _mm256_load_ps(&in->x[i]), y = _mm256_load_ps(&in->y[i]), z = _mm256_load_ps(&in->z[i]);
+        __m256 square = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+        __m256 length = (precision == PRECISION_EXACT) ? _mm256_sqrt_ps(square)
+                                                       : _mm256_mul_ps(square, rsqrt_avx(square, precision));
+        _mm256_store_ps(&out[i], length);
+    }
+}
+
+__attribute__((target("avx")))
+static void normalize_avx(const Vertices* in, Vertices* out, int precision) {
+    for(int i = 0; i < in->count; i += 8) {
+        __m256 x = _mm256_load_ps(&in->x[i]), y = _mm256_load_ps(&in->y[i]), z = _mm256_load_ps(&in->z[i]);
+        __m256 square  = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+        __m256 inverse = rsqrt_avx(square, precision);
+        _mm256_store_ps(&out->x[i], _mm256_mul_ps(x, inverse));
+        _mm256_store_ps(&out->y[i], _mm256_mul_ps(y, inverse));
+        _mm256_store_ps(&out->z[i], _mm256_mul_ps(z, inverse));
+    }
+}
+
+#endif
+
+// Returns 1 if CPU (and compiler) support kernel.
+int vertices_kernel_supported(int kernel) {
+    switch(kernel) {
+        case TRANSFORM_SCALAR:
+            return 1;
+#ifdef VERTICES_X86
+        case TRANSFORM_SSE:
+            return __builtin_cpu_supports("sse");
+        case TRANSFORM_AVX:
+            return __builtin_cpu_supports("avx");
+#endif
+        default:
+            return 0;
+    }
+}
+
+// Selects kernel used by vertices_transform, vertices_translate,
+// vertices_length and vertices_normalize.
+// TRANSFORM_AUTO (default) picks the best kernel the CPU supports, a kernel
+// that is not supported falls back to the best supported one.
+// Returns the kernel that is used from now on.
+int vertices_set_kernel(int kernel) {
+    if(kernel == TRANSFORM_AUTO || !vertices_kernel_supported(kernel)) {
+        kernel = TRANSFORM_AVX;
+        while(!vertices_kernel_supported(kernel)) {
+            kernel--;
+        }
+    }
+    transform_kernel = kernel;
+    return transform_kernel;
+}
+
+// Returns kernel currently in use (detects CPU on first call).
+int vertices_kernel(void) {
+    if(transform_kernel == TRANSFORM_AUTO) {
+        vertices_set_kernel(TRANSFORM_AUTO);
+    }
+    return transform_kernel;
+}
+
+// Returns printable name of kernel ("scalar", "sse", "avx").
+const char* vertices_kernel_name(int kernel) {
+    switch(kernel) {
+        case TRANSFORM_SCALAR: return "scalar";
+        case TRANSFORM_SSE:    return "sse";
+        case TRANSFORM_AVX:    return "avx";
+        default:               return "auto";
+    }
+}
+
+// Transforms every vertex of in as a row vector (w = 1) by m into out, i.e
+// the same as vector_matrix_mul for each vertex. in and out may be the same.
+void vertices_transform(const Vertices* in, Vertices* out, const Matrix* m) {
+    switch(vertices_kernel()) {
+#ifdef VERTICES_X86
+        case TRANSFORM_AVX: transform_avx(in, out, m); break;
+        case TRANSFORM_SSE: transform_sse(in, out, m); break;
+#endif
+        default:            transform_scalar(in, out, m); break;
+    }
+}
+
+// Adds t to every vertex of in and writes result into out. in and out may be the same.
+void vertices_translate(const Vertices* in, Vertices* out, const Vector* t) {
+    switch(vertices_kernel()) {
+#ifdef VERTICES_X86
+        case TRANSFORM_AVX: translate_avx(in, out, t); break;
+        case TRANSFORM_SSE: translate_sse(in, out, t); break;
+#endif
+        default:            translate_scalar(in, out, t); break;
+    }
+}
+
+// Writes length of every vector of in into out, out must hold in->capacity floats
+// and be aligned to VERTICES_ALIGN.
+void vertices_length(const Vertices* in, float* out, int precision) {
+    switch(vertices_kernel()) {
+#ifdef VERTICES_X86
+        case TRANSFORM_AVX: length_avx(in, out, precision); break;
+        case TRANSFORM_SSE: length_sse(in, out, precision); break;
+#endif
+        default:            length_scalar(in, out, precision); break;
+    }
+}
+
+// Normalizes every vector of in into out (zero vectors stay zero). in and out may be the same.
+void vertices_normalize(const Vertices* in, Vertices* out, int precision) {
+    switch(vertices_kernel()) {
+#ifdef VERTICES_X86
+        case TRANSFORM_AVX: normalize_avx(in, out, precision); break;
+        case TRANSFORM_SSE: normalize_sse(in, out, precision); break;
+#endif
+        default:            normalize_scalar(in, out, precision); break;
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef VERTICES_H
+#define VERTICES_H
+
+#include "vector.h"
+#include "matrix.h"
+
+#define VERTICES_ALIGN 32           // byte alignment of each stream (AVX register)
+#define VERTICES_PAD   8            // streams are padded to a multiple of this many floats
+
+#define TRANSFORM_SCALAR 0          // plain C, works everywhere
+#define TRANSFORM_SSE    1          // 4 vertices per instruction
+#define TRANSFORM_AVX    2          // 8 vertices per instruction
+#define TRANSFORM_AUTO   -1         // best kernel supported by the CPU
+
+#define PRECISION_FAST   0          // reciprocal square root estimate + one Newton step (~1e-7 relative)
+#define PRECISION_EXACT  1          // correctly rounded square root and division
+
+// Vertices structure (structure of arrays).
+// Separate x, y and z streams of count vertices, each aligned to VERTICES_ALIGN
+// and padded (with zeros) to capacity so kernels never need a scalar tail.
+typedef struct {
+    int    count;
+    int    capacity;
+    float* x;
+    float* y;
+    float* z;
+}Vertices;
+
+// Allocates streams for count vertices, all set to 0.
+// Streams of v are freed first, so v must either be zeroed or allocated before.
+// Returns 1 on success.
+int vertices_allocate(Vertices* v, int count);
+
+// Frees streams and sets them to NULL.
+void vertices_free(Vertices* v);
+
+// Copies vertices of src into dst, dst must have been allocated with the same count.
+void vertices_copy(Vertices* dst, const Vertices* src);
+
+// Returns vertex i as a Vector.
+static inline Vector vertices_get(const Vertices* v, int i) {
+    Vector vector = { v->x[i], v->y[i], v->z[i] };
+    return vector;
+}
+
+// Sets vertex i from a Vector.
+static inline void vertices_set(Vertices* v, int i, const Vector* vector) {
+    v->x[i] = vector->x; v->y[i] = vector->y; v->z[i] = vector->z;
+}
+
+// Transforms every vertex of in as a row vector (w = 1) by m into out, i.e
+// the same as vector_matrix_mul for each vertex. in and out may be the same.
+void vertices_transform(const Vertices* in, Vertices* out, const Matrix* m);
+
+// Adds t to every vertex of in and writes result into out. in and out may be the same.
+void vertices_translate(const Vertices* in, Vertices* out, const Vector* t);
+
+// Writes length of every vector of in into out, out must hold in->capacity floats
+// and be aligned to VERTICES_ALIGN.
+void vertices_length(const Vertices* in, float* out, int precision);
+
+// Normalizes every vector of in into out (zero vectors stay zero). in and out may be the same.
+void vertices_normalize(const Vertices* in, Vertices* out, int precision);
+
+// Selects kernel used by vertices_transform, vertices_translate,
+// vertices_length and vertices_normalize.
+// TRANSFORM_AUTO (default) picks the best kernel the CPU supports, a kernel
+// that is not supported falls back to the best supported one.
+// Returns the kernel that is used from now on.
+int vertices_set_kernel(int kernel);
+
+// Returns kernel currently in use (detects CPU on first call).
+int vertices_kernel(void);
+
+// Returns 1 if CPU (and compiler) support kernel.
+int vertices_kernel_supported(int kernel);
+
+// Returns printable name of kernel ("scalar", "sse", "avx").
+const char* vertices_kernel_name(int kernel);
+
+#endif
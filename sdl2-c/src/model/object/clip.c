@@ -1,11 +1,12 @@
 #include "polygon.h"
+#include <string.h>
 
 
 
 
 // Removes backfaces meaning that the method determines if polygons are invisible or clipped from
 // the current viewpoint, and thus only draws relevant polygons. Relevant polygons of object are
-// also colored and shaded.
+// also colored and shaded. view_point is in camera coordinates, i.e (0,0,0).
 void remove_backfaces(Object* object, Vector* view_point, int mode) {
     // this function removes all the backfaces of a n object by setting the removed
     // flag. This function assumes that the object has been transformed into 
@@ -18,7 +19,8 @@ void remove_backfaces(Object* object, Vector* view_point, int mode) {
     float dp;           // the result of the dot product
     Vector u,v,         // general working vectors
            normal,      // the normal to the surface being processed
-           sight;       // line of sight vector
+           sight,       // line of sight vector
+           p0,p1,p2;    // polygon vertices in camera coordinates
 
     // for each polygon in the object determine if it is pointing away from the
     // viewpoint and direction
@@ -31,36 +33,39 @@ void remove_backfaces(Object* object, Vector* view_point, int mode) {
             vertex_2 = object->polys[curr_poly].vertex_list[2];
 
             // the vector u = v0->v1 and vector v = v0->v2
-            u = vector_sub(&object->vertices_world[vertex_0], &object->vertices_world[vertex_1]);
-            v = vector_sub(&object->vertices_world[vertex_0], &object->vertices_world[vertex_2]);
+            p0 = vertices_get(&object->vertices_camera, vertex_0);
+            p1 = vertices_get(&object->vertices_camera, vertex_1);
+            p2 = vertices_get(&object->vertices_camera, vertex_2);
+            u = vector_sub(&p0, &p1);
+            v = vector_sub(&p0, &p2);
 
             // compute the normal to polygon v x u
             normal = vector_cross_product(&v, &u);
 
-            // compute the line of sight vector, since all coordinates are world all
+            // compute the line of sight vector, since all coordinates are camera all
             // object vertices are already relative to (0,0,0) thus
-            sight.x = view_point->x - object->vertices_world[vertex_0].x;
-            sight.y = view_point->y - object->vertices_world[vertex_0].y;
-            sight.z = view_point->z - object->vertices_world[vertex_0].z;
+            sight.x = view_point->x - object->vertices_camera.x[vertex_0];
+            sight.y = view_point->y - object->vertices_camera.y[vertex_0];
+            sight.z = view_point->z - object->vertices_camera.z[vertex_0];
 
             // compute the dot product between line of sight vector and normal to surface
             dp = vector_dot_product(&normal, &sight);
 
             if(object->polys[curr_poly].two_sided == 0) {
                 // set the clip flagged appropriately
-                if(dp>0) object->polys[curr_poly].visible = 1;
-                else     object->polys[curr_poly].visible = 0; // set invisible flag
+                if(dp>0) object->poly_states[curr_poly].visible = 1;
+                else     object->poly_states[curr_poly].visible = 0; // set invisible flag
             }
             else {
                 // Object is two sided. Which means that it is always visible
-                object->polys[curr_poly].visible = 1;
+                object->poly_states[curr_poly].visible = 1;
             }
         }
         else {
             // else polygon is always visible i.e. two sided, set visibility flag
             // so negine renders it. Should produce copy of wall with everything inverted
             // and then produce 1 extra facet and reset two_sided to 1. 
-            object->polys[curr_poly].visible = 1;
+            object->poly_states[curr_poly].visible = 1;
 
         } // end else two sided
     } // end for curr_poly
@@ -147,17 +152,17 @@ void clip_object_3D(Object* object, int mode) {
         for(curr_poly = 0; curr_poly < object->num_polys; curr_poly++) {
             // reset clipped variable
             // otherwise once clipped object will always be clipped.
-            object->polys[curr_poly].clipped = 0;
+            object->poly_states[curr_poly].clipped = 0;
 
             // extract z components
-            z1 = object->vertices_camera[object->polys[curr_poly].vertex_list[0]].z;
-            z2 = object->vertices_camera[object->polys[curr_poly].vertex_list[1]].z;
-            z3 = object->vertices_camera[object->polys[curr_poly].vertex_list[2]].z;
+            z1 = object->vertices_camera.z[object->polys[curr_poly].vertex_list[0]];
+            z2 = object->vertices_camera.z[object->polys[curr_poly].vertex_list[1]];
+            z3 = object->vertices_camera.z[object->polys[curr_poly].vertex_list[2]];
 
             // est if this is a quad
             if(object->polys[curr_poly].num_points == 4) {
                 // extract 4th z component
-                z4 = object->vertices_camera[object->polys[curr_poly].vertex_list[3]].z;
+                z4 = object->vertices_camera.z[object->polys[curr_poly].vertex_list[3]];
             } else {
                 z4 = z3;
             }
@@ -166,7 +171,7 @@ void clip_object_3D(Object* object, int mode) {
             if( (z1 < CLIP_NEAR_Z && z2 < CLIP_NEAR_Z && z3 < CLIP_NEAR_Z && z4 < CLIP_NEAR_Z) ||
                 (z1 > CLIP_FAR_Z && z2 > CLIP_FAR_Z && z3 > CLIP_FAR_Z && z4 > CLIP_FAR_Z)) {
                 // set clipped flag
-                object->polys[curr_poly].clipped = 1;
+                object->poly_states[curr_poly].clipped = 1;
             }
         } // end for curr_poly
     }
@@ -175,33 +180,33 @@ void clip_object_3D(Object* object, int mode) {
         for(curr_poly = 0; curr_poly < object->num_polys; curr_poly++) {
             // reset clipped variable
             // otherwise once clipped object will always be clipped.
-            object->polys[curr_poly].clipped = 0;
+            object->poly_states[curr_poly].clipped = 0;
 
             // extract x,y and z components
-            x1 = object->vertices_camera[object->polys[curr_poly].vertex_list[0]].x;
-            y1 = object->vertices_camera[object->polys[curr_poly].vertex_list[0]].y;
-            z1 = object->vertices_camera[object->polys[curr_poly].vertex_list[0]].z;
+            x1 = object->vertices_camera.x[object->polys[curr_poly].vertex_list[0]];
+            y1 = object->vertices_camera.y[object->polys[curr_poly].vertex_list[0]];
+            z1 = object->vertices_camera.z[object->polys[curr_poly].vertex_list[0]];
 
-            x2 = object->vertices_camera[object->polys[curr_poly].vertex_list[1]].x;
-            y2 = object->vertices_camera[object->polys[curr_poly].vertex_list[1]].y;
-            z2 = object->vertices_camera[object->polys[curr_poly].vertex_list[1]].z;
+            x2 = object->vertices_camera.x[object->polys[curr_poly].vertex_list[1]];
+            y2 = object->vertices_camera.y[object->polys[curr_poly].vertex_list[1]];
+            z2 = object->vertices_camera.z[object->polys[curr_poly].vertex_list[1]];
 
-            x3 = object->vertices_camera[object->polys[curr_poly].vertex_list[2]].x;
-            y3 = object->vertices_camera[object->polys[curr_poly].vertex_list[2]].y;
-            z3 = object->vertices_camera[object->polys[curr_poly].vertex_list[2]].z;
+            x3 = object->vertices_camera.x[object->polys[curr_poly].vertex_list[2]];
+            y3 = object->vertices_camera.y[object->polys[curr_poly].vertex_list[2]];
+            z3 = object->vertices_camera.z[object->polys[curr_poly].vertex_list[2]];
 
             // test if this is a quad
             if(object->polys[curr_poly].num_points == 4)
             {
                 // extract 4th vertex
-                x4 = object->vertices_camera[object->polys[curr_poly].vertex_list[3]].x;
-                y4 = object->vertices_camera[object->polys[curr_poly].vertex_list[3]].y;
-                z4 = object->vertices_camera[object->polys[curr_poly].vertex_list[3]].z;
+                x4 = object->vertices_camera.x[object->polys[curr_poly].vertex_list[3]];
+                y4 = object->vertices_camera.y[object->polys[curr_poly].vertex_list[3]];
+                z4 = object->vertices_camera.z[object->polys[curr_poly].vertex_list[3]];
 
                 // do clipping
                 if(!((z1 > CLIP_NEAR_Z || z2 > CLIP_NEAR_Z || z3 > CLIP_NEAR_Z || z4 > CLIP_NEAR_Z) &&
                      (z1 < CLIP_FAR_Z || z2 < CLIP_FAR_Z || z3 < CLIP_FAR_Z || z4 < CLIP_FAR_Z))) {
-                    object->polys[curr_poly].clipped = 1;
+                    object->poly_states[curr_poly].clipped = 1;
                     continue;
                 }
 
@@ -215,7 +220,7 @@ void clip_object_3D(Object* object, int mode) {
                 if(!((x1 > (-x1_compare) || x2 > (-x2_compare) || x3 > (-x3_compare) || x4 > (-x4_compare)) &&
                      (x1 < x1_compare || x2 < x2_compare || x3 < x3_compare || x4 < x4_compare))) {
                     // set clipped flag
-                    object->polys[curr_poly].clipped = 1;
+                    object->poly_states[curr_poly].clipped = 1;
                     continue;
                 }
 
@@ -229,20 +234,20 @@ void clip_object_3D(Object* object, int mode) {
                 if(!((y1 > (-y1_compare) || y2 > (-y2_compare) || y3 > (-y3_compare) || y4 > (-y4_compare)) && 
                     (y1 < y1_compare || y2 < y2_compare || y3 < y3_compare || y4 < y4_compare))) {
                     // set clipped flag
-                    object->polys[curr_poly].clipped = 1;
+                    object->poly_states[curr_poly].clipped = 1;
                     continue;
                 }         
             } // end if quad
             else {
                 // must be triangle, perform clipping tests on only 3 vertices
-                object->polys[curr_poly].clipped = 0;
+                object->poly_states[curr_poly].clipped = 0;
 
                 // do clipping tests
                 // perform near and far clipping first
                 if( (z1 < CLIP_NEAR_Z && z2 < CLIP_NEAR_Z && z3 < CLIP_NEAR_Z && z4 < CLIP_NEAR_Z) ||
                 (z1 > CLIP_FAR_Z && z2 > CLIP_FAR_Z && z3 > CLIP_FAR_Z)) {
                     // set clipped flag
-                    object->polys[curr_poly].clipped = 1;
+                    object->poly_states[curr_poly].clipped = 1;
                     continue;
                 }
 
@@ -255,7 +260,7 @@ void clip_object_3D(Object* object, int mode) {
                 if(!((x1 > (-x1_compare) || x2 > (-x2_compare) || x3 > (-x3_compare)) &&
                      (x1 < x1_compare || x2 < x2_compare || x3 < x3_compare))) {
                     // set clipped flag
-                    object->polys[curr_poly].clipped = 1;
+                    object->poly_states[curr_poly].clipped = 1;
                     continue;
                 }
 
@@ -268,7 +273,7 @@ void clip_object_3D(Object* object, int mode) {
                 if(!((y1 > (-y1_compare) || y2 > (-y2_compare) || y3 > (-y3_compare)) && 
                     (y1 < y1_compare || y2 < y2_compare || y3 < y3_compare))) {
                     // set clipped flag
-                    object->polys[curr_poly].clipped = 1;
+                    object->poly_states[curr_poly].clipped = 1;
                     continue;
                 }
             } // end else triangle
@@ -307,6 +312,11 @@ void clip_polygon(facet *world_poly_storage, facet **world_polys, int *num_polys
                (world_polys[curr_poly]->vertex_list[3].z > CLIP_NEAR_Z))
             { continue; }
 
+            // no room left in polygon list for the second triangle.
+            if(p_num_polys_frame >= MAX_POLYS_PER_FRAME) {
+                continue;
+            }
+
             facet polygon;
             polygon.num_points  = 3;
             polygon.color       = world_polys[curr_poly]->color;
@@ -319,6 +329,7 @@ void clip_polygon(facet *world_poly_storage, facet **world_polys, int *num_polys
             polygon.clipped     = world_polys[curr_poly]->clipped;
             polygon.active      = world_polys[curr_poly]->active;
             polygon.normal      = world_polys[curr_poly]->normal;
+            polygon.texture     = world_polys[curr_poly]->texture;
             
             // make the old polygon be vert 0,1,2 by simply reducing
             // number of points
@@ -342,6 +353,13 @@ void clip_polygon(facet *world_poly_storage, facet **world_polys, int *num_polys
             polygon.shade[2] = world_polys[curr_poly]->shade[3];
             polygon.shade[3] = 0xFFFFFFFF;
 
+            polygon.uv[0][0] = world_polys[curr_poly]->uv[0][0];
+            polygon.uv[0][1] = world_polys[curr_poly]->uv[0][1];
+            polygon.uv[1][0] = world_polys[curr_poly]->uv[2][0];
+            polygon.uv[1][1] = world_polys[curr_poly]->uv[2][1];
+            polygon.uv[2][0] = world_polys[curr_poly]->uv[3][0];
+            polygon.uv[2][1] = world_polys[curr_poly]->uv[3][1];
+
             // add new polygon to pipeline
             world_poly_storage[p_num_polys_frame] = polygon;
             // assing pointer to it
@@ -407,6 +425,13 @@ void clip_polygon(facet *world_poly_storage, facet **world_polys, int *num_polys
                 world_polys[curr_poly]->vertex_list[v1].y = yi;
                 world_polys[curr_poly]->vertex_list[v1].z = CLIP_NEAR_Z;
 
+                // texture coordinates move along the edge the same way
+                float* uv0 = world_polys[curr_poly]->uv[v0];
+                float* uv1 = world_polys[curr_poly]->uv[v1];
+                float* uv2 = world_polys[curr_poly]->uv[v2];
+                uv1[0] = uv0[0] + (uv1[0] - uv0[0]) * t1;
+                uv1[1] = uv0[1] + (uv1[1] - uv0[1]) * t1;
+
                 // clip edge v0->v2 and intersection occurs when z = CLIP_NEAR_Z, so t:
                 v = vector_sub(&world_polys[curr_poly]->vertex_list[v0], &world_polys[curr_poly]->vertex_list[v2]);
                 t2 = ((CLIP_NEAR_Z - world_polys[curr_poly]->vertex_list[v0].z) / v.z);
@@ -419,6 +444,8 @@ void clip_polygon(facet *world_poly_storage, facet **world_polys, int *num_polys
                 world_polys[curr_poly]->vertex_list[v2].x = xi;
                 world_polys[curr_poly]->vertex_list[v2].y = yi;
                 world_polys[curr_poly]->vertex_list[v2].z = CLIP_NEAR_Z;
+                uv2[0] = uv0[0] + (uv2[0] - uv0[0]) * t2;
+                uv2[1] = uv0[1] + (uv2[1] - uv0[1]) * t2;
 
                 // re-compute normal
                 u = vector_sub(&world_polys[curr_poly]->vertex_list[v0], &world_polys[curr_poly]->vertex_list[v1]);
@@ -430,7 +457,7 @@ void clip_polygon(facet *world_poly_storage, facet **world_polys, int *num_polys
             // case 2: there are 2 points that lie inside the view frustum and
             //         only a single point inside. This case needs to construct a
             //         completely new extra polygon.
-            if(num_verts_outside == 1) 
+            if(num_verts_outside == 1 && p_num_polys_frame < MAX_POLYS_PER_FRAME) 
             {
                 // step 0: copy the polygon.
                 facet temp_polygon;
@@ -444,6 +471,8 @@ void clip_polygon(facet *world_poly_storage, facet **world_polys, int *num_polys
                 temp_polygon.visible    = world_polys[curr_poly]->visible;
                 temp_polygon.clipped    = world_polys[curr_poly]->clipped;
                 temp_polygon.active     = world_polys[curr_poly]->active;
+                temp_polygon.texture    = world_polys[curr_poly]->texture;
+                memcpy(temp_polygon.uv, world_polys[curr_poly]->uv, sizeof(temp_polygon.uv));
 
                 temp_polygon.vertex_list[0] = world_polys[curr_poly]->vertex_list[0];
                 temp_polygon.vertex_list[1] = world_polys[curr_poly]->vertex_list[1];
@@ -483,6 +512,13 @@ void clip_polygon(facet *world_poly_storage, facet **world_polys, int *num_polys
                 x02i = world_polys[curr_poly]->vertex_list[v0].x + v.x * t2;
                 y02i = world_polys[curr_poly]->vertex_list[v0].y + v.y * t2;
 
+                // texture coordinates of both intersection points
+                const float* uv = world_polys[curr_poly]->uv[v0];
+                float u01i = uv[0] + (world_polys[curr_poly]->uv[v1][0] - uv[0]) * t1,
+                      v01i = uv[1] + (world_polys[curr_poly]->uv[v1][1] - uv[1]) * t1,
+                      u02i = uv[0] + (world_polys[curr_poly]->uv[v2][0] - uv[0]) * t2,
+                      v02i = uv[1] + (world_polys[curr_poly]->uv[v2][1] - uv[1]) * t2;
+
                 // now we have both intersection points, we must overwrite the inplace
                 // polygon's vertex 0 with the intersection point, this poly 1 of 2 from 
                 // the split
@@ -491,6 +527,8 @@ void clip_polygon(facet *world_poly_storage, facet **world_polys, int *num_polys
                 world_polys[curr_poly]->vertex_list[v0].x = x01i;
                 world_polys[curr_poly]->vertex_list[v0].y = y01i;
                 world_polys[curr_poly]->vertex_list[v0].z = CLIP_NEAR_Z;
+                world_polys[curr_poly]->uv[v0][0] = u01i;
+                world_polys[curr_poly]->uv[v0][1] = v01i;
 
                 // now comes the hard part,
                 // we have to carefully create a new polygon from the 2 intersection points and v2,
@@ -501,10 +539,14 @@ void clip_polygon(facet *world_poly_storage, facet **world_polys, int *num_polys
                 temp_polygon.vertex_list[v1].x = x01i;
                 temp_polygon.vertex_list[v1].y = y01i;
                 temp_polygon.vertex_list[v1].z = CLIP_NEAR_Z;
+                temp_polygon.uv[v1][0] = u01i;
+                temp_polygon.uv[v1][1] = v01i;
 
                 temp_polygon.vertex_list[v0].x = x02i;
                 temp_polygon.vertex_list[v0].y = y02i;
                 temp_polygon.vertex_list[v0].z = CLIP_NEAR_Z;
+                temp_polygon.uv[v0][0] = u02i;
+                temp_polygon.uv[v0][1] = v02i;
 
                 // re-compute normals
                 // poly 1 first, in place
@@ -0,0 +1,44 @@
+#include "depth.h"
+
+DepthFormat depth = { .format = DEPTH_LINEAR, .scale = 0 };
+
+// Largest integer value of every format (DEPTH_16 stays below DEPTH_16_FAR, so
+// the far plane still passes the test against a cleared buffer, and DEPTH_32
+// far enough below INT_MAX that stepped floats never overflow the int conversion).
+static const double depth_scales[DEPTH_FORMATS] = { 0, 65534.0, 16777215.0, 2130706432.0, 0 };
+
+// Selects depth format (DEPTH_LINEAR by default).
+void depth_set_format(int format) {
+    depth.format = (format >= 0 && format < DEPTH_FORMATS) ? format : DEPTH_LINEAR;
+    depth.scale  = depth_scales[depth.format];
+}
+
+// Returns depth format in use.
+int depth_format(void) {
+    return depth.format;
+}
+
+// Returns name of depth format ("linear", "16", "24", "32" or "float").
+const char* depth_format_name(int format) {
+    static const char* names[DEPTH_FORMATS] = { "linear", "16", "24", "32", "float" };
+    return (format >= 0 && format < DEPTH_FORMATS) ? names[format] : names[DEPTH_LINEAR];
+}
+
+// Returns size of one depth of a z-buffer for format (2 for DEPTH_16, else 4).
+int depth_bytes(int format) {
+    return (format == DEPTH_16) ? (int) sizeof(uint16_t) : (int) sizeof(int);
+}
+
+// Converts camera space z of a vertex into the depth value of the format in use.
+// Vertices beyond the near or far plane are clamped to it.
+int depth_encode(float z) {
+    if(depth.format == DEPTH_LINEAR) {
+        return (int) z;
+    }
+    double clamped = (z < CLIP_NEAR_Z) ? CLIP_NEAR_Z : ((z > CLIP_FAR_Z) ? CLIP_FAR_Z : z);
+    if(depth.format == DEPTH_FLOAT) {
+        return (int) (DEPTH_FLOAT_SCALE * (CLIP_NEAR_Z / clamped));
+    }
+    double d = ((1.0 / CLIP_NEAR_Z) - (1.0 / clamped)) / ((1.0 / CLIP_NEAR_Z) - (1.0 / CLIP_FAR_Z));
+    return (int) ((d * depth.scale) + 0.5);
+}
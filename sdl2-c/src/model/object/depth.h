@@ -0,0 +1,107 @@
+#ifndef DEPTH_H
+#define DEPTH_H
+
+#include "../global.h"
+#include <stdint.h>
+#include <string.h>
+
+// Depth buffer formats.
+// Every vertex carries one depth value that the fillers step linearly across
+// the screen, every pixel then stores the depth test key of its stepped value
+// in the z-buffer (smaller is nearer). The z-buffer holds ALL_PIXELS depths of
+// depth_bytes each: an int per pixel (INT_MAX is the clear value) for every
+// format but DEPTH_16, whose buffers hold uint16_t (DEPTH_16_FAR is the clear
+// value) and are half the size, so clears, depth tests and hi-z refreshes move
+// half the bytes. It is handed around as void*, fillers read and write keys
+// with depth_read and depth_write.
+// DEPTH_LINEAR steps camera space z, which is not linear in screen space, so
+// depths inside a triangle are wrong under perspective. The other formats step
+// a value affine in 1/z, which is, and the depth test is perspective correct:
+// DEPTH_16, DEPTH_24 and DEPTH_32 keep (1/near - 1/z) / (1/near - 1/far) as an
+// integer of that many bits, DEPTH_FLOAT keeps near/z (1 at the near plane) as
+// a 32 bit float whose bits are turned around into the key (reverse z: float
+// precision grows toward the far plane where 1/z has the least of it). Those
+// keys are kept in the int z-buffer: the same 4 bytes per pixel as a float
+// buffer, but tested with integer compares like every other format.
+// The fillers step in float, so DEPTH_32 still resolves about 24 bits and only
+// DEPTH_LINEAR and small enough DEPTH_16 values fit the 16.16 fixed point
+// stepping (other triangles fall back to float).
+
+#define DEPTH_LINEAR 0  // camera space z (not perspective correct)
+#define DEPTH_16     1  // 1/z as 16 bit integer (16 bit z-buffer)
+#define DEPTH_24     2  // 1/z as 24 bit integer
+#define DEPTH_32     3  // 1/z as 31 bit integer (below INT_MAX)
+#define DEPTH_FLOAT  4  // near/z as 32 bit float, reverse z
+#define DEPTH_FORMATS 5
+
+#define DEPTH_FLOAT_SCALE   1073741824.0f   // 2^30, vertex values are near/z * 2^30
+#define DEPTH_FLOAT_KEY_ONE 0x4E800000      // bits of DEPTH_FLOAT_SCALE, key of the near plane is 0
+#define DEPTH_MAX_VALUE     2147483520.0f   // largest float below 2^31, above every stepped depth
+#define DEPTH_16_FAR        0xFFFF          // clear value of 16 bit z-buffers, above every DEPTH_16 key
+
+// Depth format in use.
+typedef struct {
+    int    format;
+    double scale;       // largest integer value of DEPTH_16, DEPTH_24, DEPTH_32
+}DepthFormat;
+
+extern DepthFormat depth;
+
+// Selects depth format (DEPTH_LINEAR by default).
+void depth_set_format(int format);
+// Returns depth format in use.
+int depth_format(void);
+// Returns name of depth format ("linear", "16", "24", "32" or "float").
+const char* depth_format_name(int format);
+
+// Returns size of one depth of a z-buffer for format (2 for DEPTH_16, else 4).
+int depth_bytes(int format);
+
+// Converts camera space z of a vertex into the depth value of the format in use.
+int depth_encode(float z);
+
+// Returns 1 if keys are the bits of float depths, fillers read this once
+// and hand it to depth_key.
+static inline int depth_is_float(void) {
+    return depth.format == DEPTH_FLOAT;
+}
+
+// Returns 1 if the z-buffer holds 16 bit depths (DEPTH_16), fillers read this
+// once and hand it to depth_read and depth_write.
+static inline int depth_is_16(void) {
+    return depth.format == DEPTH_16;
+}
+
+// Returns depth test key stored for pixel index of z_buffer.
+static inline int depth_read(const void* z_buffer, int index, int narrow) {
+    return narrow ? ((const uint16_t*) z_buffer)[index] : ((const int*) z_buffer)[index];
+}
+
+// Stores key for pixel index of z_buffer. Only keys that passed the depth test
+// are stored, so DEPTH_16 keys are below DEPTH_16_FAR and fit.
+static inline void depth_write(void* z_buffer, int index, int key, int narrow) {
+    if(narrow) {
+        ((uint16_t*) z_buffer)[index] = (uint16_t) key;
+    } else {
+        ((int*) z_buffer)[index] = key;
+    }
+}
+
+// Returns depth test key of stepped depth value z (smaller is nearer).
+static inline int depth_key(float z, int float_depth) {
+    if(float_depth) {
+        int32_t bits;
+        memcpy(&bits, &z, sizeof(bits));
+        return DEPTH_FLOAT_KEY_ONE - bits;
+    }
+    return (int) z;
+}
+
+// Amount subtracted from the nearest key of a triangle, span or block before
+// it is compared against depths already drawn, covers rounding of the stepped
+// depths (which grows with their magnitude, or per float ulp for DEPTH_FLOAT).
+static inline int depth_margin(int key) {
+    return 1 + ((key > 0) ? (key >> 14) : 0) + ((depth.format == DEPTH_FLOAT) ? 1024 : 0);
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include "polygon.h"
+#include "hiz.h"
+
+/* Visibility buffer (deferred) shading.
+   The rasterizers draw every triangle flat with its id (index + 1) as color,
+   so the first pass only writes depth and id into the z-buffer and pixelmap.
+   The second pass walks the pixelmap once and replaces every id by the color
+   of the triangle at that pixel, computed from plane equations of the 3 color
+   channels kept per id. Shading then costs the same for every covered pixel
+   no matter how often it was overdrawn. Id 0 is an empty (black) pixel. */
+
+// Color planes of a triangle, channel(x,y) = base + dx*x + dy*y.
+typedef struct {
+    float base[3], dx[3], dy[3];
+    float low[3], high[3];      // range of the channel at the vertices
+}ShadePlanes;
+
+// Shading used by draw_poly_list_z, SHADE_FORWARD or SHADE_DEFERRED.
+static int shading = SHADE_FORWARD;
+
+// Planes of every id handed out in the current frame (index 0 is unused).
+static struct {
+    ShadePlanes planes[(MAX_POLYS_PER_FRAME * 2) + 1];
+    int count;
+}visibility;
+
+// Selects forward (shaded while rasterizing) or deferred (visibility buffer) shading.
+void raster_set_shading(int mode) {
+    shading = (mode == SHADE_DEFERRED) ? SHADE_DEFERRED : SHADE_FORWARD;
+}
+
+// Returns shading in use.
+int raster_shading(void) {
+    return shading;
+}
+
+// Returns name of shading ("forward" or "deferred").
+const char* raster_shading_name(int mode) {
+    return (mode == SHADE_DEFERRED) ? "deferred" : "forward";
+}
+
+// Starts visibility buffer of a new frame (no ids handed out yet).
+void visibility_begin(void) {
+    visibility.count = 0;
+}
+
+// Keeps the color planes of t under the next id and turns t into a flat
+// triangle of that id, so the rasterizers write only depth and id (textures
+// are dropped, textured triangles are shaded with their color). Returns 0
+// when the ids of the frame are used up, t must then not be drawn.
+int visibility_add(RasterTriangle* t) {
+    if(visibility.count >= MAX_POLYS_PER_FRAME * 2) {
+        return 0;
+    }
+    ShadePlanes* p = &visibility.planes[++visibility.count];
+    int gouraud = (t->mode == GOURAUD_SHADING);
+    int area = ((t->x[1] - t->x[0]) * (t->y[2] - t->y[0])) - ((t->x[2] - t->x[0]) * (t->y[1] - t->y[0]));
+    float inverse_area = (area != 0) ? 1.0f / area : 0;
+
+    for(int c = 0; c < 3; c++) {
+        int shift = 8 * c;
+        float v0 = (t->color[0] >> shift) & 0xFF;
+        if(!gouraud || area == 0) {
+            // flat color, or no plane through a degenerate triangle
+            p->base[c] = p->low[c] = p->high[c] = v0;
+            p->dx[c] = p->dy[c] = 0;
+            continue;
+        }
+        float v1 = (t->color[1] >> shift) & 0xFF, v2 = (t->color[2] >> shift) & 0xFF;
+        p->low[c]  = (v0 < v1) ? ((v0 < v2) ? v0 : v2) : ((v1 < v2) ? v1 : v2);
+        p->high[c] = (v0 > v1) ? ((v0 > v2) ? v0 : v2) : ((v1 > v2) ? v1 : v2);
+        p->dx[c]   = ((v1 - v0) * (t->y[2] - t->y[0]) - (v2 - v0) * (t->y[1] - t->y[0])) * inverse_area;
+        p->dy[c]   = ((v2 - v0) * (t->x[1] - t->x[0]) - (v1 - v0) * (t->x[2] - t->x[0])) * inverse_area;
+        p->base[c] = v0 - (p->dx[c] * t->x[0]) - (p->dy[c] * t->y[0]);
+    }
+    t->color[0] = visibility.count;
+    t->mode     = FLAT_SHADING;
+    t->texture  = NULL;
+    return 1;
+}
+
+// Color channel clamped to its range at the vertices, pixels at the edges lie
+// slightly outside the triangle and extrapolate the plane (steeply on slivers),
+// while the spans of the forward fillers never leave that range.
+static inline int channel_byte(float value, float low, float high) {
+    value = (value < low) ? low : value;
+    return (int) ((value > high) ? high : value);
+}
+
+// Replaces the ids in rectangle min_x,min_y - max_x,max_y of pixelmap by the
+// gouraud color of their triangle at that pixel, every pixel is shaded once.
+// Tiles of an older epoch are skipped (they hold last frame, buffers_resolve
+// blanks them).
+void visibility_shade(uint32_t* pixelmap, int min_x, int min_y, int max_x, int max_y) {
+    int epoch = tiles_active_painted(pixelmap);
+    uint32_t count = (uint32_t) visibility.count;
+
+    for(int y = min_y; y <= max_y; y++) {
+        uint64_t tiles = epoch ? tiles_wiped(y / HIZ_TILE) : ~(uint64_t) 0;
+        uint32_t* row = &pixelmap[y * WINDOW_WIDTH];
+
+        for(int tile = min_x / HIZ_TILE; tile <= max_x / HIZ_TILE; tile++) {
+            if(((tiles >> tile) & 1) == 0) {
+                continue;
+            }
+            int x_end = ((tile + 1) * HIZ_TILE - 1 < max_x) ? (tile + 1) * HIZ_TILE - 1 : max_x;
+            for(int x = (tile * HIZ_TILE > min_x) ? tile * HIZ_TILE : min_x; x <= x_end; x++) {
+                uint32_t id = row[x];
+                if(id == 0 || id > count) {
+                    continue;
+                }
+                const ShadePlanes* p = &visibility.planes[id];
+                row[x] = _RGB32BIT(0, channel_byte(p->base[0] + (p->dx[0] * x) + (p->dy[0] * y), p->low[0], p->high[0]),
+                                      channel_byte(p->base[1] + (p->dx[1] * x) + (p->dy[1] * y), p->low[1], p->high[1]),
+                                      channel_byte(p->base[2] + (p->dx[2] * x) + (p->dy[2] * y), p->low[2], p->high[2]));
+            }
+        }
+    }
+}
@@ -0,0 +1,419 @@
+#include "polygon.h"
+#include "rasterstats.h"
+#include "hiz.h"
+#include "../math/fixedpoint.h"
+
+/* Fixed point versions of the flat top / flat bottom triangle functions in
+   drawtriangle.c. Edges, z and color are stepped as 16.16 integers, so the
+   inner loops have no float to int conversions and give the same result on
+   every machine. Coordinates must be within +-FIXP16_MAX_INT. */
+
+#define RECIPROCALS 512     // spans and heights with a precomputed reciprocal
+
+// 1/i with 32 fraction bits for i < RECIPROCALS, saves the 64 bit division
+// that would otherwise be done for every line.
+static int64_t reciprocals[RECIPROCALS];
+
+// Fills reciprocal table, must be called before the first fixed point triangle.
+void draw_fixed_init(void) {
+    reciprocals[0] = 0;
+    for(int i = 1; i < RECIPROCALS; i++) {
+        reciprocals[i] = fixp16_reciprocal(i);
+    }
+}
+
+// Returns 1/i (i > 0) with 32 fraction bits from the table when possible.
+static inline int64_t reciprocal(int i) {
+    return (i < RECIPROCALS) ? reciprocals[i] : fixp16_reciprocal(i);
+}
+
+// this function draws a triangle that has a flat top or a flat bottom
+void draw_tb_triangle_3d_z_fixed(int x1, int y1, int z1,
+                        int x2, int y2, int z2,
+                        int x3, int y3, int z3,
+                        int color, uint32_t* pixelmap, void *z_buffer)
+{
+    fixp16 dx_right,    // the dx/dy ratio of the right edge of line
+           dx_left,     // the dx/dy ratio of the left edge of line
+           xs,xe,       // the starting and ending points of the edges
+           z_left,      // the z value of the left edge of current line
+           z_right,     // the z value of the right edge of current line
+           b1y,         // the change of z with respect to y on the left edge
+           b2y,         // the change of z with respect to y on the right edge
+           z_middle,    // the z value of the middle between the left and right
+           bx;          // the change of z with respect to x
+
+    int temp_x,         // used during sorting as temps
+        temp_z,
+        span,           // whole pixels of current line, 1 + xe - xs
+        height,         // the height of the triangle
+        dx, dy,         // general delta's
+        xs_clip,        // used by clipping
+        xe_clip,
+        x_index,        // used as looping vars
+        y_index;
+
+    int64_t ay;         // reciprocal of height, interpolator constant
+
+    int hiz = hiz_active(z_buffer),     // test spans against hierarchical z
+        painter = (z_buffer == NULL),   // no depth test, pixels are painted over
+        narrow = depth_is_16();         // z-buffer holds 16 bit depths
+
+    // test if top or bottom is flat and set constant appropriately
+    if(y1 == y2) {
+        //perform computations for a triangle with a flat top
+        if(x2 < x1) {
+            temp_x = x2;
+            temp_z = z2;
+            x2 = x1;
+            z2 = z1;
+            x1 = temp_x;
+            z1 = temp_z;
+        } // end if swap
+        // compute deltas for scan conversion
+        height = y3 - y1;
+        ay = reciprocal(height);
+        dx_left  = fixp16_mul_reciprocal(fixp16_from_int(x3 - x1), ay);
+        dx_right = fixp16_mul_reciprocal(fixp16_from_int(x3 - x2), ay);
+
+        // compute deltas for z interpolation
+        z_left  = fixp16_from_int(z1);
+        z_right = fixp16_from_int(z2);
+
+        // vertical interpolants
+        b1y = fixp16_mul_reciprocal(fixp16_from_int(z3 - z1), ay);
+        b2y = fixp16_mul_reciprocal(fixp16_from_int(z3 - z2), ay);
+
+        // set starting points
+        xs = fixp16_from_int(x1);
+        xe = fixp16_from_int(x2);
+    } // end top is flat
+    else {
+        // bottom must be flat
+        // test order of x3 and x2, note y2 == y3
+        if(x3 < x2) {
+            temp_x = x2;
+            temp_z = z2;
+            x2 = x3;
+            z2 = z3;
+            x3 = temp_x;
+            z3 = temp_z;
+        } // end if swap
+        // compute deltas for scan conversion
+        height = y3 - y1;
+        ay = reciprocal(height);
+        dx_left  = fixp16_mul_reciprocal(fixp16_from_int(x2 - x1), ay);
+        dx_right = fixp16_mul_reciprocal(fixp16_from_int(x3 - x1), ay);
+
+        // compute deltas for z interpolation
+        z_left  = fixp16_from_int(z1);
+        z_right = fixp16_from_int(z1);
+
+        // vertical interpolants
+        b1y = fixp16_mul_reciprocal(fixp16_from_int(z2 - z1), ay);
+        b2y = fixp16_mul_reciprocal(fixp16_from_int(z3 - z1), ay);
+
+        // set starting points
+        xs = fixp16_from_int(x1);
+        xe = fixp16_from_int(x1);
+    } // end else bottom is flat
+
+    // perform y clipping against the band of the calling thread (raster_band),
+    // stepping is exact so jumping to its first row equals stepping row by row
+    // (the same holds for its columns, raster_columns)
+    int first, last, left, right;
+    raster_band(&first, &last);
+    raster_columns(&left, &right);
+    if(y1 < first) {
+        // compute new xs and ys
+        dy = first - y1;
+        xs += fixp16_mul_int(dx_left, dy);
+        xe += fixp16_mul_int(dx_right, dy);
+
+        // re-compute z_left and z_right to take into consideration
+        // vertical shift down
+        z_left  += fixp16_mul_int(b1y, dy);
+        z_right += fixp16_mul_int(b2y, dy);
+
+        // reset y1
+        y1 = first;
+    } // end if top is off screen
+
+    // clip bottom
+    if(y3 > last) {
+        y3 = last;
+    }
+
+    for(y_index = y1; y_index <= y3; y_index++) {
+        RASTER_STAT(scanlines);
+        xs_clip = fixp16_to_int(xs);
+        xe_clip = fixp16_to_int(xe);
+
+        // compute horizontal z interpolant over the whole pixels of 1 + xe - xs
+        span = fixp16_to_int(xe - xs + FIXP16_MAG);
+        z_middle = z_left;
+        bx = fixp16_mul_reciprocal(z_right - z_left, reciprocal((span > 0) ? span : 1));
+
+        // adjust starting point and ending point
+        xs += dx_left;
+        xe += dx_right;
+
+        // adjust vertical z interpolants
+        z_left  += b1y;
+        z_right += b2y;
+
+        // clip line
+        if(xs_clip < left) {
+            dx = left - xs_clip;
+            xs_clip = left;
+
+            // re-compute z_middle to take into consideration horizontal shift
+            z_middle += fixp16_mul_int(bx, dx);
+        } // end if line is clipped on left
+
+        if(xe_clip > right) {
+            xe_clip = right;
+        } // end if line is clipped on right
+
+        // skip span when it is behind the hierarchical z tiles
+        if(hiz && hiz_span_hidden(y_index, xs_clip, xe_clip,
+                                  hiz_span_key(z_middle / (float) FIXP16_MAG, bx / (float) FIXP16_MAG,
+                                               xe_clip - xs_clip + 1, 0))) {
+            RASTER_STAT(spans_hiz);
+            xe_clip = xs_clip - 1;
+        }
+
+        // draw the line
+        for(x_index = xs_clip; x_index <= xe_clip; x_index++) {
+            RASTER_STAT(depth_tests);
+            if(painter || fixp16_to_int(z_middle) < depth_read(z_buffer, y_index * WINDOW_WIDTH + x_index, narrow)) {
+                // update z buffer and write to image buffer
+                RASTER_STAT(depth_passes);
+                RASTER_STAT_WRITE(y_index * WINDOW_WIDTH + x_index);
+                if(!painter) {
+                    depth_write(z_buffer, y_index * WINDOW_WIDTH + x_index, fixp16_to_int(z_middle), narrow);
+                }
+                display_draw_pixel(pixelmap, x_index, y_index, color);
+            } // end if update buffer
+            // update current z value
+            z_middle += bx;
+        } // end draw z buffered line
+    } // end for y_index
+}
+
+// Fixed point version of draw_tb_triangle_3d_gouraud, the 3 color channels
+// are interpolated as 16.16 integers just like z.
+void draw_tb_triangle_3d_gouraud_fixed(int x1, int y1, int z1, int i1,
+                        int x2, int y2, int z2, int i2,
+                        int x3, int y3, int z3, int i3,
+                        uint32_t* pixelmap, void *z_buffer)
+{
+    fixp16 dx_right,    // the dx/dy ratio of the right edge of line
+           dx_left,     // the dx/dy ratio of the left edge of line
+           xs,xe,       // the starting and ending points of the edges
+           z_left,      // the z value of the left edge of current line
+           z_right,     // the z value of the right edge of current line
+           b1y,         // the change of z with respect to y on the left edge
+           b2y,         // the change of z with respect to y on the right edge
+           z_middle,    // the z value of the middle between the left and right
+           bx;          // the change of z with respect to x
+
+    // color channels blue, green, red: left edge, right edge, their steps
+    // along y and the current value and step along x of the line.
+    fixp16 i_left[3], i_right[3], b1y_i[3], b2y_i[3], i_middle[3], i_x[3];
+    int c1[3], c2[3], c3[3];
+
+    int temp_x,         // used during sorting as temps
+        temp_z,
+        temp_i,
+        span,           // whole pixels of current line, 1 + xe - xs
+        height,         // the height of the triangle
+        dx, dy,         // general delta's
+        xs_clip,        // used by clipping
+        xe_clip,
+        x_index,        // used as looping vars
+        y_index,
+        channel;
+
+    int64_t ay,         // reciprocal of height, interpolator constant
+            ax;         // reciprocal of span
+
+    int hiz = hiz_active(z_buffer),     // test spans against hierarchical z
+        painter = (z_buffer == NULL),   // no depth test, pixels are painted over
+        narrow = depth_is_16();         // z-buffer holds 16 bit depths
+
+    // test if top or bottom is flat and set constant appropriately
+    if(y1 == y2) {
+        //perform computations for a triangle with a flat top
+        if(x2 < x1) {
+            temp_x = x2;
+            temp_z = z2;
+            temp_i = i2;
+            x2 = x1;
+            z2 = z1;
+            i2 = i1;
+            x1 = temp_x;
+            z1 = temp_z;
+            i1 = temp_i;
+        } // end if swap
+    }
+    else {
+        // bottom must be flat
+        // test order of x3 and x2, note y2 == y3
+        if(x3 < x2) {
+            temp_x = x2;
+            temp_z = z2;
+            temp_i = i2;
+            x2 = x3;
+            z2 = z3;
+            i2 = i3;
+            x3 = temp_x;
+            z3 = temp_z;
+            i3 = temp_i;
+        } // end if swap
+    }
+
+    for(channel = 0; channel < 3; channel++) {
+        c1[channel] = (i1 >> (16 - 8 * channel)) & 0xFF;
+        c2[channel] = (i2 >> (16 - 8 * channel)) & 0xFF;
+        c3[channel] = (i3 >> (16 - 8 * channel)) & 0xFF;
+    }
+
+    height = y3 - y1;
+    ay = reciprocal(height);
+    if(y1 == y2) {
+        // flat top: left edge p1->p3, right edge p2->p3
+        dx_left  = fixp16_mul_reciprocal(fixp16_from_int(x3 - x1), ay);
+        dx_right = fixp16_mul_reciprocal(fixp16_from_int(x3 - x2), ay);
+        z_left   = fixp16_from_int(z1);
+        z_right  = fixp16_from_int(z2);
+        b1y      = fixp16_mul_reciprocal(fixp16_from_int(z3 - z1), ay);
+        b2y      = fixp16_mul_reciprocal(fixp16_from_int(z3 - z2), ay);
+        for(channel = 0; channel < 3; channel++) {
+            i_left[channel]  = fixp16_from_int(c1[channel]);
+            i_right[channel] = fixp16_from_int(c2[channel]);
+            b1y_i[channel]   = fixp16_mul_reciprocal(fixp16_from_int(c3[channel] - c1[channel]), ay);
+            b2y_i[channel]   = fixp16_mul_reciprocal(fixp16_from_int(c3[channel] - c2[channel]), ay);
+        }
+        xs = fixp16_from_int(x1);
+        xe = fixp16_from_int(x2);
+    } else {
+        // flat bottom: left edge p1->p2, right edge p1->p3
+        dx_left  = fixp16_mul_reciprocal(fixp16_from_int(x2 - x1), ay);
+        dx_right = fixp16_mul_reciprocal(fixp16_from_int(x3 - x1), ay);
+        z_left   = fixp16_from_int(z1);
+        z_right  = fixp16_from_int(z1);
+        b1y      = fixp16_mul_reciprocal(fixp16_from_int(z2 - z1), ay);
+        b2y      = fixp16_mul_reciprocal(fixp16_from_int(z3 - z1), ay);
+        for(channel = 0; channel < 3; channel++) {
+            i_left[channel]  = fixp16_from_int(c1[channel]);
+            i_right[channel] = fixp16_from_int(c1[channel]);
+            b1y_i[channel]   = fixp16_mul_reciprocal(fixp16_from_int(c2[channel] - c1[channel]), ay);
+            b2y_i[channel]   = fixp16_mul_reciprocal(fixp16_from_int(c3[channel] - c1[channel]), ay);
+        }
+        xs = fixp16_from_int(x1);
+        xe = fixp16_from_int(x1);
+    }
+
+    // perform y clipping against the band of the calling thread (raster_band),
+    // stepping is exact so jumping to its first row equals stepping row by row
+    // (the same holds for its columns, raster_columns)
+    int first, last, left, right;
+    raster_band(&first, &last);
+    raster_columns(&left, &right);
+    if(y1 < first) {
+        dy = first - y1;
+        xs += fixp16_mul_int(dx_left, dy);
+        xe += fixp16_mul_int(dx_right, dy);
+
+        // re-compute left and right interpolants to take into
+        // consideration vertical shift down
+        z_left  += fixp16_mul_int(b1y, dy);
+        z_right += fixp16_mul_int(b2y, dy);
+        for(channel = 0; channel < 3; channel++) {
+            i_left[channel]  += fixp16_mul_int(b1y_i[channel], dy);
+            i_right[channel] += fixp16_mul_int(b2y_i[channel], dy);
+        }
+
+        // reset y1
+        y1 = first;
+    } // end if top is off screen
+
+    // clip bottom
+    if(y3 > last) {
+        y3 = last;
+    }
+
+    for(y_index = y1; y_index <= y3; y_index++) {
+        RASTER_STAT(scanlines);
+        xs_clip = fixp16_to_int(xs + FIXP16_ROUND_UP);
+        xe_clip = fixp16_to_int(xe + FIXP16_ROUND_UP);
+
+        // compute horizontal interpolants over the whole pixels of the line
+        span = fixp16_to_int(xe - xs + FIXP16_MAG);
+        ax = reciprocal((span > 0) ? span : 1);
+        z_middle = z_left;
+        bx = fixp16_mul_reciprocal(z_right - z_left, ax);
+        for(channel = 0; channel < 3; channel++) {
+            i_middle[channel] = i_left[channel];
+            i_x[channel] = fixp16_mul_reciprocal(i_right[channel] - i_left[channel], ax);
+        }
+
+        // adjust starting point and ending point
+        xs += dx_left;
+        xe += dx_right;
+
+        // adjust vertical interpolants
+        z_left  += b1y;
+        z_right += b2y;
+        for(channel = 0; channel < 3; channel++) {
+            i_left[channel]  += b1y_i[channel];
+            i_right[channel] += b2y_i[channel];
+        }
+
+        // clip line
+        if(xs_clip < left) {
+            dx = left - xs_clip;
+            xs_clip = left;
+
+            // re-compute interpolants to take into consideration horizontal shift
+            z_middle += fixp16_mul_int(bx, dx);
+            for(channel = 0; channel < 3; channel++) {
+                i_middle[channel] += fixp16_mul_int(i_x[channel], dx);
+            }
+        } // end if line is clipped on left
+
+        if(xe_clip > right) {
+            xe_clip = right;
+        } // end if line is clipped on right
+
+        // skip span when it is behind the hierarchical z tiles
+        if(hiz && hiz_span_hidden(y_index, xs_clip, xe_clip,
+                                  hiz_span_key(z_middle / (float) FIXP16_MAG, bx / (float) FIXP16_MAG,
+                                               xe_clip - xs_clip + 1, 0))) {
+            RASTER_STAT(spans_hiz);
+            xe_clip = xs_clip - 1;
+        }
+
+        // draw the line, channels in locals so they stay in registers
+        fixp16 b = i_middle[0], g = i_middle[1], r = i_middle[2];
+        for(x_index = xs_clip; x_index <= xe_clip; x_index++) {
+            RASTER_STAT(depth_tests);
+            if(painter || fixp16_to_int(z_middle) < depth_read(z_buffer, y_index * WINDOW_WIDTH + x_index, narrow)) {
+                // update z buffer and write to image buffer
+                RASTER_STAT(depth_passes);
+                RASTER_STAT_WRITE(y_index * WINDOW_WIDTH + x_index);
+                if(!painter) {
+                    depth_write(z_buffer, y_index * WINDOW_WIDTH + x_index, fixp16_to_int(z_middle), narrow);
+                }
+                int rgb = _RGB32BIT(0, fixp16_to_int(r), fixp16_to_int(g), fixp16_to_int(b));
+                display_draw_pixel(pixelmap, x_index, y_index, rgb);
+            } // end if update buffer
+            // update current interpolants
+            z_middle += bx;
+            b += i_x[0];
+            g += i_x[1];
+            r += i_x[2];
+        } // end draw z buffered line
+    } // end for y_index
+}
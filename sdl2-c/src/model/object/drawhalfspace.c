@@ -0,0 +1,357 @@
+#include "polygon.h"
+#include "rasterstats.h"
+#include "hiz.h"
+#include "depth.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HALFSPACE_SSE 1
+#include <emmintrin.h>
+#endif
+
+/* Half-space (edge function) rasterizer.
+   Instead of splitting the triangle and walking spans, the 3 edge functions
+   E(x,y) = A*x + B*y + C are evaluated for every pixel of the bounding box.
+   A pixel is inside when all 3 are >= 0. Pixels exactly on an edge follow the
+   top-left rule of the sub-pixel scanline fillers: the bias of edges that are
+   neither top nor left edges moves them to the outside, so a pixel on an edge
+   shared by 2 triangles is drawn once. The box is walked in HALFSPACE_BLOCK x HALFSPACE_BLOCK
+   blocks: blocks outside an edge are skipped, blocks inside all edges are
+   filled without edge tests and only blocks on an edge test every pixel.
+   Depth and color are interpolated with plane equations, a row of 4 pixels
+   at a time with SSE2 (plain C elsewhere). */
+
+#define HALFSPACE_BLOCK 4
+
+// rows of 4 pixels are loaded and stored as a whole
+#if WINDOW_WIDTH % HALFSPACE_BLOCK != 0
+#error "WINDOW_WIDTH must be a multiple of HALFSPACE_BLOCK"
+#endif
+
+// Edge function of the edge from a to b, positive on the inside of a
+// counter-clockwise (positive area) triangle.
+typedef struct {
+    int a, b, c;        // E(x,y) = a*x + b*y + c
+}Edge;
+
+// Plane equation of a vertex attribute, value(x,y) = base + dx*x + dy*y.
+typedef struct {
+    float base, dx, dy;
+}Plane;
+
+static Edge edge_create(int xa, int ya, int xb, int yb) {
+    return (Edge) { ya - yb, xb - xa, (xa * yb) - (xb * ya) };
+}
+
+static Plane plane_create(float v0, float v1, float v2,
+                          int x0, int y0, int x1, int y1, int x2, int y2, float inverse_area) {
+    Plane p;
+    p.dx   = ((v1 - v0) * (y2 - y0) - (v2 - v0) * (y1 - y0)) * inverse_area;
+    p.dy   = ((v2 - v0) * (x1 - x0) - (v1 - v0) * (x2 - x0)) * inverse_area;
+    p.base = v0 - (p.dx * x0) - (p.dy * y0);
+    return p;
+}
+
+static inline int edge_at(const Edge* e, int x, int y) {
+    return (e->a * x) + (e->b * y) + e->c;
+}
+
+// Per triangle constants shared by all blocks.
+typedef struct {
+    Edge  edges[3];
+    int   block_max[3],     // offset from edge value at block corner to its largest
+          block_min[3];     // and smallest value inside the block
+    Plane z;
+    Plane channels[3];      // red, green, blue (only set when gouraud)
+    int   float_depth;      // keys are float bits (DEPTH_FLOAT)
+    int   narrow;           // z-buffer holds 16 bit depths (DEPTH_16)
+    int   gouraud;
+    int   color;            // color of FLAT_SHADING
+    int   max_x, max_y;     // last pixel of the bounding box
+}Setup;
+
+// Nearest depth key inside the block with top left corner x,y, low and high
+// are the offsets from the corner to the smallest and largest depth in it.
+// Corners outside the triangle extrapolate the plane, the range is clamped
+// to depths a pixel can have so the keys never overflow.
+static inline int block_key(const Setup* s, int x, int y, float low, float high) {
+    float corner = s->z.base + (s->z.dx * x) + (s->z.dy * y);
+    low  = (corner + low < 0) ? 0 : corner + low;
+    high = (corner + high > DEPTH_MAX_VALUE) ? DEPTH_MAX_VALUE : corner + high;
+    int first = depth_key(low, s->float_depth), last = depth_key(high, s->float_depth);
+    return (first < last) ? first : last;
+}
+
+#ifdef HALFSPACE_SSE
+
+// Rasterizes block with top left corner x,y, w holds the edge values at the
+// corner. full skips the edge tests. Every row of 4 pixels is done at once,
+// the depth test and the writes are masked per pixel (no depth test without
+// z_buffer).
+static void halfspace_block(const Setup* s, int x, int y, const int* w, int full,
+                            uint32_t* pixelmap, void* z_buffer) {
+    const __m128  lanef = _mm_set_ps(3, 2, 1, 0);
+    __m128i edge[3], edge_dy[3];
+    __m128  channel[3], channel_dy[3];
+    int rows = (s->max_y - y + 1 < HALFSPACE_BLOCK) ? s->max_y - y + 1 : HALFSPACE_BLOCK;
+
+    for(int e = 0; e < 3; e++) {
+        int a = s->edges[e].a;
+        edge[e]    = _mm_add_epi32(_mm_set1_epi32(w[e]), _mm_set_epi32(3 * a, 2 * a, a, 0));
+        edge_dy[e] = _mm_set1_epi32(s->edges[e].b);
+    }
+    __m128 depth    = _mm_add_ps(_mm_set1_ps(s->z.base + (s->z.dx * x) + (s->z.dy * y)),
+                                 _mm_mul_ps(lanef, _mm_set1_ps(s->z.dx)));
+    __m128 depth_dy = _mm_set1_ps(s->z.dy);
+    __m128i rgb     = _mm_set1_epi32(s->color);
+    if(s->gouraud) {
+        for(int c = 0; c < 3; c++) {
+            const Plane* p = &s->channels[c];
+            channel[c]    = _mm_add_ps(_mm_set1_ps(p->base + (p->dx * x) + (p->dy * y)),
+                                       _mm_mul_ps(lanef, _mm_set1_ps(p->dx)));
+            channel_dy[c] = _mm_set1_ps(p->dy);
+        }
+    }
+    // pixels right of the bounding box
+    __m128i columns = _mm_cmplt_epi32(_mm_add_epi32(_mm_set1_epi32(x), _mm_set_epi32(3, 2, 1, 0)),
+                                      _mm_set1_epi32(s->max_x + 1));
+
+    for(int row = 0; row < rows; row++) {
+        int index = ((y + row) * WINDOW_WIDTH) + x;
+        __m128i mask = columns;
+        RASTER_STAT(scanlines);
+
+        if(!full) {
+            // sign bit of the or is set when any edge is negative
+            __m128i any = _mm_or_si128(edge[0], _mm_or_si128(edge[1], edge[2]));
+            mask = _mm_and_si128(mask, _mm_cmpgt_epi32(any, _mm_set1_epi32(-1)));
+        }
+        if(_mm_movemask_epi8(mask) != 0) {
+            __m128i old_z = _mm_setzero_si128(), new_z = _mm_setzero_si128();
+            if(z_buffer != NULL) {
+                // 16 bit depths are widened to 32 bit for the compare
+                old_z = s->narrow ? _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*) &((const uint16_t*) z_buffer)[index]),
+                                                       _mm_setzero_si128())
+                                  : _mm_loadu_si128((const __m128i*) &((const int*) z_buffer)[index]);
+                new_z = s->float_depth ? _mm_sub_epi32(_mm_set1_epi32(DEPTH_FLOAT_KEY_ONE), _mm_castps_si128(depth))
+                                       : _mm_cvttps_epi32(depth);
+                mask = _mm_and_si128(mask, _mm_cmplt_epi32(new_z, old_z));
+            }
+            RASTER_STAT_ADD(depth_tests, HALFSPACE_BLOCK);
+
+            int bits = _mm_movemask_ps(_mm_castsi128_ps(mask));
+            if(bits != 0) {
+                if(z_buffer != NULL) {
+                    __m128i merged = _mm_or_si128(_mm_and_si128(mask, new_z), _mm_andnot_si128(mask, old_z));
+                    if(s->narrow) {
+                        // depths are below 2^16, moved into the signed range for the saturating pack
+                        const __m128i half = _mm_set1_epi32(0x8000);
+                        merged = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(merged, half), _mm_setzero_si128()),
+                                               _mm_set1_epi16((short) 0x8000));
+                        _mm_storel_epi64((__m128i*) &((uint16_t*) z_buffer)[index], merged);
+                    } else {
+                        _mm_storeu_si128((__m128i*) &((int*) z_buffer)[index], merged);
+                    }
+                }
+                if(s->gouraud) {
+                    // red, green, blue as in _RGB32BIT
+                    rgb = _mm_or_si128(_mm_cvttps_epi32(channel[0]),
+                          _mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(channel[1]), 8),
+                                       _mm_slli_epi32(_mm_cvttps_epi32(channel[2]), 16)));
+                }
+                __m128i old_rgb = _mm_loadu_si128((const __m128i*) &pixelmap[index]);
+                _mm_storeu_si128((__m128i*) &pixelmap[index],
+                                 _mm_or_si128(_mm_and_si128(mask, rgb), _mm_andnot_si128(mask, old_rgb)));
+#ifdef RASTER_STATS
+                for(int i = 0; i < HALFSPACE_BLOCK; i++) {
+                    if(bits & (1 << i)) {
+                        RASTER_STAT(depth_passes);
+                        RASTER_STAT_WRITE(index + i);
+                    }
+                }
+#endif
+            }
+        }
+
+        // next row
+        for(int e = 0; e < 3; e++) {
+            edge[e] = _mm_add_epi32(edge[e], edge_dy[e]);
+        }
+        depth = _mm_add_ps(depth, depth_dy);
+        if(s->gouraud) {
+            for(int c = 0; c < 3; c++) {
+                channel[c] = _mm_add_ps(channel[c], channel_dy[c]);
+            }
+        }
+    }
+}
+
+#else
+
+// Rasterizes block with top left corner x,y, w holds the edge values at the
+// corner. full skips the edge tests (and the depth test without z_buffer).
+static void halfspace_block(const Setup* s, int x, int y, const int* w, int full,
+                            uint32_t* pixelmap, void* z_buffer) {
+    for(int py = y; py < y + HALFSPACE_BLOCK && py <= s->max_y; py++) {
+        RASTER_STAT(scanlines);
+        for(int px = x; px < x + HALFSPACE_BLOCK && px <= s->max_x; px++) {
+            if(!full) {
+                int inside = 1;
+                for(int e = 0; e < 3; e++) {
+                    if(w[e] + (s->edges[e].a * (px - x)) + (s->edges[e].b * (py - y)) < 0) {
+                        inside = 0;
+                    }
+                }
+                if(!inside) {
+                    continue;
+                }
+            }
+            int index = (py * WINDOW_WIDTH) + px;
+            int key = depth_key(s->z.base + (s->z.dx * px) + (s->z.dy * py), s->float_depth);
+            RASTER_STAT(depth_tests);
+            if(z_buffer == NULL || key < depth_read(z_buffer, index, s->narrow)) {
+                RASTER_STAT(depth_passes);
+                RASTER_STAT_WRITE(index);
+                if(z_buffer != NULL) {
+                    depth_write(z_buffer, index, key, s->narrow);
+                }
+                if(s->gouraud) {
+                    int value[3];
+                    for(int c = 0; c < 3; c++) {
+                        const Plane* p = &s->channels[c];
+                        value[c] = (int) (p->base + (p->dx * px) + (p->dy * py));
+                    }
+                    pixelmap[index] = _RGB32BIT(0, value[0], value[1], value[2]);
+                } else {
+                    pixelmap[index] = s->color;
+                }
+            }
+        }
+    }
+}
+
+#endif
+
+// Draws triangle with edge functions evaluated over 4x4 pixel blocks (SSE2 rows
+// of 4 pixels), skipping blocks outside the triangle and filling blocks inside
+// it without edge tests. Depth and color are interpolated with plane equations.
+// Takes the same input as draw_triangle_3D_z (mode FLAT_SHADING uses color[0],
+// GOURAUD_SHADING interpolates color[0..2], a NULL z_buffer paints over every
+// pixel). Coordinates must be within +-HALFSPACE_MAX_COORD.
+void draw_triangle_halfspace(int x1, int y1, int z1,
+                             int x2, int y2, int z2,
+                             int x3, int y3, int z3,
+                             int color[4], uint32_t* pixelmap, void *z_buffer, int mode)
+{
+    int c1 = color[0], c2 = color[1], c3 = color[2];
+    int area = ((x2 - x1) * (y3 - y1)) - ((x3 - x1) * (y2 - y1));
+
+    if(area == 0) {
+        RASTER_STAT(rejected_degenerate);
+        return;
+    }
+    // make triangle counter-clockwise so the inside of every edge is positive
+    if(area < 0) {
+        int temp;
+        temp = x2; x2 = x3; x3 = temp;
+        temp = y2; y2 = y3; y3 = temp;
+        temp = z2; z2 = z3; z3 = temp;
+        temp = c2; c2 = c3; c3 = temp;
+        area = -area;
+    }
+
+    // bounding box clipped to screen, start aligned to block grid
+    int min_x = x1, max_x = x1, min_y = y1, max_y = y1;
+    if(x2 < min_x) { min_x = x2; } if(x2 > max_x) { max_x = x2; }
+    if(x3 < min_x) { min_x = x3; } if(x3 > max_x) { max_x = x3; }
+    if(y2 < min_y) { min_y = y2; } if(y2 > max_y) { max_y = y2; }
+    if(y3 < min_y) { min_y = y3; } if(y3 > max_y) { max_y = y3; }
+    // clipped to the band and columns of the calling thread (raster_band,
+    // raster_columns), which lie inside the clipping rectangle
+    int first, last, left, right;
+    raster_band(&first, &last);
+    raster_columns(&left, &right);
+    if(min_x < left) { min_x = left; }
+    if(max_x > right) { max_x = right; }
+    if(min_y < first) { min_y = first; }
+    if(max_y > last) { max_y = last; }
+    if(min_x > max_x || min_y > max_y) {
+        RASTER_STAT(rejected_offscreen);
+        return;
+    }
+    min_x -= min_x % HALFSPACE_BLOCK;
+    min_y -= min_y % HALFSPACE_BLOCK;
+
+    Setup setup;
+    setup.edges[0] = edge_create(x1, y1, x2, y2);
+    setup.edges[1] = edge_create(x2, y2, x3, y3);
+    setup.edges[2] = edge_create(x3, y3, x1, y1);
+    for(int e = 0; e < 3; e++) {
+        int a = setup.edges[e].a, b = setup.edges[e].b;
+        // the inside is right of left edges (a > 0) and below top edges (a == 0, b > 0)
+        if(!(a > 0 || (a == 0 && b > 0))) {
+            setup.edges[e].c--;
+        }
+        setup.block_max[e] = (((a > 0) ? a : 0) + ((b > 0) ? b : 0)) * (HALFSPACE_BLOCK - 1);
+        setup.block_min[e] = (((a < 0) ? a : 0) + ((b < 0) ? b : 0)) * (HALFSPACE_BLOCK - 1);
+    }
+
+    float inverse_area = 1.0f / area;
+    setup.z       = plane_create(z1, z2, z3, x1, y1, x2, y2, x3, y3, inverse_area);
+    setup.float_depth = depth_is_float();
+    setup.narrow      = depth_is_16();
+    setup.gouraud = (mode == GOURAUD_SHADING);
+    setup.color   = c1;
+    setup.max_x   = max_x;
+    setup.max_y   = max_y;
+    if(setup.gouraud) {
+        for(int c = 0; c < 3; c++) {
+            int shift = 8 * c;
+            setup.channels[c] = plane_create((c1 >> shift) & 0xFF, (c2 >> shift) & 0xFF, (c3 >> shift) & 0xFF,
+                                             x1, y1, x2, y2, x3, y3, inverse_area);
+        }
+    }
+
+    // offsets from depth at block corner to smallest and largest depth inside the block
+    int   hiz = hiz_active(z_buffer);
+    float depth_low  = (((setup.z.dx < 0) ? setup.z.dx : 0) + ((setup.z.dy < 0) ? setup.z.dy : 0)) *
+                       (HALFSPACE_BLOCK - 1),
+          depth_high = (((setup.z.dx > 0) ? setup.z.dx : 0) + ((setup.z.dy > 0) ? setup.z.dy : 0)) *
+                       (HALFSPACE_BLOCK - 1);
+
+    // edge values at the corner of the first block of the current block row
+    int row[3];
+    for(int e = 0; e < 3; e++) {
+        row[e] = edge_at(&setup.edges[e], min_x, min_y);
+    }
+    for(int block_y = min_y; block_y <= max_y; block_y += HALFSPACE_BLOCK) {
+        int w[3] = { row[0], row[1], row[2] };
+        int entered = 0;
+        for(int block_x = min_x; block_x <= max_x; block_x += HALFSPACE_BLOCK) {
+            // whole block rejection and acceptance
+            int outside = (w[0] + setup.block_max[0] < 0) || (w[1] + setup.block_max[1] < 0) ||
+                          (w[2] + setup.block_max[2] < 0);
+            if(outside && entered) {
+                // triangle is convex, the rest of the block row is outside too
+                break;
+            }
+            if(!outside) {
+                entered = 1;
+                int full = (w[0] + setup.block_min[0] >= 0) && (w[1] + setup.block_min[1] >= 0) &&
+                           (w[2] + setup.block_min[2] >= 0);
+                // a block lies inside one hierarchical z tile, the plane is
+                // nearest at one of its corners
+                if(hiz && hiz_tile_hidden(block_x, block_y, block_key(&setup, block_x, block_y, depth_low, depth_high))) {
+                    RASTER_STAT(spans_hiz);
+                } else {
+                    halfspace_block(&setup, block_x, block_y, w, full, pixelmap, z_buffer);
+                }
+            }
+            for(int e = 0; e < 3; e++) {
+                w[e] += setup.edges[e].a * HALFSPACE_BLOCK;
+            }
+        }
+        for(int e = 0; e < 3; e++) {
+            row[e] += setup.edges[e].b * HALFSPACE_BLOCK;
+        }
+    }
+}
@@ -0,0 +1,333 @@
+#include "polygon.h"
+#include "rasterstats.h"
+#include "hiz.h"
+#include "depth.h"
+#include <math.h>
+#include <string.h>
+
+/* Span buffer (S-buffer) hidden surface removal.
+   Instead of testing every pixel against a z-buffer, every row of the screen
+   keeps an array of non-overlapping spans sorted by x, each naming the
+   triangle that is visible there. A triangle is inserted row by row: the
+   first span it reaches is found with a binary search, where it covers
+   nothing it is added as is and where it overlaps a span the two depth planes
+   are compared once for the whole overlap (they are linear in x, so at most
+   one crossing splits it). Only the part where the new triangle is nearer
+   replaces the old one, and a row it is hidden in stays untouched. Once the
+   whole list is inserted every pixel is written exactly once, spans with
+   their color and gaps black, so neither the pixelmap nor a z-buffer is
+   cleared or read. Rows are covered with the edge functions of the half-space
+   rasterizer (pixels on an edge are inside), depth and color are plane
+   equations like there. */
+
+#define SPAN_DEPTH_MARGIN 0.5   // nearer by less is a tie, like keys truncated to integers
+
+// Pixels x_start..x_end of a row where triangle id is visible.
+typedef struct {
+    int16_t x_start, x_end;
+    int32_t id;
+}Span;
+
+// Planes of an inserted triangle.
+typedef struct {
+    double depth_base, depth_dx, depth_dy;  // smaller is nearer, whatever the depth format
+    float  base[3], dx[3], dy[3];           // red, green, blue (only set when gouraud)
+    int    gouraud;
+    int    color;                           // color of FLAT_SHADING
+}SpanTriangle;
+
+// Hidden surface removal used by draw_poly_list_z, HSR_ZBUFFER or HSR_SBUFFER.
+static int hsr = HSR_ZBUFFER;
+
+// Spans of the current frame, a span covers at least one pixel so a row never
+// holds more than WINDOW_WIDTH of them.
+static struct {
+    Span rows[WINDOW_HEIGHT][WINDOW_WIDTH];
+    int  spans[WINDOW_HEIGHT];      // spans in each row
+    SpanTriangle triangles[MAX_POLYS_PER_FRAME * 2];
+    int count;
+}sbuffer;
+
+// Selects z-buffer or span buffer hidden surface removal.
+void raster_set_hsr(int mode) {
+    hsr = (mode == HSR_SBUFFER) ? HSR_SBUFFER : HSR_ZBUFFER;
+}
+
+// Returns hidden surface removal in use.
+int raster_hsr(void) {
+    return hsr;
+}
+
+// Returns name of hidden surface removal ("zbuffer" or "sbuffer").
+const char* raster_hsr_name(int mode) {
+    return (mode == HSR_SBUFFER) ? "sbuffer" : "zbuffer";
+}
+
+// Largest integer not above n / d, d must be positive.
+static inline int64_t floor_div(int64_t n, int64_t d) {
+    int64_t q = n / d;
+    return (q * d > n) ? q - 1 : q;
+}
+
+// Appends pixels x_start..x_end of triangle id to pieces, merged into the last
+// piece when it is the same triangle ending right before. Returns amount of pieces.
+static inline int piece_add(Span* pieces, int amount, int x_start, int x_end, int id) {
+    if(amount > 0 && pieces[amount - 1].id == id && pieces[amount - 1].x_end + 1 == x_start) {
+        pieces[amount - 1].x_end = (int16_t) x_end;
+        return amount;
+    }
+    pieces[amount] = (Span) { (int16_t) x_start, (int16_t) x_end, id };
+    return amount + 1;
+}
+
+// Inserts pixels x_start..x_end of row y of triangle id, whose depth along the
+// row is depth + depth_dx * x. Only pixels where it is nearer than the span
+// already there are taken over (ties keep the earlier triangle like the z-buffer).
+static void span_insert(int y, int x_start, int x_end, int id, double depth, double depth_dx) {
+    Span* row = sbuffer.rows[y];
+    int spans = sbuffer.spans[y];
+    Span pieces[WINDOW_WIDTH];      // replace the overlapped spans, never more pixels than a row
+    int amount = 0, changed = 0, x = x_start;
+
+    RASTER_STAT(scanlines);
+    // first span not left of x_start
+    int low = 0, high = spans;
+    while(low < high) {
+        int middle = (low + high) >> 1;
+        if(row[middle].x_end < x_start) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    int first = low, last = low;
+
+    for(; last < spans && row[last].x_start <= x_end; last++) {
+        const Span* s = &row[last];
+        if(s->x_start > x) {
+            // gap left of the span
+            amount = piece_add(pieces, amount, x, s->x_start - 1, id);
+            changed = 1;
+            x = s->x_start;
+        }
+
+        // overlap x..end, new minus old depth is linear and crosses 0 at most once
+        int end = (s->x_end < x_end) ? s->x_end : x_end;
+        const SpanTriangle* old = &sbuffer.triangles[s->id];
+        double offset = depth - (old->depth_base + (old->depth_dy * y)) + SPAN_DEPTH_MARGIN,
+               slope  = depth_dx - old->depth_dx;
+        int near_first = (offset + (slope * x) < 0),
+            near_last  = (offset + (slope * end) < 0),
+            win_start = x, win_end = end;
+        RASTER_STAT(depth_tests);
+
+        if(near_first != near_last) {
+            // last pixel on the side of x, moved onto the exact pixel
+            double guess = floor(-offset / slope);
+            int cross = (guess < x) ? x : ((guess >= end) ? end - 1 : (int) guess);
+            while(cross > x && ((offset + (slope * cross) < 0) != near_first)) {
+                cross--;
+            }
+            while(cross < end - 1 && ((offset + (slope * (cross + 1)) < 0) == near_first)) {
+                cross++;
+            }
+            if(near_first) {
+                win_end = cross;
+            } else {
+                win_start = cross + 1;
+            }
+        } else if(!near_first) {
+            // old triangle is in front of the whole overlap
+            win_start = end + 1;
+        }
+
+        if(win_start <= win_end) {
+            RASTER_STAT(depth_passes);
+            changed = 1;
+            if(win_start > s->x_start) {
+                amount = piece_add(pieces, amount, s->x_start, win_start - 1, s->id);
+            }
+            amount = piece_add(pieces, amount, win_start, win_end, id);
+            if(win_end < s->x_end) {
+                amount = piece_add(pieces, amount, win_end + 1, s->x_end, s->id);
+            }
+        } else {
+            amount = piece_add(pieces, amount, s->x_start, s->x_end, s->id);
+        }
+        x = end + 1;
+    }
+    if(x <= x_end) {
+        amount = piece_add(pieces, amount, x, x_end, id);
+        changed = 1;
+    }
+
+    // triangle is hidden in this row
+    if(!changed) {
+        return;
+    }
+    // pieces take the place of spans first..last - 1
+    memmove(&row[first + amount], &row[last], sizeof(Span) * (spans - last));
+    memcpy(&row[first], pieces, sizeof(Span) * amount);
+    sbuffer.spans[y] = spans - (last - first) + amount;
+}
+
+// Inserts triangle t of project_facet into the rows it covers.
+static void span_insert_triangle(const RasterTriangle* t) {
+    int x1 = t->x[0], y1 = t->y[0], x2 = t->x[1], y2 = t->y[1], x3 = t->x[2], y3 = t->y[2];
+    int z1 = t->z[0], z2 = t->z[1], z3 = t->z[2];
+    int c1 = t->color[0], c2 = t->color[1], c3 = t->color[2];
+    int64_t area = ((int64_t) (x2 - x1) * (y3 - y1)) - ((int64_t) (x3 - x1) * (y2 - y1));
+
+    if(area == 0) {
+        RASTER_STAT(rejected_degenerate);
+        return;
+    }
+    // make triangle counter-clockwise so the inside of every edge is positive
+    if(area < 0) {
+        int temp;
+        temp = x2; x2 = x3; x3 = temp;
+        temp = y2; y2 = y3; y3 = temp;
+        temp = z2; z2 = z3; z3 = temp;
+        temp = c2; c2 = c3; c3 = temp;
+        area = -area;
+    }
+
+    int min_y = MIN(y1, MIN(y2, y3)),
+        max_y = (y1 > y2) ? ((y1 > y3) ? y1 : y3) : ((y2 > y3) ? y2 : y3);
+    if(min_y < poly_clip_min_y) { min_y = poly_clip_min_y; }
+    if(max_y > (poly_clip_max_y)) { max_y = (poly_clip_max_y); }
+    if(min_y > max_y || sbuffer.count >= MAX_POLYS_PER_FRAME * 2) {
+        RASTER_STAT(rejected_offscreen);
+        return;
+    }
+
+    int id = sbuffer.count++;
+    SpanTriangle* s = &sbuffer.triangles[id];
+    int sign = depth_is_float() ? -1 : 1;   // float depths grow toward the near plane
+    double inverse_area = 1.0 / (double) area;
+    s->depth_dx   = sign * (((double) (z2 - z1) * (y3 - y1)) - ((double) (z3 - z1) * (y2 - y1))) * inverse_area;
+    s->depth_dy   = sign * (((double) (z3 - z1) * (x2 - x1)) - ((double) (z2 - z1) * (x3 - x1))) * inverse_area;
+    s->depth_base = (sign * (double) z1) - (s->depth_dx * x1) - (s->depth_dy * y1);
+    s->gouraud    = (t->mode == GOURAUD_SHADING);
+    s->color      = c1;
+    if(s->gouraud) {
+        float inverse_area_f = 1.0f / area;
+        for(int c = 0; c < 3; c++) {
+            int shift = 8 * c;
+            float v0 = (c1 >> shift) & 0xFF, v1 = (c2 >> shift) & 0xFF, v2 = (c3 >> shift) & 0xFF;
+            s->dx[c]   = ((v1 - v0) * (y3 - y1) - (v2 - v0) * (y2 - y1)) * inverse_area_f;
+            s->dy[c]   = ((v2 - v0) * (x2 - x1) - (v1 - v0) * (x3 - x1)) * inverse_area_f;
+            s->base[c] = v0 - (s->dx[c] * x1) - (s->dy[c] * y1);
+        }
+    }
+
+    // edge functions E(x,y) = a*x + b*y + c of the edges 1-2, 2-3 and 3-1,
+    // with v = b*y + c a row is inside an edge from x = -floor(v / a) on when
+    // a > 0 and up to x = floor(v / -a) when a < 0. The floor is stepped from
+    // row to row as quotient and remainder, so only the first row divides.
+    int64_t a[3] = { y1 - y2, y2 - y3, y3 - y1 },
+            b[3] = { x2 - x1, x3 - x2, x1 - x3 },
+            c[3] = { ((int64_t) x1 * y2) - ((int64_t) x2 * y1),
+                     ((int64_t) x2 * y3) - ((int64_t) x3 * y2),
+                     ((int64_t) x3 * y1) - ((int64_t) x1 * y3) };
+    int64_t value[3], divisor[3], quotient[3] = { 0 }, remainder[3] = { 0 },
+            step_quotient[3] = { 0 }, step_remainder[3] = { 0 };
+    for(int e = 0; e < 3; e++) {
+        value[e]   = (b[e] * min_y) + c[e];
+        divisor[e] = (a[e] < 0) ? -a[e] : a[e];
+        if(divisor[e] != 0) {
+            quotient[e]       = floor_div(value[e], divisor[e]);
+            remainder[e]      = value[e] - (quotient[e] * divisor[e]);
+            step_quotient[e]  = floor_div(b[e], divisor[e]);
+            step_remainder[e] = b[e] - (step_quotient[e] * divisor[e]);
+        }
+    }
+
+    for(int y = min_y; y <= max_y; y++) {
+        // pixels of the row with all 3 edge functions >= 0
+        int64_t left = poly_clip_min_x, right = (poly_clip_max_x);
+        for(int e = 0; e < 3; e++) {
+            if(a[e] > 0) {
+                left = (-quotient[e] > left) ? -quotient[e] : left;
+            } else if(a[e] < 0) {
+                right = (quotient[e] < right) ? quotient[e] : right;
+            } else if(value[e] < 0) {
+                right = left - 1;
+            }
+            value[e]     += b[e];
+            quotient[e]  += step_quotient[e];
+            remainder[e] += step_remainder[e];
+            if(remainder[e] >= divisor[e] && divisor[e] != 0) {
+                remainder[e] -= divisor[e];
+                quotient[e]++;
+            }
+        }
+        if(left <= right) {
+            span_insert(y, (int) left, (int) right, id, s->depth_base + (s->depth_dy * y), s->depth_dx);
+        }
+    }
+}
+
+// Writes every pixel of row y once: the color of the span covering it, black
+// where no span does.
+static void span_row_draw(int y, uint32_t* pixelmap) {
+    uint32_t* row = &pixelmap[y * WINDOW_WIDTH];
+    int x = 0;
+
+    for(int span = 0; span < sbuffer.spans[y]; span++) {
+        const Span* s = &sbuffer.rows[y][span];
+        const SpanTriangle* t = &sbuffer.triangles[s->id];
+        for(; x < s->x_start; x++) {
+            row[x] = 0;
+        }
+#ifdef RASTER_STATS
+        for(int i = s->x_start; i <= s->x_end; i++) {
+            RASTER_STAT_WRITE((y * WINDOW_WIDTH) + i);
+        }
+#endif
+        if(t->gouraud) {
+            float red   = t->base[0] + (t->dx[0] * x) + (t->dy[0] * y),
+                  green = t->base[1] + (t->dx[1] * x) + (t->dy[1] * y),
+                  blue  = t->base[2] + (t->dx[2] * x) + (t->dy[2] * y);
+            for(; x <= s->x_end; x++) {
+                row[x] = _RGB32BIT(0, (int) red, (int) green, (int) blue);
+                red   += t->dx[0];
+                green += t->dx[1];
+                blue  += t->dx[2];
+            }
+        } else {
+            for(; x <= s->x_end; x++) {
+                row[x] = t->color;
+            }
+        }
+    }
+    for(; x < WINDOW_WIDTH; x++) {
+        row[x] = 0;
+    }
+}
+
+// Draws the poly list into pixelmap with a span buffer instead of a z-buffer,
+// every pixel of pixelmap is written exactly once (black where nothing is).
+// Textured facets are drawn with their color.
+// Always runs on the calling thread. The tiles of pixelmap count as drawn,
+// so buffers_resolve leaves the result alone.
+void draw_poly_list_spans(facet **world_polys, int num_polys, uint32_t* pixelmap) {
+    RasterTriangle triangles[2];
+
+    sbuffer.count = 0;
+    memset(sbuffer.spans, 0, sizeof(sbuffer.spans));
+
+    for(int curr_poly = 0; curr_poly < num_polys; curr_poly++) {
+        int count = project_facet(world_polys[curr_poly], triangles);
+        for(int i = 0; i < count; i++) {
+            span_insert_triangle(&triangles[i]);
+        }
+    }
+
+    for(int y = 0; y < WINDOW_HEIGHT; y++) {
+        span_row_draw(y, pixelmap);
+    }
+    if(tiles_active_painted(pixelmap)) {
+        tiles_cover();
+    }
+}
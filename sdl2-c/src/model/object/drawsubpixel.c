@@ -0,0 +1,284 @@
+#include "polygon.h"
+#include "rasterstats.h"
+#include "hiz.h"
+#include "depth.h"
+#include "plane.h"
+
+/* Sub-pixel scanline rasterizer (RASTER_SUBPIXEL stepping).
+   The other scanline fillers truncate the vertices to whole pixels and draw
+   every span from its first to its last pixel inclusive, so the pixels along
+   an edge shared by two triangles are depth tested and drawn by both of them,
+   and the truncation leaves cracks elsewhere. Here the vertices keep 4 bits of
+   sub-pixel position (28.4 fixed point) and a pixel is drawn when its center
+   is inside the triangle. A center exactly on an edge belongs to the triangle
+   right of it (left edges are inside, right edges outside) and below it for a
+   horizontal edge (top edges inside, bottom edges outside), so every pixel
+   along a shared edge is drawn exactly once. The first pixel of each row is
+   the ceiling of the exact edge position, stepped as an integer quotient and
+   remainder, so it is exact on every row wherever the first row starts. */
+
+// Edge stepped row by row. x is the first pixel whose center is at or right
+// of the edge, x = ceil(numerator / denominator) with the remainder
+// numerator - x * denominator kept in (-denominator, 0].
+typedef struct {
+    int64_t x, remainder;
+    int64_t step, remainder_step;   // per row, remainder_step in [0, denominator)
+    int64_t denominator;
+}SubpixelEdge;
+
+// Planes of depth and color channels, value(x,y) = base + dx * (x - x0) + dy * (y - y0)
+// at the center of pixel x,y, with x0,y0 the first vertex (keeps large depths precise).
+typedef struct {
+    float x0, y0;
+    float z[3];                     // base, dx and dy of the depth value
+    float channel[3][3];            // base, dx and dy of red, green and blue
+    int   color;                    // color of a flat triangle
+    int   gouraud;
+    int   hiz;                      // spans are tested against hierarchical z
+    int   float_depth;
+    int   narrow;                   // z-buffer holds 16 bit depths
+    int   column_first,             // columns the calling thread may draw
+          column_last;
+}SubpixelPlanes;
+
+// a / b rounded down, b > 0.
+static inline int64_t floor_div(int64_t a, int64_t b) {
+    int64_t quotient = a / b;
+    return ((a % b) < 0) ? quotient - 1 : quotient;
+}
+
+// First pixel (row or column) whose center is at or beyond 28.4 position v.
+static inline int first_pixel(int v) {
+    return (v - (SUBPIXEL_ONE / 2) + (SUBPIXEL_ONE - 1)) >> SUBPIXEL_BITS;
+}
+
+// Sets up edge from xa,ya to xb,yb (ya < yb) at the center of row.
+static void edge_setup(SubpixelEdge* e, int xa, int ya, int xb, int yb, int row) {
+    int64_t dx = (int64_t) xb - xa, dy = (int64_t) yb - ya;
+    // edge is at xa + (center - ya) * dx / dy, first pixel is ceil((x - half pixel) / pixel)
+    int64_t numerator = (((int64_t) xa - (SUBPIXEL_ONE / 2)) * dy) + (((int64_t) subpixel_from_pixel(row) - ya) * dx);
+
+    e->denominator    = dy * SUBPIXEL_ONE;
+    e->x              = -floor_div(-numerator, e->denominator);
+    e->remainder      = numerator - (e->x * e->denominator);
+    e->step           = floor_div(dx * SUBPIXEL_ONE, e->denominator);
+    e->remainder_step = (dx * SUBPIXEL_ONE) - (e->step * e->denominator);
+}
+
+// Moves edge to the next row.
+static inline void edge_step(SubpixelEdge* e) {
+    e->remainder += e->remainder_step;
+    // the carry follows the slope of the edge and is hard to predict, so no branch
+    int64_t carry = (e->remainder > 0);
+    e->x         += e->step + carry;
+    e->remainder -= e->denominator & -carry;
+}
+
+// Sorts the 28.4 vertices x, y into s and finds the rows to draw inside the
+// clipping rectangle and the band of the calling thread. Returns 0 if the
+// triangle has no area or no pixel to draw.
+int subpixel_triangle_setup(SubpixelTriangle* s, const int x[3], const int y[3]) {
+    int first = 0, middle = 1, last = 2, temp,
+        band_first, band_last;
+
+    // sort p1, p2, p3 in ascending y order
+    if(y[middle] < y[first]) { temp = middle; middle = first; first = temp; }
+    if(y[last] < y[first])   { temp = last; last = first; first = temp; }
+    if(y[last] < y[middle])  { temp = last; last = middle; middle = temp; }
+    s->x[0] = x[first];  s->y[0] = y[first];
+    s->x[1] = x[middle]; s->y[1] = y[middle];
+    s->x[2] = x[last];   s->y[2] = y[last];
+
+    // vertex 1 right of edge 0-2 makes it the left edge
+    int64_t area = (((int64_t) s->x[1] - s->x[0]) * ((int64_t) s->y[2] - s->y[0])) -
+                   (((int64_t) s->x[2] - s->x[0]) * ((int64_t) s->y[1] - s->y[0]));
+    if(area == 0) {
+        RASTER_STAT(rejected_degenerate);
+        return 0;
+    }
+    s->long_left = (area > 0);
+
+    // do trivial rejection tests on the pixels the centers rule can reach
+    int min_x = MIN(s->x[0], MIN(s->x[1], s->x[2])),
+        max_x = (s->x[0] > s->x[1]) ? ((s->x[0] > s->x[2]) ? s->x[0] : s->x[2]) : ((s->x[1] > s->x[2]) ? s->x[1] : s->x[2]);
+    s->row_first  = first_pixel(s->y[0]);
+    s->row_middle = first_pixel(s->y[1]);
+    s->row_end    = first_pixel(s->y[2]);
+    if(s->row_end <= poly_clip_min_y || s->row_first > (poly_clip_max_y) ||
+       first_pixel(max_x) <= poly_clip_min_x || first_pixel(min_x) > (poly_clip_max_x)) {
+        RASTER_STAT(rejected_offscreen);
+        return 0;
+    }
+
+    // clip rows to the band (always inside the clipping rectangle)
+    raster_band(&band_first, &band_last);
+    if(s->row_first < band_first) {
+        s->row_first = band_first;
+    }
+    if(s->row_end > band_last + 1) {
+        s->row_end = band_last + 1;
+    }
+    return s->row_first < s->row_end;
+}
+
+// Body of subpixel_triangle_spans, inlined into draw_triangle_subpixel so its
+// span function is called directly.
+static inline void triangle_spans(const SubpixelTriangle* s, SubpixelSpan span, const void* data,
+                                  uint32_t* pixelmap, void *z_buffer) {
+    SubpixelEdge long_edge, short_edge;
+    const SubpixelEdge* left  = s->long_left ? &long_edge : &short_edge;
+    const SubpixelEdge* right = s->long_left ? &short_edge : &long_edge;
+    int y = s->row_first;
+
+    edge_setup(&long_edge, s->x[0], s->y[0], s->x[2], s->y[2], y);
+    // rows above vertex 1 are bounded by edge 0-1, the rest by edge 1-2
+    for(int part = 0; part < 2; part++) {
+        int end = (part == 0 && s->row_middle < s->row_end) ? s->row_middle : s->row_end;
+        if(y >= end) {
+            continue;
+        }
+        edge_setup(&short_edge, s->x[part], s->y[part], s->x[part + 1], s->y[part + 1], y);
+
+        for(; y < end; y++) {
+            RASTER_STAT(scanlines);
+            int x_start = (left->x < poly_clip_min_x) ? poly_clip_min_x : (int) left->x,
+                x_end   = (right->x > (poly_clip_max_x)) ? (poly_clip_max_x) : (int) right->x - 1;
+            if(x_start <= x_end) {
+                span(data, y, x_start, x_end, pixelmap, z_buffer);
+            }
+            edge_step(&long_edge);
+            edge_step(&short_edge);
+        }
+    }
+}
+
+// Walks the rows of s and hands the pixels of each row to span. A pixel belongs
+// to the triangle when its center is inside, or exactly on a top or left edge
+// (top-left fill rule, rows walked with y increasing), so triangles sharing an
+// edge never both draw a pixel of it and leave no gap between them. Edges are
+// stepped exactly with integers.
+void subpixel_triangle_spans(const SubpixelTriangle* s, SubpixelSpan span, const void* data,
+                             uint32_t* pixelmap, void *z_buffer) {
+    triangle_spans(s, span, data, pixelmap, z_buffer);
+}
+
+// Draws pixels x_start..x_end of row y with the planes of data (SubpixelPlanes).
+// Every pixel center of the span is inside the triangle, so the color planes
+// never leave the range of the vertex colors (up to rounding, which the
+// truncation to a byte absorbs) and need no clamping. Only the columns of the
+// calling thread are drawn, the planes are stepped from x_start all the same.
+static void draw_subpixel_span(const void* data, int y, int x_start, int x_end, uint32_t* pixelmap, void *z_buffer) {
+    const SubpixelPlanes* p = data;
+    int painter = (z_buffer == NULL),
+        float_depth = p->float_depth,
+        narrow = p->narrow,
+        x = x_start;
+    float dx = (float) x_start - p->x0, dy = (float) y - p->y0;
+    float z = p->z[0] + (p->z[1] * dx) + (p->z[2] * dy), z_x = p->z[1];
+
+    if(x_end > p->column_last) {
+        x_end = p->column_last;
+    }
+    if(x_end < p->column_first) {
+        return;
+    }
+    // skip span when it is behind the hierarchical z tiles
+    if(p->hiz && hiz_span_hidden(y, (x < p->column_first) ? p->column_first : x, x_end,
+                                 hiz_span_key(z, z_x, x_end - x_start + 1, float_depth))) {
+        RASTER_STAT(spans_hiz);
+        return;
+    }
+
+    uint32_t* pixels = &pixelmap[y * WINDOW_WIDTH];
+    int row = y * WINDOW_WIDTH;
+    if(!p->gouraud) {
+        uint32_t color = (uint32_t) p->color;
+        // step over columns left of the tile
+        for(; x < p->column_first && x <= x_end; x++) {
+            z += z_x;
+        }
+        for(; x <= x_end; x++) {
+            RASTER_STAT(depth_tests);
+            int key = depth_key(z, float_depth);
+            if(painter || key < depth_read(z_buffer, row + x, narrow)) {
+                RASTER_STAT(depth_passes);
+                RASTER_STAT_WRITE(row + x);
+                if(!painter) {
+                    depth_write(z_buffer, row + x, key, narrow);
+                }
+                pixels[x] = color;
+            }
+            z += z_x;
+        }
+        return;
+    }
+
+    float red   = p->channel[0][0] + (p->channel[0][1] * dx) + (p->channel[0][2] * dy),
+          green = p->channel[1][0] + (p->channel[1][1] * dx) + (p->channel[1][2] * dy),
+          blue  = p->channel[2][0] + (p->channel[2][1] * dx) + (p->channel[2][2] * dy),
+          red_x = p->channel[0][1], green_x = p->channel[1][1], blue_x = p->channel[2][1];
+    for(; x < p->column_first && x <= x_end; x++) {
+        z     += z_x;
+        red   += red_x;
+        green += green_x;
+        blue  += blue_x;
+    }
+    for(; x <= x_end; x++) {
+        RASTER_STAT(depth_tests);
+        int key = depth_key(z, float_depth);
+        if(painter || key < depth_read(z_buffer, row + x, narrow)) {
+            RASTER_STAT(depth_passes);
+            RASTER_STAT_WRITE(row + x);
+            if(!painter) {
+                depth_write(z_buffer, row + x, key, narrow);
+            }
+            pixels[x] = (uint32_t) _RGB32BIT(0, (int) red, (int) green, (int) blue);
+        }
+        z     += z_x;
+        red   += red_x;
+        green += green_x;
+        blue  += blue_x;
+    }
+}
+
+// Draws triangle t by its 28.4 vertices sx, sy with subpixel_triangle_spans.
+// Depth and color are plane equations evaluated at the pixel centers (color
+// shaded as t->mode, texture ignored). Depth test, hierarchical z, epoch tiles
+// and bands work as in draw_triangle_3D_z.
+void draw_triangle_subpixel(const RasterTriangle* t, uint32_t* pixelmap, void *z_buffer) {
+    SubpixelTriangle s;
+    SubpixelPlanes p;
+    double x[3], y[3];
+
+    if(!subpixel_triangle_setup(&s, t->sx, t->sy) ||
+       triangle_tiles_hidden(t->sx[0] >> SUBPIXEL_BITS, t->sy[0] >> SUBPIXEL_BITS, t->z[0],
+                             t->sx[1] >> SUBPIXEL_BITS, t->sy[1] >> SUBPIXEL_BITS, t->z[1],
+                             t->sx[2] >> SUBPIXEL_BITS, t->sy[2] >> SUBPIXEL_BITS, t->z[2], pixelmap, z_buffer)) {
+        return;
+    }
+
+    // vertices moved half a pixel, so pixel x,y samples the planes at its center
+    for(int i = 0; i < 3; i++) {
+        x[i] = ((double) t->sx[i] / SUBPIXEL_ONE) - 0.5;
+        y[i] = ((double) t->sy[i] / SUBPIXEL_ONE) - 0.5;
+    }
+    double inverse_area = 1.0 / (((x[1] - x[0]) * (y[2] - y[0])) - ((x[2] - x[0]) * (y[1] - y[0])));
+    p.x0          = (float) x[0];
+    p.y0          = (float) y[0];
+    p.color       = t->color[0];
+    p.gouraud     = (t->mode == GOURAUD_SHADING);
+    p.hiz         = hiz_active(z_buffer);
+    p.float_depth = depth_is_float();
+    p.narrow      = depth_is_16();
+    raster_columns(&p.column_first, &p.column_last);
+    raster_plane(p.z, x, y, t->z[0], t->z[1], t->z[2], inverse_area);
+    if(p.gouraud) {
+        for(int c = 0; c < 3; c++) {
+            int shift = 8 * c;
+            double v0 = (t->color[0] >> shift) & 0xFF, v1 = (t->color[1] >> shift) & 0xFF, v2 = (t->color[2] >> shift) & 0xFF;
+            raster_plane(p.channel[c], x, y, v0, v1, v2, inverse_area);
+        }
+    }
+
+    triangle_spans(&s, draw_subpixel_span, &p, pixelmap, z_buffer);
+}
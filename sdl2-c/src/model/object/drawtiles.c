@@ -0,0 +1,263 @@
+#include "polygon.h"
+#include "hiz.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Tile binned rasterization.
+   The poly list is projected once, every triangle is binned into the
+   TILE_SIZE x TILE_SIZE tiles its bounding box overlaps and each thread then
+   rasterizes whole tiles, so no two threads ever write the same pixel and the
+   framebuffer needs no locks or atomics. The scanline fillers step their edges
+   and interpolants row by row and pixel by pixel in float, so rows above and
+   columns left of a tile are stepped, not jumped over (see raster_set_band and
+   raster_set_columns), which leaves every pixel with exactly the value of the
+   serial path. Bins keep submission order, so z-buffer ties resolve the same
+   way too. With deferred shading a thread also shades its tiles once their
+   triangles are drawn. */
+
+// tiles must stay on the 4x4 block grid of the half-space rasterizer
+#if TILE_SIZE % 4 != 0
+#error "TILE_SIZE must be a multiple of 4"
+#endif
+
+// Triangles of the current frame binned per tile.
+static struct {
+    RasterTriangle* triangles;  // projected triangles in submission order
+    int num_triangles;
+    int max_triangles;
+    int* indices;               // triangle indices grouped by tile
+    int max_indices;
+    int start[TILES + 1];       // tile t owns indices[start[t]] .. indices[start[t + 1] - 1]
+    int first_column[MAX_POLYS_PER_FRAME * 2];  // tiles under the bounding box of a triangle
+    int last_column[MAX_POLYS_PER_FRAME * 2];
+    int first_row[MAX_POLYS_PER_FRAME * 2];
+    int last_row[MAX_POLYS_PER_FRAME * 2];
+}bins;
+
+// Worker threads, thread 0 is the one calling draw_poly_list_tiled.
+static struct {
+    int count;                  // threads rasterizing, caller included
+    pthread_t threads[RASTER_MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t start;       // signalled when a frame (or quit) is handed out
+    pthread_cond_t done;        // signalled when the last worker finished
+    int generation;             // increased for every frame handed out
+    int spawn_generation;       // generation when the workers were started
+    int busy;                   // workers still rasterizing current frame
+    int quit;
+    uint32_t* pixelmap;
+    void* z_buffer;
+}pool = { .count = 1, .lock = PTHREAD_MUTEX_INITIALIZER, .start = PTHREAD_COND_INITIALIZER,
+          .done = PTHREAD_COND_INITIALIZER };
+
+// Rasterizes tiles id, id + count, id + 2 * count, ... (interleaved so busy
+// and empty parts of the screen are spread over all threads).
+static void draw_tiles(int id, int count, uint32_t* pixelmap, void* z_buffer) {
+    int deferred = (raster_shading() == SHADE_DEFERRED);
+
+    for(int tile = id; tile < TILES; tile += count) {
+        int x = (tile % TILES_X) * TILE_SIZE, y = (tile / TILES_X) * TILE_SIZE;
+        raster_set_band(y, y + TILE_SIZE - 1);
+        raster_set_columns(x, x + TILE_SIZE - 1);
+        for(int i = bins.start[tile]; i < bins.start[tile + 1]; i++) {
+            draw_raster_triangle(&bins.triangles[bins.indices[i]], pixelmap, z_buffer);
+        }
+        if(deferred) {
+            int first, last, left, right;
+            raster_band(&first, &last);
+            raster_columns(&left, &right);
+            visibility_shade(pixelmap, left, first, right, last);
+        }
+    }
+    raster_set_band(0, WINDOW_HEIGHT - 1);
+    raster_set_columns(0, WINDOW_WIDTH - 1);
+}
+
+// Worker loop, waits for a frame, draws its tiles and reports back.
+static void* raster_worker(void* arg) {
+    int id = (int) (intptr_t) arg;
+
+    pthread_mutex_lock(&pool.lock);
+    int generation = pool.spawn_generation;
+    for(;;) {
+        while(pool.generation == generation && !pool.quit) {
+            pthread_cond_wait(&pool.start, &pool.lock);
+        }
+        if(pool.quit) {
+            break;
+        }
+        generation = pool.generation;
+        pthread_mutex_unlock(&pool.lock);
+
+        draw_tiles(id, pool.count, pool.pixelmap, pool.z_buffer);
+
+        pthread_mutex_lock(&pool.lock);
+        if(--pool.busy == 0) {
+            pthread_cond_signal(&pool.done);
+        }
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+// Stops and joins every worker thread.
+static void stop_workers(void) {
+    pthread_mutex_lock(&pool.lock);
+    pool.quit = 1;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+    for(int i = 1; i < pool.count; i++) {
+        pthread_join(pool.threads[i], NULL);
+    }
+    pool.quit  = 0;
+    pool.count = 1;
+}
+
+// Sets amount of threads drawing the poly list, the calling thread included
+// (1 = serial draw_poly_list_z). Starts or stops worker threads as needed and
+// returns amount in use. Builds with RASTER_STATS always stay serial.
+int raster_set_threads(int count) {
+#ifdef RASTER_STATS
+    // counters are plain globals
+    count = 1;
+#endif
+    if(count < 1) {
+        count = 1;
+    }
+    if(count > RASTER_MAX_THREADS) {
+        count = RASTER_MAX_THREADS;
+    }
+    if(count == pool.count) {
+        return pool.count;
+    }
+    stop_workers();
+
+    // workers wait for the first frame after the current one
+    pool.spawn_generation = pool.generation;
+    for(int i = 1; i < count; i++) {
+        if(pthread_create(&pool.threads[i], NULL, raster_worker, (void*) (intptr_t) i) != 0) {
+            printf("could not start raster thread %d, using %d\n", i, pool.count);
+            break;
+        }
+        pool.count++;
+    }
+    return pool.count;
+}
+
+// Returns amount of threads drawing the poly list.
+int raster_threads(void) {
+    return pool.count;
+}
+
+// Makes room for the triangles and bin indices of a frame, returns 0 if out of memory.
+static int bins_reserve(int triangles, int indices) {
+    if(triangles > bins.max_triangles) {
+        RasterTriangle* grown = realloc(bins.triangles, sizeof(RasterTriangle) * triangles);
+        if(grown == NULL) {
+            printf("could not allocate tile bins (triangles: %d)\n", triangles);
+            return 0;
+        }
+        bins.triangles = grown;
+        bins.max_triangles = triangles;
+    }
+    if(indices > bins.max_indices) {
+        int* grown = realloc(bins.indices, sizeof(int) * indices);
+        if(grown == NULL) {
+            printf("could not allocate tile bins (indices: %d)\n", indices);
+            return 0;
+        }
+        bins.indices = grown;
+        bins.max_indices = indices;
+    }
+    return 1;
+}
+
+// Projects the poly list, bins the triangles into tiles (TILE_SIZE x TILE_SIZE
+// pixels, submission order kept per tile) and lets every thread rasterize whole
+// tiles into pixelmap and z_buffer. The result is bit identical to the serial path.
+void draw_poly_list_tiled(facet **world_polys, int num_polys, uint32_t* pixelmap, void *z_buffer) {
+    int count[TILES] = { 0 };
+    int binned = 0;
+
+    if(num_polys > MAX_POLYS_PER_FRAME || !bins_reserve(num_polys * 2, 0)) {
+        return;
+    }
+
+    // project and find tiles of every triangle, counting entries per tile
+    bins.num_triangles = 0;
+    for(int curr_poly = 0; curr_poly < num_polys; curr_poly++) {
+        bins.num_triangles += project_facet(world_polys[curr_poly], &bins.triangles[bins.num_triangles]);
+    }
+    // ids are handed out in submission order, there is one for every triangle
+    if(raster_shading() == SHADE_DEFERRED) {
+        visibility_begin();
+        for(int i = 0; i < bins.num_triangles; i++) {
+            visibility_add(&bins.triangles[i]);
+        }
+    }
+    for(int i = 0; i < bins.num_triangles; i++) {
+        const RasterTriangle* t = &bins.triangles[i];
+        int min_y = MIN(t->y[0], MIN(t->y[1], t->y[2]));
+        int max_y = (t->y[0] > t->y[1]) ? t->y[0] : t->y[1];
+        max_y = (t->y[2] > max_y) ? t->y[2] : max_y;
+        // spans may end a pixel beyond the vertices
+        int min_x = MIN(t->x[0], MIN(t->x[1], t->x[2])) - 1;
+        int max_x = (t->x[0] > t->x[1]) ? t->x[0] : t->x[1];
+        max_x = ((t->x[2] > max_x) ? t->x[2] : max_x) + 1;
+
+        if(max_y < poly_clip_min_y || min_y > (poly_clip_max_y) ||
+           max_x < poly_clip_min_x || min_x > (poly_clip_max_x)) {
+            bins.first_row[i] = 1;
+            bins.last_row[i]  = 0;
+            continue;
+        }
+        bins.first_row[i]    = ((min_y < poly_clip_min_y) ? poly_clip_min_y : min_y) / TILE_SIZE;
+        bins.last_row[i]     = ((max_y > (poly_clip_max_y)) ? (poly_clip_max_y) : max_y) / TILE_SIZE;
+        bins.first_column[i] = ((min_x < poly_clip_min_x) ? poly_clip_min_x : min_x) / TILE_SIZE;
+        bins.last_column[i]  = ((max_x > (poly_clip_max_x)) ? (poly_clip_max_x) : max_x) / TILE_SIZE;
+        for(int row = bins.first_row[i]; row <= bins.last_row[i]; row++) {
+            for(int column = bins.first_column[i]; column <= bins.last_column[i]; column++) {
+                count[(row * TILES_X) + column]++;
+            }
+        }
+        binned += (bins.last_row[i] - bins.first_row[i] + 1) * (bins.last_column[i] - bins.first_column[i] + 1);
+    }
+    if(!bins_reserve(0, binned)) {
+        return;
+    }
+
+    // fill bins in submission order
+    bins.start[0] = 0;
+    for(int tile = 0; tile < TILES; tile++) {
+        bins.start[tile + 1] = bins.start[tile] + count[tile];
+        count[tile] = bins.start[tile];
+    }
+    for(int i = 0; i < bins.num_triangles; i++) {
+        for(int row = bins.first_row[i]; row <= bins.last_row[i]; row++) {
+            for(int column = bins.first_column[i]; column <= bins.last_column[i]; column++) {
+                bins.indices[count[(row * TILES_X) + column]++] = i;
+            }
+        }
+    }
+
+    // threads sharing a row of epoch tiles only add to its wiped mask
+    tiles_share_rows();
+
+    // hand frame to workers and take share of tiles
+    pthread_mutex_lock(&pool.lock);
+    pool.pixelmap = pixelmap;
+    pool.z_buffer = z_buffer;
+    pool.busy = pool.count - 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+
+    draw_tiles(0, pool.count, pixelmap, z_buffer);
+
+    pthread_mutex_lock(&pool.lock);
+    while(pool.busy > 0) {
+        pthread_cond_wait(&pool.done, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+}
@@ -1,10 +1,128 @@
 #include "polygon.h"
+#include "rasterstats.h"
+#include "hiz.h"
+#include "depth.h"
+#include "plane.h"
+#include "../math/fixedpoint.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Stepping used by draw_triangle_3D_z, RASTER_FLOAT, RASTER_FIXED or RASTER_SUBPIXEL.
+static int stepping = RASTER_SUBPIXEL;
+// Rasterizer used by draw_triangle_3D_z, RASTER_SCANLINE or RASTER_HALFSPACE.
+static int algorithm = RASTER_SCANLINE;
+// Texturing used by draw_raster_triangle and draw_triangle_textured.
+static int texturing = TEXTURE_16;
+// Rows and columns the calling thread may draw, the whole screen unless a tile
+// worker narrowed them with raster_set_band and raster_set_columns.
+static _Thread_local int band_first   = 0,
+                         band_last    = WINDOW_HEIGHT - 1,
+                         column_first = 0,
+                         column_last  = WINDOW_WIDTH - 1;
+
+// Selects float, 16.16 fixed point or 28.4 sub-pixel edge, z and color stepping.
+// The float and fixed point spans include both ends, so pixels on an edge shared
+// by 2 triangles are drawn twice, sub-pixel stepping (the default) draws them once.
+void raster_set_stepping(int mode) {
+    stepping = (mode == RASTER_FLOAT || mode == RASTER_FIXED) ? mode : RASTER_SUBPIXEL;
+    if(stepping == RASTER_FIXED) {
+        draw_fixed_init();
+    }
+}
+
+// Returns stepping in use.
+int raster_stepping(void) {
+    return stepping;
+}
+
+// Returns name of stepping ("float", "fixed" or "subpixel").
+const char* raster_stepping_name(int mode) {
+    return (mode == RASTER_FIXED) ? "fixed" : ((mode == RASTER_SUBPIXEL) ? "subpixel" : "float");
+}
+
+// Returns mode first..last whose name (as returned by name, e.g.
+// raster_stepping_name) is value, or -1. Used to parse the mode flags of main
+// and the benchmarks.
+int mode_from_name(const char* value, int first, int last, const char* (*name)(int)) {
+    for(int mode = first; mode <= last; mode++) {
+        if(strcmp(value, name(mode)) == 0) {
+            return mode;
+        }
+    }
+    return -1;
+}
+
+// Selects scanline (flat top/bottom spans) or half-space (edge function) rasterizer.
+void raster_set_algorithm(int mode) {
+    algorithm = (mode == RASTER_HALFSPACE) ? RASTER_HALFSPACE : RASTER_SCANLINE;
+}
+
+// Returns rasterizer in use.
+int raster_algorithm(void) {
+    return algorithm;
+}
+
+// Returns name of rasterizer ("scanline" or "halfspace").
+const char* raster_algorithm_name(int mode) {
+    return (mode == RASTER_HALFSPACE) ? "halfspace" : "scanline";
+}
+
+// Limits drawing of the calling thread to rows first..last. Rows above first are
+// still stepped through, so every band gets the same values as the whole screen.
+void raster_set_band(int first, int last) {
+    band_first = (first < poly_clip_min_y) ? poly_clip_min_y : first;
+    band_last  = (last > (poly_clip_max_y)) ? (poly_clip_max_y) : last;
+}
+
+// Returns first and last row the calling thread may draw.
+void raster_band(int* first, int* last) {
+    *first = band_first;
+    *last  = band_last;
+}
+
+// Limits drawing of the calling thread to columns first..last. Pixels left of
+// first are still stepped through, so every tile gets the same values as the
+// whole screen.
+void raster_set_columns(int first, int last) {
+    column_first = (first < poly_clip_min_x) ? poly_clip_min_x : first;
+    column_last  = (last > (poly_clip_max_x)) ? (poly_clip_max_x) : last;
+}
+
+// Returns first and last column the calling thread may draw.
+void raster_columns(int* first, int* last) {
+    *first = column_first;
+    *last  = column_last;
+}
+
+// Selects how textured triangles are drawn (TEXTURE_16 by default).
+void raster_set_texture(int mode) {
+    texturing = (mode >= TEXTURE_OFF && mode <= TEXTURE_EXACT) ? mode : TEXTURE_16;
+}
+
+// Returns texturing in use.
+int raster_texture(void) {
+    return texturing;
+}
+
+// Returns name of texturing ("off", "affine", "16", "8" or "exact").
+const char* raster_texture_name(int mode) {
+    static const char* names[] = { "off", "affine", "16", "8", "exact" };
+    return (mode >= TEXTURE_OFF && mode <= TEXTURE_EXACT) ? names[mode] : names[TEXTURE_16];
+}
+
+// Returns 1 if every coordinate fits the 16.16 range of the fixed point functions.
+static int fits_fixed_point(int x1, int y1, int z1, int x2, int y2, int z2, int x3, int y3, int z3) {
+    return abs(x1) <= FIXP16_MAX_INT && abs(y1) <= FIXP16_MAX_INT && abs(z1) <= FIXP16_MAX_INT &&
+           abs(x2) <= FIXP16_MAX_INT && abs(y2) <= FIXP16_MAX_INT && abs(z2) <= FIXP16_MAX_INT &&
+           abs(x3) <= FIXP16_MAX_INT && abs(y3) <= FIXP16_MAX_INT && abs(z3) <= FIXP16_MAX_INT;
+}
 
 // this function draws a triangle that has a flat top
 void draw_tb_triangle_3d_z(int x1, int y1, int z1,
                         int x2, int y2, int z2,
                         int x3, int y3, int z3,
-                        int color, uint32_t* pixelmap, int *z_buffer) 
+                        int color, uint32_t* pixelmap, void *z_buffer) 
 {
     float dx_right,     // the dx/dy ratio of the right edge of line
           dx_left,      // the dx/dy ratio of the left edge of line
@@ -32,6 +150,11 @@ void draw_tb_triangle_3d_z(int x1, int y1, int z1,
     float z_middle,       // the z value of the middle between the left and right
         bx;             // the change of z with respect to x
 
+    int hiz = hiz_active(z_buffer),     // test spans against hierarchical z
+        painter = (z_buffer == NULL),   // no depth test, pixels are painted over
+        float_depth = depth_is_float(),
+        narrow = depth_is_16(),         // z-buffer holds 16 bit depths
+        key;                            // depth test key of current pixel
 
     // test order of x1 and x2, note y1 == y2
     // test if top or bottom is flat and set constant appropriately
@@ -116,6 +239,18 @@ void draw_tb_triangle_3d_z(int x1, int y1, int z1,
         y3 = poly_clip_max_y;
     }
 
+    // step over rows above the band (one add per row like the loops below,
+    // so the values match a whole screen pass) and clip to its last row
+    for(; y1 < band_first && y1 <= y3; y1++) {
+        xs += dx_left;
+        xe += dx_right;
+        z_left += b1y;
+        z_right += b2y;
+    }
+    if(y3 > band_last) {
+        y3 = band_last;
+    }
+
     // test if x clipping is needed
     if(x1 >= poly_clip_min_x && x1 <= poly_clip_max_x &&
        x2 >= poly_clip_min_x && x2 <= poly_clip_max_x &&
@@ -123,13 +258,31 @@ void draw_tb_triangle_3d_z(int x1, int y1, int z1,
     {
         // draw the triangle
         for(y_index = y1; y_index <= y3; y_index++) {
+            RASTER_STAT(scanlines);
             z_middle = z_left;
             bx = (z_right - z_left) / (1 + xe - xs);
-            for(x_index = (int) xs; x_index <= (int) xe; x_index++)
+            // step over columns left of the tile (one add per pixel like the
+            // loop below) and clip to its last column
+            xe_clip = ((int) xe > column_last) ? column_last : (int) xe;
+            for(x_index = (int) xs; x_index < column_first && x_index <= xe_clip; x_index++) {
+                z_middle += bx;
+            }
+            // skip span when it is behind the hierarchical z tiles
+            if(hiz && hiz_span_hidden(y_index, x_index, xe_clip, hiz_span_key(z_middle, bx, xe_clip - x_index + 1, float_depth))) {
+                RASTER_STAT(spans_hiz);
+                xe_clip = x_index - 1;
+            }
+            for(; x_index <= xe_clip; x_index++)
             {
-                if(z_middle < z_buffer[y_index * WINDOW_WIDTH + x_index]) {
+                RASTER_STAT(depth_tests);
+                key = depth_key(z_middle, float_depth);
+                if(painter || key < depth_read(z_buffer, y_index * WINDOW_WIDTH + x_index, narrow)) {
                     // update z buffer and write to image buffer
-                    z_buffer[y_index * WINDOW_WIDTH + x_index] = (int) z_middle;
+                    RASTER_STAT(depth_passes);
+                    RASTER_STAT_WRITE(y_index * WINDOW_WIDTH + x_index);
+                    if(!painter) {
+                        depth_write(z_buffer, y_index * WINDOW_WIDTH + x_index, key, narrow);
+                    }
                     display_draw_pixel(pixelmap, x_index, y_index, color);
                 } // end if update buffer
                 // update current z value
@@ -150,6 +303,7 @@ void draw_tb_triangle_3d_z(int x1, int y1, int z1,
         // draw the triangle
         for(y_index = y1; y_index <= y3; y_index++) 
         {
+            RASTER_STAT(scanlines);
             // do x clip
             xs_clip = (int) xs;
             xe_clip = (int) xe;
@@ -175,18 +329,35 @@ void draw_tb_triangle_3d_z(int x1, int y1, int z1,
                 z_middle += (bx * dx);
             } // end if line is clipp on left
 
-            if(xe_clip > poly_clip_max_x) {
-                xe_clip = poly_clip_max_x;
+            if(xe_clip > column_last) {
+                xe_clip = column_last;
             } // ned if line is clipped on right
 
+            // step over columns left of the tile
+            for(; xs_clip < column_first && xs_clip <= xe_clip; xs_clip++) {
+                z_middle += bx;
+            }
+
+            // skip span when it is behind the hierarchical z tiles
+            if(hiz && hiz_span_hidden(y_index, xs_clip, xe_clip, hiz_span_key(z_middle, bx, xe_clip - xs_clip + 1, float_depth))) {
+                RASTER_STAT(spans_hiz);
+                xe_clip = xs_clip - 1;
+            }
+
             // draw the line
             for(x_index = xs_clip; x_index <= xe_clip; x_index++)
             {
                 // if current z_middle is less than z-buffer then replace
                 // and update image buffer
-                if(z_middle < z_buffer[y_index * WINDOW_WIDTH + x_index]) {
+                RASTER_STAT(depth_tests);
+                key = depth_key(z_middle, float_depth);
+                if(painter || key < depth_read(z_buffer, y_index * WINDOW_WIDTH + x_index, narrow)) {
                     // update z buffer and write to image buffer
-                    z_buffer[y_index * WINDOW_WIDTH + x_index] = (int) z_middle;
+                    RASTER_STAT(depth_passes);
+                    RASTER_STAT_WRITE(y_index * WINDOW_WIDTH + x_index);
+                    if(!painter) {
+                        depth_write(z_buffer, y_index * WINDOW_WIDTH + x_index, key, narrow);
+                    }
                     display_draw_pixel(pixelmap, x_index, y_index, color);
                 } // end if update z buffer
                 // update current z value
@@ -198,12 +369,50 @@ void draw_tb_triangle_3d_z(int x1, int y1, int z1,
 }
 
 
+// Wipes tiles of an older epoch under the triangle with pixel vertices
+// x1,y1 - x3,y3 and returns 1 if it is behind everything in the tiles it
+// touches (spans may end a pixel beyond the vertices), painted triangles
+// without z-buffer only wipe. Every filler calls it before drawing.
+int triangle_tiles_hidden(int x1, int y1, int z1, int x2, int y2, int z2, int x3, int y3, int z3,
+                          uint32_t* pixelmap, void *z_buffer) {
+    if(!tiles_active(z_buffer) && !(z_buffer == NULL && tiles_active_painted(pixelmap))) {
+        return 0;
+    }
+    int min_x = MIN(x1, MIN(x2, x3)) - 1, min_y = MIN(y1, MIN(y2, y3)),
+        max_x = ((x1 > x2) ? ((x1 > x3) ? x1 : x3) : ((x2 > x3) ? x2 : x3)) + 1,
+        max_y = (y1 > y2) ? ((y1 > y3) ? y1 : y3) : ((y2 > y3) ? y2 : y3);
+    if(min_x < column_first) { min_x = column_first; }
+    if(max_x > column_last) { max_x = column_last; }
+    if(min_y < band_first) { min_y = band_first; }
+    if(max_y > band_last) { max_y = band_last; }
+    if(min_x <= max_x && min_y <= max_y) {
+        if(hiz.clear == CLEAR_EPOCH) {
+            tiles_wipe(min_x, min_y, max_x, max_y);
+        }
+        int float_depth = depth_is_float();
+        if(hiz.enabled && z_buffer != NULL && hiz_triangle_hidden(min_x, min_y, max_x, max_y,
+                                              MIN(depth_key(z1, float_depth),
+                                                  MIN(depth_key(z2, float_depth), depth_key(z3, float_depth))))) {
+            RASTER_STAT(rejected_hiz);
+            return 1;
+        }
+    }
+    return 0;
+}
+
 // Draws Triangles by determining float top or bottom triangle. 
 // Same as draw_triangle_2D() except that this function incorporates a Z-buffer.
+// With RASTER_FIXED stepping the split point is computed with integers and the
+// fixed point triangle functions are used, unless a coordinate is out of range.
+// With RASTER_HALFSPACE the triangle is handed to draw_triangle_halfspace
+// instead (same range rule), with RASTER_SUBPIXEL stepping of the scanline
+// rasterizer to draw_triangle_subpixel (vertices at pixel centers). z1, z2, z3
+// are depth values of the depth format in use (see depth.h), the z-buffer holds
+// their depth test keys. Without a z-buffer (NULL) every pixel is painted over.
 void draw_triangle_3D_z(int x1, int y1, int z1,
                         int x2, int y2, int z2,
                         int x3, int y3, int z3,
-                        int color[4], uint32_t* pixelmap, int *z_buffer, int mode) 
+                        int color[4], uint32_t* pixelmap, void *z_buffer, int mode) 
 {
     int temp_x,     // used for sorting
         temp_y,
@@ -221,6 +430,33 @@ void draw_triangle_3D_z(int x1, int y1, int z1,
 
     // test for h lines and v lines
     if((x1 == x2 && x2 == x3) || (y1 == y2 && y2 == y3)) {
+        RASTER_STAT(rejected_degenerate);
+        return;
+    }
+
+    if(stepping == RASTER_SUBPIXEL && algorithm == RASTER_SCANLINE) {
+        RasterTriangle t = {
+            .x     = { x1, x2, x3 },
+            .y     = { y1, y2, y3 },
+            .z     = { z1, z2, z3 },
+            .color = { color[0], color[1], color[2], color[3] },
+            .mode  = mode,
+            .sx    = { subpixel_from_pixel(x1), subpixel_from_pixel(x2), subpixel_from_pixel(x3) },
+            .sy    = { subpixel_from_pixel(y1), subpixel_from_pixel(y2), subpixel_from_pixel(y3) }
+        };
+        draw_triangle_subpixel(&t, pixelmap, z_buffer);
+        return;
+    }
+
+    if(triangle_tiles_hidden(x1, y1, z1, x2, y2, z2, x3, y3, z3, pixelmap, z_buffer)) {
+        return;
+    }
+
+    if(algorithm == RASTER_HALFSPACE &&
+       abs(x1) <= HALFSPACE_MAX_COORD && abs(y1) <= HALFSPACE_MAX_COORD &&
+       abs(x2) <= HALFSPACE_MAX_COORD && abs(y2) <= HALFSPACE_MAX_COORD &&
+       abs(x3) <= HALFSPACE_MAX_COORD && abs(y3) <= HALFSPACE_MAX_COORD) {
+        draw_triangle_halfspace(x1, y1, z1, x2, y2, z2, x3, y3, z3, color, pixelmap, z_buffer, mode);
         return;
     }
 
@@ -276,23 +512,37 @@ void draw_triangle_3D_z(int x1, int y1, int z1,
     if(y3 < poly_clip_min_y || y1 > poly_clip_max_y ||
        (x1 < poly_clip_min_x && x2 < poly_clip_min_x && x3 < poly_clip_min_x) ||
        (x1 > poly_clip_max_x && x2 > poly_clip_max_x && x3 > poly_clip_max_x)) {
+        RASTER_STAT(rejected_offscreen);
         return;
     }
 
+    // fixed point depths are truncated like integer keys, not like float bits
+    int fixed = (stepping == RASTER_FIXED) && !depth_is_float() &&
+                fits_fixed_point(x1, y1, z1, x2, y2, z2, x3, y3, z3);
+    void (*draw_flat)(int, int, int, int, int, int, int, int, int, int, uint32_t*, void*) =
+        fixed ? draw_tb_triangle_3d_z_fixed : draw_tb_triangle_3d_z;
+    void (*draw_gouraud)(int, int, int, int, int, int, int, int, int, int, int, int, uint32_t*, void*) =
+        fixed ? draw_tb_triangle_3d_gouraud_fixed : draw_tb_triangle_3d_gouraud;
+
     // test if top of triangle is flat
     if(y1 == y2 || y2 == y3) {
         if(mode == FLAT_SHADING) {
-            draw_tb_triangle_3d_z(x1,y1,z1,x2,y2,z2,x3,y3,z3,color[0],pixelmap, z_buffer);
+            draw_flat(x1,y1,z1,x2,y2,z2,x3,y3,z3,color[0],pixelmap, z_buffer);
         }
         if(mode == GOURAUD_SHADING) {
-            draw_tb_triangle_3d_gouraud(x1,y1,z1, i1 ,x2,y2,z2, i2, x3,y3,z3, i3, pixelmap, z_buffer);
+            draw_gouraud(x1,y1,z1, i1 ,x2,y2,z2, i2, x3,y3,z3, i3, pixelmap, z_buffer);
         }
     }
     else  {
         // general tirangle that needs to be borken up along long edge
         // compute new x,z at split point
-        new_x = x1 + (int)((float)(y2 - y1) * (float)(x3 - x1) / (float)(y3 - y1));
-        new_z = z1 + (int)((float)(y2 - y1) * (float)(z3 - z1) / (float)(y3 - y1));
+        if(fixed) {
+            new_x = x1 + (int)((int64_t)(y2 - y1) * (x3 - x1) / (y3 - y1));
+            new_z = z1 + (int)((int64_t)(y2 - y1) * (z3 - z1) / (y3 - y1));
+        } else {
+            new_x = x1 + (int)((float)(y2 - y1) * (float)(x3 - x1) / (float)(y3 - y1));
+            new_z = z1 + (int)((float)(y2 - y1) * (float)(z3 - z1) / (float)(y3 - y1));
+        }
 
         // determine intensity light of new position
         int new_i, new_i_b,
@@ -309,26 +559,32 @@ void draw_triangle_3D_z(int x1, int y1, int z1,
         i3_g = (i3 >> 8) & 0xFF;
         i3_r = (i3 & 0xFF);
         
-        new_i_b = i1_b + (int)((float)(y2 - y1) * (float)(i3_b - i1_b) / (float)(y3 - y1));
-        new_i_g = i1_g + (int)((float)(y2 - y1) * (float)(i3_g - i1_g) / (float)(y3 - y1));
-        new_i_r = i1_r + (int)((float)(y2 - y1) * (float)(i3_r - i1_r) / (float)(y3 - y1));
+        if(fixed) {
+            new_i_b = i1_b + (y2 - y1) * (i3_b - i1_b) / (y3 - y1);
+            new_i_g = i1_g + (y2 - y1) * (i3_g - i1_g) / (y3 - y1);
+            new_i_r = i1_r + (y2 - y1) * (i3_r - i1_r) / (y3 - y1);
+        } else {
+            new_i_b = i1_b + (int)((float)(y2 - y1) * (float)(i3_b - i1_b) / (float)(y3 - y1));
+            new_i_g = i1_g + (int)((float)(y2 - y1) * (float)(i3_g - i1_g) / (float)(y3 - y1));
+            new_i_r = i1_r + (int)((float)(y2 - y1) * (float)(i3_r - i1_r) / (float)(y3 - y1));
+        }
         new_i = _RGB32BIT(0, new_i_r, new_i_g, new_i_b);
 
         // draw each sub-triangle
         if(y3 >= poly_clip_min_y && y1 < poly_clip_max_y) {
             if(mode == FLAT_SHADING) {
-                draw_tb_triangle_3d_z(x2,y2,z2,new_x,y2,new_z,x3,y3,z3,color[0],pixelmap, z_buffer);
+                draw_flat(x2,y2,z2,new_x,y2,new_z,x3,y3,z3,color[0],pixelmap, z_buffer);
             }
             if(mode == GOURAUD_SHADING) {
-                draw_tb_triangle_3d_gouraud(x2,y2,z2,i2, new_x,y2,new_z, new_i, x3,y3,z3, i3 ,pixelmap, z_buffer); // upper triangle 
+                draw_gouraud(x2,y2,z2,i2, new_x,y2,new_z, new_i, x3,y3,z3, i3 ,pixelmap, z_buffer); // upper triangle 
             }
         }
         if(y2 >= poly_clip_min_y && y1 < poly_clip_max_y) {
             if(mode == FLAT_SHADING) {
-                draw_tb_triangle_3d_z(x1,y1,z1,new_x,y2,new_z,x2,y2,z2,color[0],pixelmap, z_buffer);
+                draw_flat(x1,y1,z1,new_x,y2,new_z,x2,y2,z2,color[0],pixelmap, z_buffer);
             }
             if(mode == GOURAUD_SHADING) {
-                draw_tb_triangle_3d_gouraud(x1,y1,z1, i1, new_x,y2,new_z,new_i ,x2,y2,z2, i2, pixelmap, z_buffer); // lower triangle
+                draw_gouraud(x1,y1,z1, i1, new_x,y2,new_z,new_i ,x2,y2,z2, i2, pixelmap, z_buffer); // lower triangle
             }
         }
     }
@@ -341,7 +597,7 @@ void draw_triangle_3D_z(int x1, int y1, int z1,
 void draw_tb_triangle_3d_gouraud(int x1, int y1, int z1, int i1,
                         int x2, int y2, int z2, int i2,
                         int x3, int y3, int z3, int i3, 
-                        uint32_t* pixelmap, int *z_buffer) 
+                        uint32_t* pixelmap, void *z_buffer) 
 {
     // this function draws a triangle that has a flat top
     float dx_right,     // the dx/dy ratio of the right edge of line
@@ -390,6 +646,12 @@ void draw_tb_triangle_3d_gouraud(int x1, int y1, int z1, int i1,
         i_g_x,
         i_r_x;             
 
+    int hiz = hiz_active(z_buffer),     // test spans against hierarchical z
+        painter = (z_buffer == NULL),   // no depth test, pixels are painted over
+        float_depth = depth_is_float(),
+        narrow = depth_is_16(),         // z-buffer holds 16 bit depths
+        key;                            // depth test key of current pixel
+
     // test order of x1 and x2, note y1 == y2
     int i1_b, i1_g, i1_r,
         i2_b, i2_g, i2_r,
@@ -541,6 +803,24 @@ void draw_tb_triangle_3d_gouraud(int x1, int y1, int z1, int i1,
         y3 = poly_clip_max_y;
     }
 
+    // step over rows above the band (one add per row like the loops below,
+    // so the values match a whole screen pass) and clip to its last row
+    for(; y1 < band_first && y1 <= y3; y1++) {
+        xs += dx_left;
+        xe += dx_right;
+        z_left += b1y;
+        z_right += b2y;
+        i_b_left  += b1y_i_b;
+        i_b_right += b2y_i_b;
+        i_g_left  += b1y_i_g;
+        i_g_right += b2y_i_g;
+        i_r_left  += b1y_i_r;
+        i_r_right += b2y_i_r;
+    }
+    if(y3 > band_last) {
+        y3 = band_last;
+    }
+
     // test if x clipping is needed
     if(x1 >= poly_clip_min_x && x1 <= poly_clip_max_x &&
        x2 >= poly_clip_min_x && x2 <= poly_clip_max_x &&
@@ -549,6 +829,7 @@ void draw_tb_triangle_3d_gouraud(int x1, int y1, int z1, int i1,
         // draw the triangle
         for(y_index = y1; y_index <= y3; y_index++)
         {
+            RASTER_STAT(scanlines);
             // z_middle set to float
             z_middle = z_left;
             bx = (z_right - z_left) / (1 + xe - xs);
@@ -560,11 +841,31 @@ void draw_tb_triangle_3d_gouraud(int x1, int y1, int z1, int i1,
             i_r_middle = i_r_left;
             i_r_x = (i_r_right - i_r_left) / (1 + xe - xs);
 
-            for(x_index = (int) xs; x_index <= (int) xe; x_index++)
+            // step over columns left of the tile (one add per pixel like the
+            // loop below) and clip to its last column
+            xe_clip = ((int) xe > column_last) ? column_last : (int) xe;
+            for(x_index = (int) xs; x_index < column_first && x_index <= xe_clip; x_index++) {
+                z_middle += bx;
+                i_b_middle += i_b_x;
+                i_g_middle += i_g_x;
+                i_r_middle += i_r_x;
+            }
+            // skip span when it is behind the hierarchical z tiles
+            if(hiz && hiz_span_hidden(y_index, x_index, xe_clip, hiz_span_key(z_middle, bx, xe_clip - x_index + 1, float_depth))) {
+                RASTER_STAT(spans_hiz);
+                xe_clip = x_index - 1;
+            }
+            for(; x_index <= xe_clip; x_index++)
             {
-                if(z_middle < z_buffer[y_index * WINDOW_WIDTH + x_index]) {
+                RASTER_STAT(depth_tests);
+                key = depth_key(z_middle, float_depth);
+                if(painter || key < depth_read(z_buffer, y_index * WINDOW_WIDTH + x_index, narrow)) {
                     // update z buffer and write to image buffer
-                    z_buffer[y_index * WINDOW_WIDTH + x_index] = (int)(z_middle);
+                    RASTER_STAT(depth_passes);
+                    RASTER_STAT_WRITE(y_index * WINDOW_WIDTH + x_index);
+                    if(!painter) {
+                        depth_write(z_buffer, y_index * WINDOW_WIDTH + x_index, key, narrow);
+                    }
                     int rgb = _RGB32BIT(0, (int)(i_r_middle),(int)(i_g_middle), (int)(i_b_middle));
                     display_draw_pixel(pixelmap, x_index, y_index, rgb);
                 } // end if update buffer
@@ -595,6 +896,7 @@ void draw_tb_triangle_3d_gouraud(int x1, int y1, int z1, int i1,
         // draw the triangle
         for(y_index = y1; y_index <= y3; y_index++)
         {
+            RASTER_STAT(scanlines);
             // do x clip
             xs_clip = (int)(xs + 0.5);
             xe_clip = (int)(xe + 0.5);
@@ -635,18 +937,38 @@ void draw_tb_triangle_3d_gouraud(int x1, int y1, int z1, int i1,
                 i_r_middle += (i_r_x * dx);
             } // end if line is clipp on left
 
-            if(xe_clip > poly_clip_max_x) {
-                xe_clip = poly_clip_max_x;
+            if(xe_clip > column_last) {
+                xe_clip = column_last;
             } // ned if line is clipped on right
 
+            // step over columns left of the tile
+            for(; xs_clip < column_first && xs_clip <= xe_clip; xs_clip++) {
+                z_middle += bx;
+                i_b_middle += i_b_x;
+                i_g_middle += i_g_x;
+                i_r_middle += i_r_x;
+            }
+
+            // skip span when it is behind the hierarchical z tiles
+            if(hiz && hiz_span_hidden(y_index, xs_clip, xe_clip, hiz_span_key(z_middle, bx, xe_clip - xs_clip + 1, float_depth))) {
+                RASTER_STAT(spans_hiz);
+                xe_clip = xs_clip - 1;
+            }
+
             // draw the line
             for(x_index = xs_clip; x_index <= xe_clip; x_index++)
             {
                 // if current z_middle is less than z-buffer then replace
                 // and update image buffer
-                if(z_middle < z_buffer[y_index * WINDOW_WIDTH + x_index]) {
+                RASTER_STAT(depth_tests);
+                key = depth_key(z_middle, float_depth);
+                if(painter || key < depth_read(z_buffer, y_index * WINDOW_WIDTH + x_index, narrow)) {
                     // update z buffer and write to image buffer
-                    z_buffer[y_index * WINDOW_WIDTH + x_index] = (int)(z_middle);
+                    RASTER_STAT(depth_passes);
+                    RASTER_STAT_WRITE(y_index * WINDOW_WIDTH + x_index);
+                    if(!painter) {
+                        depth_write(z_buffer, y_index * WINDOW_WIDTH + x_index, key, narrow);
+                    }
                     int rgb = _RGB32BIT(0, (int)(i_r_middle), (int)(i_g_middle), (int)(i_b_middle));
                     display_draw_pixel(pixelmap, x_index, y_index, rgb);
                 } // end if update z buffer
@@ -659,4 +981,314 @@ void draw_tb_triangle_3d_gouraud(int x1, int y1, int z1, int i1,
             } // end draw z buffered line
         } // end for y_index
     } // ned else x clipping needed
-}
\ No newline at end of file
+}
+
+// Smallest 1/z a span divides by, stepped edges may end a pixel outside of
+// the triangle where 1/z of a steep triangle is already 0 or below.
+#define TEXTURE_MIN_W 1e-6f
+
+// Screen space planes of a textured triangle, value(x,y) = base + dx * (x - x0) + dy * (y - y0)
+// with x0,y0 the first vertex (keeps the large depth values of the formats precise).
+typedef struct {
+    float x0, y0;
+    float z[3];                 // base, dx and dy of the depth value
+    float s[3], t[3], w[3];     // of u/z, v/z (in texels of the level) and 1/z
+    const TextureLevel* level;  // mip level of the triangle
+    int   step;                 // pixels between perspective divides
+    int   light[3];             // red, green and blue factor of the texels, 256 leaves them as they are
+    int   lit;                  // 1 if a factor is below 256
+}TextureSpans;
+
+// Texel coordinate as 16.16 fixed point. It wraps modulo 2^16 texels, a
+// multiple of every texture size, so the texture still repeats correctly.
+static inline uint32_t texel_fixed(float texel) {
+    texel = (texel > 1e9f) ? 1e9f : ((texel < -1e9f) ? -1e9f : texel);
+    return (uint32_t) (int64_t) (texel * 65536.0f);
+}
+
+// Sets up planes, mip level and light of textured triangle t with its vertices
+// at x, y (pixel x,y samples the planes at x,y). The level is the one whose
+// texels come closest to one per pixel over the whole triangle.
+static void texture_spans_setup(TextureSpans* p, const RasterTriangle* t, const double x[3], const double y[3]) {
+    const Texture* texture = t->texture;
+    double area = ((x[1] - x[0]) * (y[2] - y[0])) - ((x[2] - x[0]) * (y[1] - y[0]));
+    double texels = fabs(((double) (t->u[1] - t->u[0]) * (t->v[2] - t->v[0])) - ((double) (t->u[2] - t->u[0]) * (t->v[1] - t->v[0]))) *
+                    texture->level[0].width * texture->level[0].height;
+    int level = 0;
+
+    // every level has a quarter of the texels, stop once less than 2 per pixel are left
+    while(level + 1 < texture->levels && texels > 2 * fabs(area)) {
+        texels *= 0.25;
+        level++;
+    }
+    p->level = &texture->level[level];
+
+    // no planes through a degenerate triangle, it is drawn with the values of its first vertex
+    double inverse_area = (area != 0) ? 1.0 / area : 0;
+    double width = p->level->width, height = p->level->height;
+    p->x0 = (float) x[0];
+    p->y0 = (float) y[0];
+    raster_plane(p->z, x, y, t->z[0], t->z[1], t->z[2], inverse_area);
+    raster_plane(p->s, x, y, t->u[0] * width * t->w[0], t->u[1] * width * t->w[1], t->u[2] * width * t->w[2], inverse_area);
+    raster_plane(p->t, x, y, t->v[0] * height * t->w[0], t->v[1] * height * t->w[1], t->v[2] * height * t->w[2], inverse_area);
+    raster_plane(p->w, x, y, t->w[0], t->w[1], t->w[2], inverse_area);
+
+    p->step = (texturing == TEXTURE_16) ? 16 : (texturing == TEXTURE_8) ? 8 : (texturing == TEXTURE_EXACT) ? 1 : WINDOW_WIDTH;
+
+    // flat triangles are lit by their color, gouraud ones by the average of their colors
+    p->lit = 0;
+    for(int c = 0; c < 3; c++) {
+        int shift = 8 * c, channel = (t->color[0] >> shift) & 0xFF;
+        if(t->mode == GOURAUD_SHADING) {
+            channel = (channel + ((t->color[1] >> shift) & 0xFF) + ((t->color[2] >> shift) & 0xFF) + 1) / 3;
+        }
+        p->light[c] = channel + (channel >> 7);
+        p->lit |= (p->light[c] < 256);
+    }
+}
+
+// Draws pixels x_start..x_end of row y of a textured triangle. The texture
+// coordinates are divided exactly at the start of the span and after every
+// p->step pixels, and stepped linearly in between. Pixels outside the columns
+// of the calling thread are not drawn, the ones left of them are stepped.
+static void draw_textured_span(const TextureSpans* p, int y, int x_start, int x_end, uint32_t* pixelmap, void *z_buffer) {
+    int painter = (z_buffer == NULL),
+        float_depth = depth_is_float(),
+        narrow = depth_is_16(),
+        draw_first = (x_start < column_first) ? column_first : x_start,
+        draw_last  = (x_end > column_last) ? column_last : x_end;
+    if(draw_first > draw_last) {
+        return;
+    }
+    float dx = (float) (x_start - p->x0), dy = (float) (y - p->y0);
+    float z = p->z[0] + (p->z[1] * dx) + (p->z[2] * dy),
+          s = p->s[0] + (p->s[1] * dx) + (p->s[2] * dy),
+          t = p->t[0] + (p->t[1] * dx) + (p->t[2] * dy),
+          w = p->w[0] + (p->w[1] * dx) + (p->w[2] * dy);
+
+    // skip span when it is behind the hierarchical z tiles
+    if(hiz_active(z_buffer) && hiz_span_hidden(y, draw_first, draw_last, hiz_span_key(z, p->z[1], x_end - x_start + 1, float_depth))) {
+        RASTER_STAT(spans_hiz);
+        return;
+    }
+
+    const uint32_t* texels = p->level->texels;
+    uint32_t u_mask = p->level->width - 1, v_mask = p->level->height - 1;
+    int width_shift = p->level->width_shift;
+    uint32_t* pixels = &pixelmap[y * WINDOW_WIDTH];
+    int row = y * WINDOW_WIDTH;
+    float inverse_w = 1.0f / ((w > TEXTURE_MIN_W) ? w : TEXTURE_MIN_W);
+    uint32_t u = texel_fixed(s * inverse_w), v = texel_fixed(t * inverse_w);
+
+    for(int x = x_start; x <= draw_last; ) {
+        int pixels_left = x_end - x + 1,
+            run = (pixels_left < p->step) ? pixels_left : p->step;
+
+        // exact coordinates at the end of the run, affine steps towards them
+        s += p->s[1] * run;
+        t += p->t[1] * run;
+        w += p->w[1] * run;
+        inverse_w = 1.0f / ((w > TEXTURE_MIN_W) ? w : TEXTURE_MIN_W);
+        uint32_t u_end = texel_fixed(s * inverse_w), v_end = texel_fixed(t * inverse_w);
+        int32_t du = (int32_t) (u_end - u) / run, dv = (int32_t) (v_end - v) / run;
+
+        // runs keep their length, so pixels left of the tile are stepped and
+        // the end of the span is not moved
+        int end = x + run;
+        for(; x < end && x < draw_first; x++) {
+            z += p->z[1];
+            u += (uint32_t) du;
+            v += (uint32_t) dv;
+        }
+        for(end = (end > draw_last) ? draw_last + 1 : end; x < end; x++) {
+            RASTER_STAT(depth_tests);
+            int key = depth_key(z, float_depth);
+            if(painter || key < depth_read(z_buffer, row + x, narrow)) {
+                RASTER_STAT(depth_passes);
+                RASTER_STAT_WRITE(row + x);
+                if(!painter) {
+                    depth_write(z_buffer, row + x, key, narrow);
+                }
+                uint32_t tu = (u >> 16) & u_mask, tv = (v >> 16) & v_mask;
+                uint32_t texel = texels[((tv & ~(TEXTURE_TILE - 1)) << width_shift) + ((tu & ~(TEXTURE_TILE - 1)) * TEXTURE_TILE) +
+                                        ((tv & (TEXTURE_TILE - 1)) * TEXTURE_TILE) + (tu & (TEXTURE_TILE - 1))];
+                if(p->lit) {
+                    texel = _RGB32BIT(0, ((texel & 0xFF) * p->light[0]) >> 8, (((texel >> 8) & 0xFF) * p->light[1]) >> 8,
+                                         (((texel >> 16) & 0xFF) * p->light[2]) >> 8);
+                }
+                pixels[x] = texel;
+            }
+            z += p->z[1];
+            u += (uint32_t) du;
+            v += (uint32_t) dv;
+        }
+        u = u_end;
+        v = v_end;
+    }
+}
+
+// draw_textured_span as SubpixelSpan, data is the TextureSpans of the triangle.
+static void textured_span(const void* data, int y, int x_start, int x_end, uint32_t* pixelmap, void *z_buffer) {
+    draw_textured_span(data, y, x_start, x_end, pixelmap, z_buffer);
+}
+
+// Draws flat top or flat bottom part of a textured triangle, its edges are
+// stepped exactly like draw_tb_triangle_3d_z steps them.
+static void draw_tb_triangle_textured(int x1, int y1, int x2, int y2, int x3, int y3,
+                                      const TextureSpans* p, uint32_t* pixelmap, void *z_buffer) {
+    float dx_left, dx_right,    // the dx/dy ratio of the left and right edge
+          xs, xe,               // the starting and ending points of the edges
+          height;
+    int temp_x;
+
+    if(y1 == y2) {
+        // flat top
+        if(x2 < x1) {
+            temp_x = x2;
+            x2 = x1;
+            x1 = temp_x;
+        }
+        height = y3 - y1;
+        dx_left = (x3 - x1) / height;
+        dx_right = (x3 - x2) / height;
+        xs = (float) x1;
+        xe = (float) x2;
+    }
+    else {
+        // flat bottom
+        if(x3 < x2) {
+            temp_x = x2;
+            x2 = x3;
+            x3 = temp_x;
+        }
+        height = y3 - y1;
+        dx_left = (x2 - x1) / height;
+        dx_right = (x3 - x1) / height;
+        xs = (float) x1;
+        xe = (float) x1;
+    }
+
+    // clip top and bottom
+    if(y1 < poly_clip_min_y) {
+        float dy = (float) (-y1 + poly_clip_min_y);
+        xs = xs + dx_left * dy;
+        xe = xe + dx_right * dy;
+        y1 = poly_clip_min_y;
+    }
+    if(y3 > poly_clip_max_y) {
+        y3 = poly_clip_max_y;
+    }
+
+    // step over rows above the band and clip to its last row
+    for(; y1 < band_first && y1 <= y3; y1++) {
+        xs += dx_left;
+        xe += dx_right;
+    }
+    if(y3 > band_last) {
+        y3 = band_last;
+    }
+
+    for(int y_index = y1; y_index <= y3; y_index++) {
+        RASTER_STAT(scanlines);
+        int xs_clip = (int) xs,
+            xe_clip = (int) xe;
+        if(xs_clip < poly_clip_min_x) {
+            xs_clip = poly_clip_min_x;
+        }
+        if(xe_clip > poly_clip_max_x) {
+            xe_clip = poly_clip_max_x;
+        }
+        if(xs_clip <= xe_clip) {
+            draw_textured_span(p, y_index, xs_clip, xe_clip, pixelmap, z_buffer);
+        }
+        xs += dx_left;
+        xe += dx_right;
+    }
+}
+
+// Draws textured triangle t (see RasterTriangle) with the scanline edges of
+// draw_triangle_3D_z, so it covers the same pixels as an untextured one. Every
+// span divides u/z and v/z by 1/z at its start and then every 8 or 16 pixels
+// (TEXTURE_8, TEXTURE_16) and steps the texture coordinates linearly in
+// between. The mip level is picked once per triangle from its texels per
+// pixel and every texel is lit by the color of the triangle (its average for
+// GOURAUD_SHADING). Depth test, hierarchical z, epoch tiles and bands work as
+// in draw_triangle_3D_z. The rasterizer setting is not used, with
+// RASTER_SUBPIXEL stepping the spans are the ones of draw_triangle_subpixel
+// (sx, sy of t).
+void draw_triangle_textured(const RasterTriangle* t, uint32_t* pixelmap, void *z_buffer) {
+    int x1 = t->x[0], y1 = t->y[0],
+        x2 = t->x[1], y2 = t->y[1],
+        x3 = t->x[2], y3 = t->y[2],
+        temp;
+    TextureSpans spans;
+    double x[3], y[3];
+
+    if(stepping == RASTER_SUBPIXEL) {
+        SubpixelTriangle s;
+        if(!subpixel_triangle_setup(&s, t->sx, t->sy) ||
+           triangle_tiles_hidden(t->sx[0] >> SUBPIXEL_BITS, t->sy[0] >> SUBPIXEL_BITS, t->z[0],
+                                 t->sx[1] >> SUBPIXEL_BITS, t->sy[1] >> SUBPIXEL_BITS, t->z[1],
+                                 t->sx[2] >> SUBPIXEL_BITS, t->sy[2] >> SUBPIXEL_BITS, t->z[2], pixelmap, z_buffer)) {
+            return;
+        }
+        // vertices moved half a pixel, so pixel x,y samples the planes at its center
+        for(int i = 0; i < 3; i++) {
+            x[i] = ((double) t->sx[i] / SUBPIXEL_ONE) - 0.5;
+            y[i] = ((double) t->sy[i] / SUBPIXEL_ONE) - 0.5;
+        }
+        texture_spans_setup(&spans, t, x, y);
+        subpixel_triangle_spans(&s, textured_span, &spans, pixelmap, z_buffer);
+        return;
+    }
+
+    // test for h lines and v lines
+    if((x1 == x2 && x2 == x3) || (y1 == y2 && y2 == y3)) {
+        RASTER_STAT(rejected_degenerate);
+        return;
+    }
+    if(triangle_tiles_hidden(x1, y1, t->z[0], x2, y2, t->z[1], x3, y3, t->z[2], pixelmap, z_buffer)) {
+        return;
+    }
+
+    // sort p1, p2, p3 in ascending y order
+    if(y2 < y1) {
+        temp = x2; x2 = x1; x1 = temp;
+        temp = y2; y2 = y1; y1 = temp;
+    }
+    if(y3 < y1) {
+        temp = x3; x3 = x1; x1 = temp;
+        temp = y3; y3 = y1; y1 = temp;
+    }
+    if(y3 < y2) {
+        temp = x3; x3 = x2; x2 = temp;
+        temp = y3; y3 = y2; y2 = temp;
+    }
+
+    // do trivial rejection tests
+    if(y3 < poly_clip_min_y || y1 > poly_clip_max_y ||
+       (x1 < poly_clip_min_x && x2 < poly_clip_min_x && x3 < poly_clip_min_x) ||
+       (x1 > poly_clip_max_x && x2 > poly_clip_max_x && x3 > poly_clip_max_x)) {
+        RASTER_STAT(rejected_offscreen);
+        return;
+    }
+
+    for(int i = 0; i < 3; i++) {
+        x[i] = t->x[i];
+        y[i] = t->y[i];
+    }
+    texture_spans_setup(&spans, t, x, y);
+
+    if(y1 == y2 || y2 == y3) {
+        draw_tb_triangle_textured(x1, y1, x2, y2, x3, y3, &spans, pixelmap, z_buffer);
+        return;
+    }
+    // split along the long edge at the same x as draw_triangle_3D_z
+    int new_x = x1 + (int)((float)(y2 - y1) * (float)(x3 - x1) / (float)(y3 - y1));
+    if(y3 >= poly_clip_min_y && y1 < poly_clip_max_y) {
+        draw_tb_triangle_textured(x2, y2, new_x, y2, x3, y3, &spans, pixelmap, z_buffer);
+    }
+    if(y2 >= poly_clip_min_y && y1 < poly_clip_max_y) {
+        draw_tb_triangle_textured(x1, y1, new_x, y2, x2, y2, &spans, pixelmap, z_buffer);
+    }
+}
@@ -0,0 +1,310 @@
+#include "hiz.h"
+#include "polygon.h"
+#include <limits.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CLEAR_SSE 1
+#include <emmintrin.h>
+#endif
+
+// a raster tile of a thread must own whole hierarchical z tiles
+#if TILE_SIZE % HIZ_TILE != 0
+#error "TILE_SIZE must be a multiple of HIZ_TILE"
+#endif
+
+// tile rows are wiped 4 pixels at a time
+#if HIZ_TILE % 4 != 0
+#error "HIZ_TILE must be a multiple of 4"
+#endif
+
+HierarchicalZ hiz = { .clear = CLEAR_EPOCH };
+
+#ifndef HIZ_REFRESH_AREA
+#define HIZ_REFRESH_AREA (HIZ_TILE * HIZ_TILE)
+#endif
+
+// Turns hierarchical z rejection on or off (off by default).
+void raster_set_hiz(int enabled) {
+    hiz.enabled = (enabled != 0);
+}
+
+// Returns 1 if hierarchical z rejection is on.
+int raster_hiz(void) {
+    return hiz.enabled;
+}
+
+// Selects full or epoch clears (epoch by default).
+void raster_set_clear(int mode) {
+    hiz.clear = (mode == CLEAR_FULL) ? CLEAR_FULL : CLEAR_EPOCH;
+    // next clear is a full one, tiles of the old mode are not trusted
+    hiz.z_buffer = NULL;
+}
+
+// Returns clear in use.
+int raster_clear(void) {
+    return hiz.clear;
+}
+
+// Returns name of clear ("full" or "epoch").
+const char* raster_clear_name(int mode) {
+    return (mode == CLEAR_FULL) ? "full" : "epoch";
+}
+
+// Buffers at least this large (pixelmap and z-buffer together) are cleared with
+// non-temporal stores, smaller ones still fit in cache and are read back by the
+// rasterizer straight away.
+#ifndef CLEAR_STREAM_BYTES
+#define CLEAR_STREAM_BYTES (2 << 20)
+#endif
+
+// Writes black into every pixel and INT_MAX (DEPTH_16_FAR for 16 bit depths)
+// into every depth.
+static void clear_full(uint32_t* pixelmap, void* z_buffer, int narrow) {
+    int* depth = z_buffer;
+    uint16_t* depth16 = z_buffer;
+    int i = 0;
+#ifdef CLEAR_SSE
+    if((((uintptr_t) pixelmap | (uintptr_t) z_buffer) & 15) == 0) {
+        const __m128i black = _mm_setzero_si128(),
+                      far   = narrow ? _mm_set1_epi16((short) DEPTH_16_FAR) : _mm_set1_epi32(INT_MAX);
+        if(ALL_PIXELS * (sizeof(uint32_t) + (narrow ? sizeof(uint16_t) : sizeof(int))) >= CLEAR_STREAM_BYTES) {
+            for(; i + 8 <= ALL_PIXELS; i += 8) {
+                _mm_stream_si128((__m128i*) &pixelmap[i],     black);
+                _mm_stream_si128((__m128i*) &pixelmap[i + 4], black);
+                if(narrow) {
+                    _mm_stream_si128((__m128i*) &depth16[i], far);
+                } else {
+                    _mm_stream_si128((__m128i*) &depth[i],     far);
+                    _mm_stream_si128((__m128i*) &depth[i + 4], far);
+                }
+            }
+            _mm_sfence();
+        } else {
+            for(; i + 8 <= ALL_PIXELS; i += 8) {
+                _mm_store_si128((__m128i*) &pixelmap[i],     black);
+                _mm_store_si128((__m128i*) &pixelmap[i + 4], black);
+                if(narrow) {
+                    _mm_store_si128((__m128i*) &depth16[i], far);
+                } else {
+                    _mm_store_si128((__m128i*) &depth[i],     far);
+                    _mm_store_si128((__m128i*) &depth[i + 4], far);
+                }
+            }
+        }
+    }
+#endif
+    for(; i < ALL_PIXELS; i++) {
+        pixelmap[i] = 0;
+        if(narrow) {
+            depth16[i] = DEPTH_16_FAR;
+        } else {
+            depth[i] = INT_MAX;
+        }
+    }
+}
+
+// All tiles of a row.
+#define ROW_TILES ((HIZ_TILES_X == 64) ? ~(uint64_t) 0 : (((uint64_t) 1 << HIZ_TILES_X) - 1))
+
+// Wipes pixels (unless already black) and depths of tile, the caller marks it
+// as wiped.
+static void tile_clear(int tile_x, int tile_y) {
+    int offset = (tile_y * HIZ_TILE * WINDOW_WIDTH) + (tile_x * HIZ_TILE);
+    int* depth = hiz.z_buffer;
+    uint16_t* depth16 = hiz.z_buffer;
+    int blank = (atomic_load_explicit(&hiz.blank[tile_y], memory_order_relaxed) >> tile_x) & 1;
+
+    for(int y = 0; y < HIZ_TILE; y++) {
+        int row = offset + (y * WINDOW_WIDTH);
+#ifdef CLEAR_SSE
+        const __m128i black = _mm_setzero_si128(),
+                      far   = hiz.narrow ? _mm_set1_epi16((short) DEPTH_16_FAR) : _mm_set1_epi32(INT_MAX);
+        for(int x = row; x < row + HIZ_TILE; x += 4) {
+            if(hiz.narrow) {
+                _mm_storel_epi64((__m128i*) &depth16[x], far);
+            } else {
+                _mm_storeu_si128((__m128i*) &depth[x], far);
+            }
+            if(!blank) {
+                _mm_storeu_si128((__m128i*) &hiz.pixelmap[x], black);
+            }
+        }
+#else
+        for(int x = row; x < row + HIZ_TILE; x++) {
+            if(hiz.narrow) {
+                depth16[x] = DEPTH_16_FAR;
+            } else {
+                depth[x] = INT_MAX;
+            }
+            if(!blank) {
+                hiz.pixelmap[x] = 0;
+            }
+        }
+#endif
+    }
+    hiz.max_z[tile_y][tile_x] = INT_MAX;
+    hiz.dirty[tile_y][tile_x] = 0;
+    atomic_fetch_and_explicit(&hiz.blank[tile_y], ~((uint64_t) 1 << tile_x), memory_order_relaxed);     // about to be drawn
+}
+
+// Clears pixelmap to black and z_buffer to the largest depth (INT_MAX, or
+// DEPTH_16_FAR for 16 bit depths) and binds the tiles to them. With CLEAR_EPOCH
+// this only starts a new epoch, so until buffers_resolve the buffers must only be drawn with draw_triangle_3D_z.
+// Buffers cleared any other way are not tested against the tiles.
+void buffers_clear(uint32_t* pixelmap, void* z_buffer) {
+    int narrow = depth_is_16();
+    hiz.epoch++;
+    if(hiz.clear == CLEAR_EPOCH && hiz.z_buffer == z_buffer && hiz.pixelmap == pixelmap &&
+       hiz.narrow == narrow && hiz.epoch != 0) {
+        return;
+    }
+    // new buffers, full clears, depth width changed or epoch wrapped around:
+    // every tile is valid
+    clear_full(pixelmap, z_buffer, narrow);
+    if(hiz.epoch == 0) {
+        hiz.epoch = 1;
+    }
+    for(int tile_y = 0; tile_y < HIZ_TILES_Y; tile_y++) {
+        for(int tile_x = 0; tile_x < HIZ_TILES_X; tile_x++) {
+            hiz.max_z[tile_y][tile_x] = INT_MAX;
+        }
+        hiz.row_epoch[tile_y] = hiz.epoch;
+        hiz.wiped[tile_y]     = ROW_TILES;
+        // triangles of this frame skip tile_clear (the tiles are wiped), so
+        // no tile is known to stay black
+        hiz.blank[tile_y]     = 0;
+    }
+    memset(hiz.dirty, 0, sizeof(hiz.dirty));
+    hiz.z_buffer = z_buffer;
+    hiz.pixelmap = pixelmap;
+    hiz.narrow   = narrow;
+}
+
+// Blanks pixels of the tiles no triangle touched since buffers_clear, after
+// this the pixelmap can be shown. Depths of those tiles stay stale.
+void buffers_resolve(void) {
+    if(hiz.clear != CLEAR_EPOCH || hiz.pixelmap == NULL) {
+        return;
+    }
+    for(int tile_y = 0; tile_y < HIZ_TILES_Y; tile_y++) {
+        uint64_t stale = ROW_TILES & ~tiles_wiped(tile_y) & ~hiz.blank[tile_y];
+        hiz.blank[tile_y] |= stale;
+        for(int tile_x = 0; stale != 0; tile_x++, stale >>= 1) {
+            if((stale & 1) == 0) {
+                continue;
+            }
+            uint32_t* pixel = &hiz.pixelmap[(tile_y * HIZ_TILE * WINDOW_WIDTH) + (tile_x * HIZ_TILE)];
+            for(int y = 0; y < HIZ_TILE; y++) {
+                memset(pixel, 0, sizeof(uint32_t) * HIZ_TILE);
+                pixel += WINDOW_WIDTH;
+            }
+        }
+    }
+}
+
+// Wipes the given tiles of row tile_y that are not yet wiped in the current epoch.
+void tiles_wipe_row(int tile_y, uint64_t tiles) {
+    uint64_t stale = tiles & ~tiles_wiped(tile_y);
+    if(hiz.row_epoch[tile_y] != hiz.epoch) {
+        hiz.wiped[tile_y]     = 0;
+        hiz.row_epoch[tile_y] = hiz.epoch;
+    }
+    atomic_fetch_or_explicit(&hiz.wiped[tile_y], tiles, memory_order_relaxed);
+    for(int tile_x = 0; stale != 0; tile_x++, stale >>= 1) {
+        if(stale & 1) {
+            tile_clear(tile_x, tile_y);
+        }
+    }
+}
+
+// Moves every row of an older epoch to the current one with no tile wiped, so
+// threads drawing different tiles of a row only ever add bits to its wiped mask
+// (draw_poly_list_tiled calls it before handing out a frame).
+void tiles_share_rows(void) {
+    for(int tile_y = 0; tile_y < HIZ_TILES_Y; tile_y++) {
+        if(hiz.row_epoch[tile_y] != hiz.epoch) {
+            hiz.wiped[tile_y]     = 0;
+            hiz.row_epoch[tile_y] = hiz.epoch;
+        }
+    }
+}
+
+// Marks every tile as wiped and not blank in the current epoch without touching
+// pixels or depths, for renderers that wrote every pixel of the bound pixelmap
+// themselves (the depths stay stale until a later epoch wipes the tiles).
+void tiles_cover(void) {
+    for(int tile_y = 0; tile_y < HIZ_TILES_Y; tile_y++) {
+        hiz.row_epoch[tile_y] = hiz.epoch;
+        hiz.wiped[tile_y]     = ROW_TILES;
+        hiz.blank[tile_y]     = 0;
+    }
+}
+
+// Recomputes largest depth of tile from the z-buffer.
+static void hiz_refresh(int tile_x, int tile_y) {
+    int offset = (tile_y * HIZ_TILE * WINDOW_WIDTH) + (tile_x * HIZ_TILE);
+    int max_z;
+    if(hiz.narrow) {
+        const uint16_t* pixel = &((const uint16_t*) hiz.z_buffer)[offset];
+        max_z = pixel[0];
+        for(int y = 0; y < HIZ_TILE; y++) {
+            for(int x = 0; x < HIZ_TILE; x++) {
+                max_z = (pixel[x] > max_z) ? pixel[x] : max_z;
+            }
+            pixel += WINDOW_WIDTH;
+        }
+    } else {
+        const int* pixel = &((const int*) hiz.z_buffer)[offset];
+        max_z = pixel[0];
+        for(int y = 0; y < HIZ_TILE; y++) {
+            for(int x = 0; x < HIZ_TILE; x++) {
+                max_z = (pixel[x] > max_z) ? pixel[x] : max_z;
+            }
+            pixel += WINDOW_WIDTH;
+        }
+    }
+    hiz.max_z[tile_y][tile_x] = max_z;
+    hiz.dirty[tile_y][tile_x] = 0;
+}
+
+// Tests triangle with bounding box min_x,min_y - max_x,max_y (clipped to the
+// screen and to the tile of the calling thread) and nearest depth key against
+// the tiles. Returns 1 if no pixel of it can pass the depth test, otherwise
+// marks the tiles as drawn and returns 0. Dirty tiles are recomputed first if
+// the box is large enough to pay for it.
+int hiz_triangle_hidden(int min_x, int min_y, int max_x, int max_y, int key) {
+    int tile_x0 = min_x / HIZ_TILE, tile_x1 = max_x / HIZ_TILE,
+        tile_y0 = min_y / HIZ_TILE, tile_y1 = max_y / HIZ_TILE;
+
+    // recomputing a tile costs about as much as drawing a tile worth of pixels
+    int refresh = (max_x - min_x + 1) * (max_y - min_y + 1) >= HIZ_REFRESH_AREA;
+
+    // the margin below the nearest vertex covers rounding of the stepped depths
+    key -= depth_margin(key);
+    int visible = 0;
+    for(int tile_y = tile_y0; tile_y <= tile_y1 && !visible; tile_y++) {
+        for(int tile_x = tile_x0; tile_x <= tile_x1; tile_x++) {
+            if(key >= hiz.max_z[tile_y][tile_x]) {
+                continue;
+            }
+            if(refresh && hiz.dirty[tile_y][tile_x]) {
+                hiz_refresh(tile_x, tile_y);
+                if(key >= hiz.max_z[tile_y][tile_x]) {
+                    continue;
+                }
+            }
+            visible = 1;
+            break;
+        }
+    }
+    if(!visible) {
+        return 1;
+    }
+    for(int tile_y = tile_y0; tile_y <= tile_y1; tile_y++) {
+        for(int tile_x = tile_x0; tile_x <= tile_x1; tile_x++) {
+            hiz.dirty[tile_y][tile_x] = 1;
+        }
+    }
+    return 0;
+}
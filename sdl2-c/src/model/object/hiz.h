@@ -0,0 +1,168 @@
+#ifndef HIZ_H
+#define HIZ_H
+
+#include "../global.h"
+#include "depth.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Hierarchical z.
+// Keeps the largest depth of every HIZ_TILE x HIZ_TILE tile of the z-buffer, so
+// triangles and spans that are entirely behind everything already drawn in the
+// tiles they touch are rejected before any per pixel work. Depths in the
+// z-buffer only decrease while a frame is drawn, so an old maximum is still a
+// safe bound: drawing only marks tiles dirty and a dirty tile is recomputed
+// when a triangle is tested against it.
+// The tiles belong to the z-buffer last cleared with buffers_clear and are
+// ignored for every other buffer.
+//
+// The same tiles carry frame epochs. With CLEAR_EPOCH a clear only starts a new
+// epoch: every row of tiles still holding an older epoch counts as cleared and
+// a tile of it is wiped the first time a triangle touches it, while its pixels
+// are likely in cache anyway (one bit per tile, so the test is a mask compare).
+// Tiles nobody drew are blanked by buffers_resolve before the pixelmap is
+// shown, and only once for as long as they stay empty. Raster threads drawing
+// different tiles of a row share its masks, so those are updated atomically.
+
+#define HIZ_TILE     8
+#define HIZ_TILES_X  (WINDOW_WIDTH / HIZ_TILE)
+#define HIZ_TILES_Y  (WINDOW_HEIGHT / HIZ_TILE)
+#define HIZ_MIN_SPAN HIZ_TILE   // shorter spans cost less to draw than to test
+
+#if WINDOW_WIDTH % HIZ_TILE != 0 || WINDOW_HEIGHT % HIZ_TILE != 0
+#error "WINDOW_WIDTH and WINDOW_HEIGHT must be multiples of HIZ_TILE"
+#endif
+#if HIZ_TILES_X > 64
+#error "a row of tiles must fit into the 64 bit wiped and blank masks"
+#endif
+
+#define CLEAR_FULL  0   // every pixel written by the clear (SSE2, non-temporal for large buffers)
+#define CLEAR_EPOCH 1   // clear starts a new epoch, tiles are wiped when first drawn
+
+// Tile maxima and epochs of one z-buffer and pixelmap.
+typedef struct {
+    int        enabled;
+    int        clear;                                   // CLEAR_FULL or CLEAR_EPOCH
+    void*      z_buffer;                                // buffer the tiles describe
+    int        narrow;                                  // it holds 16 bit depths (DEPTH_16)
+    uint32_t*  pixelmap;                                // pixelmap cleared with it
+    uint32_t   epoch;                                   // increased by every clear
+    int        max_z[HIZ_TILES_Y][HIZ_TILES_X];         // upper bound of depths in tile
+    uint8_t    dirty[HIZ_TILES_Y][HIZ_TILES_X];         // drawn since max_z was computed
+    uint32_t   row_epoch[HIZ_TILES_Y];                  // epoch the wiped mask of the row belongs to
+    _Atomic uint64_t wiped[HIZ_TILES_Y];                // tiles of the row wiped in row_epoch
+    _Atomic uint64_t blank[HIZ_TILES_Y];                // tiles of the row with all pixels black
+}HierarchicalZ;
+
+extern HierarchicalZ hiz;
+
+// Turns hierarchical z rejection on or off (off by default).
+void raster_set_hiz(int enabled);
+// Returns 1 if hierarchical z rejection is on.
+int raster_hiz(void);
+
+// Selects full or epoch clears (epoch by default).
+void raster_set_clear(int mode);
+// Returns clear in use.
+int raster_clear(void);
+// Returns name of clear ("full" or "epoch").
+const char* raster_clear_name(int mode);
+
+// Clears pixelmap to black and z_buffer to the largest depth (INT_MAX, or
+// DEPTH_16_FAR for 16 bit depths) and binds the tiles to them. With CLEAR_EPOCH
+// this only starts a new epoch, so until buffers_resolve the buffers must only be drawn with draw_triangle_3D_z.
+// Buffers cleared any other way are not tested against the tiles.
+void buffers_clear(uint32_t* pixelmap, void* z_buffer);
+
+// Blanks pixels of the tiles no triangle touched since buffers_clear, after
+// this the pixelmap can be shown. Depths of those tiles stay stale.
+void buffers_resolve(void);
+
+// Returns 1 if the tiles are in use for z_buffer (never for a NULL z_buffer).
+static inline int hiz_active(const void* z_buffer) {
+    return hiz.enabled && z_buffer != NULL && hiz.z_buffer == z_buffer;
+}
+
+// Returns 1 if triangles drawn into z_buffer have to go through tiles_wipe or
+// hiz_triangle_hidden.
+static inline int tiles_active(const void* z_buffer) {
+    return (hiz.enabled || hiz.clear == CLEAR_EPOCH) && z_buffer != NULL && hiz.z_buffer == z_buffer;
+}
+
+// Returns 1 if triangles painted into pixelmap without a z-buffer have to go
+// through tiles_wipe (the wipe still resets the depths of the tile).
+static inline int tiles_active_painted(const uint32_t* pixelmap) {
+    return hiz.clear == CLEAR_EPOCH && pixelmap != NULL && hiz.pixelmap == pixelmap;
+}
+
+// Tests triangle with bounding box min_x,min_y - max_x,max_y (clipped to the
+// screen and to the tile of the calling thread) and nearest depth key against
+// the tiles. Returns 1 if no pixel of it can pass the depth test, otherwise
+// marks the tiles as drawn and returns 0. Dirty tiles are recomputed first if
+// the box is large enough to pay for it.
+int hiz_triangle_hidden(int min_x, int min_y, int max_x, int max_y, int key);
+
+// Wipes the given tiles of row tile_y that are not yet wiped in the current epoch.
+void tiles_wipe_row(int tile_y, uint64_t tiles);
+
+// Moves every row of an older epoch to the current one with no tile wiped, so
+// threads drawing different tiles of a row only ever add bits to its wiped mask
+// (draw_poly_list_tiled calls it before handing out a frame).
+void tiles_share_rows(void);
+
+// Marks every tile as wiped and not blank in the current epoch without touching
+// pixels or depths, for renderers that wrote every pixel of the bound pixelmap
+// themselves (the depths stay stale until a later epoch wipes the tiles).
+void tiles_cover(void);
+
+// Returns tiles of row wiped in the current epoch, one bit per tile.
+static inline uint64_t tiles_wiped(int tile_y) {
+    return (hiz.row_epoch[tile_y] == hiz.epoch) ? atomic_load_explicit(&hiz.wiped[tile_y], memory_order_relaxed) : 0;
+}
+
+// Wipes tiles of an older epoch under bounding box min_x,min_y - max_x,max_y
+// (clipped to the screen and to the band and columns of the calling thread,
+// which alone owns these tiles). Usually only a mask compare per row of tiles.
+static inline void tiles_wipe(int min_x, int min_y, int max_x, int max_y) {
+    uint64_t tiles = ((((uint64_t) 2) << (max_x / HIZ_TILE)) - 1) & ~((((uint64_t) 1) << (min_x / HIZ_TILE)) - 1);
+    for(int tile_y = min_y / HIZ_TILE; tile_y <= max_y / HIZ_TILE; tile_y++) {
+        if((tiles & ~tiles_wiped(tile_y)) != 0) {
+            tiles_wipe_row(tile_y, tiles);
+        }
+    }
+}
+
+// Returns 1 if the tile holding pixel x,y is nearer than key, the nearest
+// depth key of something inside the tile (the tile is not recomputed).
+// depth_margin is subtracted from key to cover rounding of the stepped depths.
+static inline int hiz_tile_hidden(int x, int y, int key) {
+    return key - depth_margin(key) >= hiz.max_z[y / HIZ_TILE][x / HIZ_TILE];
+}
+
+// Returns 1 if the tiles row y from x_start to x_end runs through are all
+// nearer than key, the nearest depth key of the span (tiles are not recomputed).
+// Spans shorter than HIZ_MIN_SPAN are not worth testing and return 0.
+static inline int hiz_span_hidden(int y, int x_start, int x_end, int key) {
+    if(x_end - x_start + 1 < HIZ_MIN_SPAN) {
+        return 0;
+    }
+    if(x_start < 0) { x_start = 0; }
+    if(x_end > WINDOW_WIDTH - 1) { x_end = WINDOW_WIDTH - 1; }
+    const int* row = hiz.max_z[y / HIZ_TILE];
+    key -= depth_margin(key);
+    for(int tile = x_start / HIZ_TILE; tile <= x_end / HIZ_TILE; tile++) {
+        if(key < row[tile]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Nearest depth key of a span of pixels starting at depth z and stepping dz
+// (keys are monotonic in the depth, so it is at one of the ends).
+static inline int hiz_span_key(float z, float dz, int pixels, int float_depth) {
+    int first = depth_key(z, float_depth), last = depth_key(z + (dz * (pixels - 1)), float_depth);
+    return (first < last) ? first : last;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "polygon.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Meshes loaded so far, looked up by filename and scale.
+static struct {
+    Mesh* meshes[MAX_MESHES];
+    int   amount;
+}mesh_cache;
+
+// Allocates mesh for num_vertices and room for max_polys polygons.
+// Returns NULL if memory could not be allocated.
+Mesh* mesh_create(int num_vertices, int max_polys) {
+    static int id_number = 0;
+    Mesh* mesh = calloc(1, sizeof(Mesh));
+    if(mesh == NULL) {
+        printf("could not allocate mesh\n");
+        return NULL;
+    }
+    mesh->polys = calloc(max_polys > 0 ? max_polys : 1, sizeof(Polygon));
+    if(!vertices_allocate(&mesh->vertices, num_vertices) || mesh->polys == NULL) {
+        printf("could not allocate mesh (verts: %d, polys: %d)\n", num_vertices, max_polys);
+        mesh_free(mesh);
+        return NULL;
+    }
+    mesh->id           = id_number++;
+    mesh->num_vertices = num_vertices;
+    mesh->max_polys    = max_polys;
+    return mesh;
+}
+
+// Frees mesh and all of its buffers.
+void mesh_free(Mesh* mesh) {
+    if(mesh == NULL) {
+        return;
+    }
+    vertices_free(&mesh->vertices);
+    free(mesh->polys);
+    free(mesh);
+}
+
+// Computes bounding sphere and bounding box of mesh.
+// Distances to the origin are measured in one batch (vertices_length).
+void mesh_compute_bounds(Mesh* mesh) {
+    float x,y,z;
+    float* lengths = aligned_alloc(VERTICES_ALIGN, sizeof(float) * mesh->vertices.capacity);
+    if(lengths == NULL) {
+        printf("could not allocate bounds buffer (verts: %d)\n", mesh->num_vertices);
+        return;
+    }
+    vertices_length(&mesh->vertices, lengths, PRECISION_EXACT);
+    mesh->radius = 0;
+    mesh->bounds_min = vector_create(0, 0, 0);
+    mesh->bounds_max = vector_create(0, 0, 0);
+    for(int index = 0; index < mesh->num_vertices; index++) {
+        x = mesh->vertices.x[index];
+        y = mesh->vertices.y[index];
+        z = mesh->vertices.z[index];
+        if(index == 0 || x < mesh->bounds_min.x) { mesh->bounds_min.x = x; }
+        if(index == 0 || y < mesh->bounds_min.y) { mesh->bounds_min.y = y; }
+        if(index == 0 || z < mesh->bounds_min.z) { mesh->bounds_min.z = z; }
+        if(index == 0 || x > mesh->bounds_max.x) { mesh->bounds_max.x = x; }
+        if(index == 0 || y > mesh->bounds_max.y) { mesh->bounds_max.y = y; }
+        if(index == 0 || z > mesh->bounds_max.z) { mesh->bounds_max.z = z; }
+
+        if(lengths[index] > mesh->radius) {
+            mesh->radius = lengths[index];
+        }
+    }
+    free(lengths);
+}
+
+// Returns already loaded mesh of file with same scale or NULL.
+Mesh* mesh_cache_find(const char* filename, float scale) {
+    for(int index = 0; index < mesh_cache.amount; index++) {
+        if(mesh_cache.meshes[index]->scale == scale &&
+           strcmp(mesh_cache.meshes[index]->filename, filename) == 0) {
+            return mesh_cache.meshes[index];
+        }
+    }
+    return NULL;
+}
+
+// Adds mesh to cache so that later loads of the same file reuse it.
+// Returns 0 if cache is full (mesh is then owned by caller).
+int mesh_cache_add(Mesh* mesh, const char* filename, float scale) {
+    snprintf(mesh->filename, sizeof(mesh->filename), "%s", filename);
+    mesh->scale = scale;
+    if(mesh_cache.amount >= MAX_MESHES) {
+        return 0;
+    }
+    mesh_cache.meshes[mesh_cache.amount++] = mesh;
+    return 1;
+}
+
+// Frees every cached mesh, objects using them must not be rendered afterwards.
+void mesh_cache_clear(void) {
+    for(int index = 0; index < mesh_cache.amount; index++) {
+        mesh_free(mesh_cache.meshes[index]);
+        mesh_cache.meshes[index] = NULL;
+    }
+    mesh_cache.amount = 0;
+}
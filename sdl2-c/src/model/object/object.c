@@ -0,0 +1,51 @@
+#include "polygon.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Makes object an instance of mesh placed at origin and allocates its
+// per-frame buffers. Buffers of a previous instance are freed first, so object
+// must either be zeroed or created before. Returns 1 on success.
+int object_create(Object* object, const Mesh* mesh) {
+    static int id_number = 0;
+    int num_polys    = (mesh->num_polys > 0) ? mesh->num_polys : 1;
+
+    object_free(object);
+    object->poly_states = calloc(num_polys, sizeof(PolygonState));
+
+    if(!vertices_allocate(&object->vertices_camera, mesh->num_vertices) || object->poly_states == NULL) {
+        printf("could not allocate object (verts: %d, polys: %d)\n", mesh->num_vertices, mesh->num_polys);
+        object_free(object);
+        return 0;
+    }
+    object->id             = id_number++;
+    object->mesh           = mesh;
+    object->num_vertices   = mesh->num_vertices;
+    object->vertices_local = &mesh->vertices;
+    object->num_polys      = mesh->num_polys;
+    object->polys          = mesh->polys;
+    object->radius         = mesh->radius;
+    object->state          = 1;
+    object->world_pos      = vector_create(0, 0, 0);
+    object->orientation    = quaternion_identity();
+    object->scale          = 1;
+    object->translation_only = 1;
+    object->model          = matrix_create_identity_matrix();
+    object->model_dirty    = 1;
+    object->model_view     = matrix_create_identity_matrix();
+    object->world_valid    = 0;
+    return 1;
+}
+
+// Frees per-object buffers (not the mesh) and sets them to NULL.
+void object_free(Object* object) {
+    vertices_free(&object->vertices_world);
+    vertices_free(&object->vertices_camera);
+    free(object->poly_states);
+    object->poly_states     = NULL;
+    object->vertices_local  = NULL;
+    object->polys           = NULL;
+    object->mesh            = NULL;
+    object->num_vertices    = 0;
+    object->world_valid     = 0;
+    object->num_polys       = 0;
+}
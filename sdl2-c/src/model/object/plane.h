@@ -0,0 +1,20 @@
+#ifndef PLANE_H
+#define PLANE_H
+
+// Plane equations of vertex attributes.
+// Used by the fillers that sample depth, color or texture coordinates at pixel
+// centers (drawsubpixel.c and the textured spans of drawtriangle.c). plane[0]
+// is the value at the first vertex, plane[1] and plane[2] its change per pixel
+// in x and y, so value(x,y) = plane[0] + plane[1] * (x - x[0]) + plane[2] * (y - y[0]).
+// The setup is done in double and only the result is rounded to float.
+
+// Plane through the values a0, a1, a2 at the vertices x, y, inverse_area is
+// 1 / ((x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0])).
+static inline void raster_plane(float plane[3], const double x[3], const double y[3],
+                                double a0, double a1, double a2, double inverse_area) {
+    plane[0] = (float) a0;
+    plane[1] = (float) (((a1 - a0) * (y[2] - y[0]) - (a2 - a0) * (y[1] - y[0])) * inverse_area);
+    plane[2] = (float) (((a2 - a0) * (x[1] - x[0]) - (a1 - a0) * (x[2] - x[0])) * inverse_area);
+}
+
+#endif
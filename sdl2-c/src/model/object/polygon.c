@@ -1,59 +1,171 @@
 #include "polygon.h"
+#include "rasterstats.h"
+#include "depth.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-/* For polygons that are two_sided we create duplicate mirrored polygons */
-void mirror_two_sided_polygons(Object *object) {
+/* For polygons that are two_sided we create duplicate mirrored polygons,
+   done once when mesh is loaded. */
+void mirror_two_sided_polygons(Mesh *mesh) {
     
     int vertex_0, vertex_1, vertex_2;
-    Vector u,v, normal;
+    Vector u,v, normal, p0,p1,p2;
+    int num_polys = mesh->num_polys;
 
-    for(int curr_poly = 0; curr_poly < object->num_polys; curr_poly++) {
-        if(object->polys[curr_poly].two_sided == TWO_SIDED) {
+    for(int curr_poly = 0; curr_poly < num_polys; curr_poly++) {
+        if(mesh->polys[curr_poly].two_sided == TWO_SIDED) {
+            // no room left for mirrored polygon, rest stays one sided.
+            if(mesh->num_polys >= mesh->max_polys) {
+                break;
+            }
 
-            object->polys[curr_poly].two_sided = ONE_SIDED;
+            mesh->polys[curr_poly].two_sided = ONE_SIDED;
             
-            object->polys[object->num_polys].num_points = object->polys[curr_poly].num_points;
-            object->polys[object->num_polys].color      = object->polys[curr_poly].color;
-            object->polys[object->num_polys].two_sided  = ONE_SIDED;
-            object->polys[object->num_polys].visible    = object->polys[object->num_polys].visible;
-            object->polys[object->num_polys].clipped    = object->polys[curr_poly].clipped;
-            object->polys[object->num_polys].active     = object->polys[curr_poly].active;
-
-            if(object->polys[curr_poly].num_points == 3) {
-                object->polys[object->num_polys].vertex_list[0] = object->polys[curr_poly].vertex_list[1];
-                object->polys[object->num_polys].vertex_list[1] = object->polys[curr_poly].vertex_list[0];
-                object->polys[object->num_polys].vertex_list[2] = object->polys[curr_poly].vertex_list[2];
-                object->num_vertices += 3;
-            }
-            else { // Quad
-                object->polys[object->num_polys].vertex_list[0] = object->polys[curr_poly].vertex_list[1];
-                object->polys[object->num_polys].vertex_list[1] = object->polys[curr_poly].vertex_list[0];
-                object->polys[object->num_polys].vertex_list[2] = object->polys[curr_poly].vertex_list[3];
-                object->polys[object->num_polys].vertex_list[3] = object->polys[curr_poly].vertex_list[2];
-                object->num_vertices += 4;
+            mesh->polys[mesh->num_polys].num_points = mesh->polys[curr_poly].num_points;
+            mesh->polys[mesh->num_polys].color      = mesh->polys[curr_poly].color;
+            mesh->polys[mesh->num_polys].two_sided  = ONE_SIDED;
+            mesh->polys[mesh->num_polys].active     = mesh->polys[curr_poly].active;
+            mesh->polys[mesh->num_polys].texture    = mesh->polys[curr_poly].texture;
+
+            // texture coordinates follow their vertices
+            static const int mirrored_triangle[] = { 1, 0, 2 }, mirrored_quad[] = { 1, 0, 3, 2 };
+            const int* mirrored = (mesh->polys[curr_poly].num_points == 3) ? mirrored_triangle : mirrored_quad;
+            for(int vertex = 0; vertex < mesh->polys[curr_poly].num_points; vertex++) {
+                mesh->polys[mesh->num_polys].vertex_list[vertex] = mesh->polys[curr_poly].vertex_list[mirrored[vertex]];
+                mesh->polys[mesh->num_polys].uv[vertex][0]       = mesh->polys[curr_poly].uv[mirrored[vertex]][0];
+                mesh->polys[mesh->num_polys].uv[vertex][1]       = mesh->polys[curr_poly].uv[mirrored[vertex]][1];
             }
 
 
-            vertex_0 = object->polys[object->num_polys].vertex_list[0];
-            vertex_1 = object->polys[object->num_polys].vertex_list[1];
-            vertex_2 = object->polys[object->num_polys].vertex_list[2];
+            vertex_0 = mesh->polys[mesh->num_polys].vertex_list[0];
+            vertex_1 = mesh->polys[mesh->num_polys].vertex_list[1];
+            vertex_2 = mesh->polys[mesh->num_polys].vertex_list[2];
             // the vector u = v0->v1
-            u = vector_sub(&object->vertices_local[vertex_0], &object->vertices_local[vertex_1]);
+            p0 = vertices_get(&mesh->vertices, vertex_0);
+            p1 = vertices_get(&mesh->vertices, vertex_1);
+            p2 = vertices_get(&mesh->vertices, vertex_2);
+            u = vector_sub(&p0, &p1);
             // the vector v = v0->v2
-            v = vector_sub(&object->vertices_local[vertex_0], &object->vertices_local[vertex_2]);
+            v = vector_sub(&p0, &p2);
     
             normal = vector_cross_product(&v, &u);
-            object->polys[object->num_polys].normal = normal;
+            mesh->polys[mesh->num_polys].normal = normal;
 
-            object->num_polys++;
+            mesh->num_polys++;
             
         }
     }
 }
 
 
+// Order sort_poly_list puts the list in.
+static int sort_mode = POLY_SORT_NONE;
+
+// Only the top SORT_KEY_BITS of the float are sorted (sign, exponent and 13
+// bits of mantissa, depths closer than 1 part in 8192 keep their order), the
+// radix sort takes SORT_RADIX_BITS of them per pass.
+#define SORT_KEY_BITS   22
+#define SORT_RADIX_BITS 11
+#define SORT_BUCKETS    (1 << SORT_RADIX_BITS)
+#define SORT_PASSES     ((SORT_KEY_BITS + SORT_RADIX_BITS - 1) / SORT_RADIX_BITS)
+
+// Keys and facets of the pass being scattered, the list itself is the other half.
+static uint32_t sort_keys[2][MAX_POLYS_PER_FRAME];
+static facet*   sort_polys[MAX_POLYS_PER_FRAME];
+
+// Selects order sort_poly_list puts the list in (POLY_SORT_NONE by default).
+void poly_set_sort(int mode) {
+    sort_mode = (mode == POLY_SORT_FRONT_TO_BACK || mode == POLY_SORT_BACK_TO_FRONT) ? mode : POLY_SORT_NONE;
+}
+
+// Returns order in use.
+int poly_sort(void) {
+    return sort_mode;
+}
+
+// Returns name of order ("none", "front-to-back" or "back-to-front").
+const char* poly_sort_name(int mode) {
+    if(mode == POLY_SORT_FRONT_TO_BACK) {
+        return "front-to-back";
+    }
+    return (mode == POLY_SORT_BACK_TO_FRONT) ? "back-to-front" : "none";
+}
+
+// Returns sort key of facet, the bits of its average z turned into an unsigned
+// integer with the same order as the floats (negative ones have every bit
+// flipped, positive ones only the sign bit) cut to the top SORT_KEY_BITS.
+// Back to front flips the key.
+static inline uint32_t poly_sort_key(const facet* poly) {
+    float z = poly->vertex_list[0].z + poly->vertex_list[1].z + poly->vertex_list[2].z;
+    uint32_t bits;
+
+    z = (poly->num_points == 4) ? (z + poly->vertex_list[3].z) * 0.25f : z * (1.0f / 3.0f);
+    memcpy(&bits, &z, sizeof(bits));
+    bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    if(sort_mode == POLY_SORT_BACK_TO_FRONT) {
+        bits = ~bits;
+    }
+    return bits >> (32 - SORT_KEY_BITS);
+}
+
+// Sorts the list by average camera space z of each facet with a stable radix
+// sort (linear time, facets of equal depth keep their order). Does nothing
+// with POLY_SORT_NONE. Uses static scratch buffers, so it is not reentrant.
+void sort_poly_list(facet **world_polys, int num_polys_frame) {
+    static int histogram[SORT_PASSES][SORT_BUCKETS];
+    uint32_t *keys = sort_keys[0], *keys_out = sort_keys[1];
+    facet   **polys = world_polys, **polys_out = sort_polys;
+
+    if(sort_mode == POLY_SORT_NONE || num_polys_frame < 2) {
+        return;
+    }
+
+    // keys and the histograms of every pass in one go over the list
+    memset(histogram, 0, sizeof(histogram));
+    for(int curr_poly = 0; curr_poly < num_polys_frame; curr_poly++) {
+        uint32_t key = poly_sort_key(world_polys[curr_poly]);
+        keys[curr_poly] = key;
+        for(int pass = 0; pass < SORT_PASSES; pass++) {
+            histogram[pass][(key >> (pass * SORT_RADIX_BITS)) & (SORT_BUCKETS - 1)]++;
+        }
+    }
+
+    for(int pass = 0; pass < SORT_PASSES; pass++) {
+        int shift = pass * SORT_RADIX_BITS;
+        int* count = histogram[pass];
+
+        // every key has the same digit, the pass would not move anything
+        if(count[(keys[0] >> shift) & (SORT_BUCKETS - 1)] == num_polys_frame) {
+            continue;
+        }
+        // bucket counts into first index of each bucket
+        int offset = 0;
+        for(int bucket = 0; bucket < SORT_BUCKETS; bucket++) {
+            int amount = count[bucket];
+            count[bucket] = offset;
+            offset += amount;
+        }
+        for(int curr_poly = 0; curr_poly < num_polys_frame; curr_poly++) {
+            int index = count[(keys[curr_poly] >> shift) & (SORT_BUCKETS - 1)]++;
+            keys_out[index]  = keys[curr_poly];
+            polys_out[index] = polys[curr_poly];
+        }
+        uint32_t* temp_keys = keys;
+        keys = keys_out;
+        keys_out = temp_keys;
+        facet** temp_polys = polys;
+        polys = polys_out;
+        polys_out = temp_polys;
+    }
+
+    // an odd amount of passes left the result in the scratch buffer
+    if(polys != world_polys) {
+        memcpy(world_polys, polys, sizeof(facet*) * num_polys_frame);
+    }
+}
+
 // this function is used to generate the final plygon list that will be
 // rendered. Object by object the list is built up.
 void generate_poly_list(facet *world_poly_storage, facet **world_polys, int *num_polys_frame, Object* object) {
@@ -62,28 +174,36 @@ void generate_poly_list(facet *world_poly_storage, facet **world_polys, int *num
 
     // insert all visible polygons into polygon list
     for(curr_poly = 0; curr_poly < object->num_polys; curr_poly++) {
-        if(object->polys[curr_poly].visible && !object->polys[curr_poly].clipped) {
+        if(object->poly_states[curr_poly].visible && !object->poly_states[curr_poly].clipped) {
+            // polygon list is full, remaining polygons are dropped this frame.
+            if(p_num_polys_frame >= MAX_POLYS_PER_FRAME) {
+                break;
+            }
             // first copy data and vertices into an open slot in storage area
 
 
             world_poly_storage[p_num_polys_frame].num_points = object->polys[curr_poly].num_points;
             world_poly_storage[p_num_polys_frame].color      = object->polys[curr_poly].color;
-            world_poly_storage[p_num_polys_frame].shade[0]      = object->polys[curr_poly].shade[0];
-            world_poly_storage[p_num_polys_frame].shade[1]      = object->polys[curr_poly].shade[1];
-            world_poly_storage[p_num_polys_frame].shade[2]      = object->polys[curr_poly].shade[2];
-            world_poly_storage[p_num_polys_frame].shade[3]      = object->polys[curr_poly].shade[3];
+            world_poly_storage[p_num_polys_frame].shade[0]      = object->poly_states[curr_poly].shade[0];
+            world_poly_storage[p_num_polys_frame].shade[1]      = object->poly_states[curr_poly].shade[1];
+            world_poly_storage[p_num_polys_frame].shade[2]      = object->poly_states[curr_poly].shade[2];
+            world_poly_storage[p_num_polys_frame].shade[3]      = object->poly_states[curr_poly].shade[3];
             world_poly_storage[p_num_polys_frame].two_sided  = object->polys[curr_poly].two_sided;
-            world_poly_storage[p_num_polys_frame].visible    = object->polys[curr_poly].visible;
-            world_poly_storage[p_num_polys_frame].clipped    = object->polys[curr_poly].clipped;
+            world_poly_storage[p_num_polys_frame].visible    = object->poly_states[curr_poly].visible;
+            world_poly_storage[p_num_polys_frame].clipped    = object->poly_states[curr_poly].clipped;
             world_poly_storage[p_num_polys_frame].active     = object->polys[curr_poly].active;
+            world_poly_storage[p_num_polys_frame].texture    = object->polys[curr_poly].texture;
 
             // continue and copy vertices
             for(curr_vertex = 0; curr_vertex < object->polys[curr_poly].num_points; curr_vertex++) {
                 // extract vertex number and then x,y,z values
                 vertex = object->polys[curr_poly].vertex_list[curr_vertex];
-                world_poly_storage[p_num_polys_frame].vertex_list[curr_vertex].x = object->vertices_camera[vertex].x;
-                world_poly_storage[p_num_polys_frame].vertex_list[curr_vertex].y = object->vertices_camera[vertex].y;
-                world_poly_storage[p_num_polys_frame].vertex_list[curr_vertex].z = object->vertices_camera[vertex].z;
+                world_poly_storage[p_num_polys_frame].vertex_list[curr_vertex].x = object->vertices_camera.x[vertex];
+                world_poly_storage[p_num_polys_frame].vertex_list[curr_vertex].y = object->vertices_camera.y[vertex];
+                world_poly_storage[p_num_polys_frame].vertex_list[curr_vertex].z = object->vertices_camera.z[vertex];
+            }
+            if(object->polys[curr_poly].texture != NULL) {
+                memcpy(world_poly_storage[p_num_polys_frame].uv, object->polys[curr_poly].uv, sizeof(object->polys[curr_poly].uv));
             }
 
             // assing pointer to frame and increase number of polys.
@@ -95,67 +215,167 @@ void generate_poly_list(facet *world_poly_storage, facet **world_polys, int *num
     } // end for curr_poly
 }
 
+// Projects facet to the screen and stores its triangles in triangles (a quad
+// is split in 2, the second one flat shaded, depths encoded with depth_encode).
+// Textured facets keep their texture unless a vertex is not in front of the camera.
+// Returns amount of triangles, 0 when the facet is entirely in front of near z
+// or behind far z.
+int project_facet(const facet* poly, RasterTriangle triangles[2]) {
+    float x1, y1, z1, x2, y2, z2,
+          x3, y3, z3, x4 = 0, y4 = 0, z4;
+
+    // do Z clipping first before projection
+    z1 = poly->vertex_list[0].z;
+    z2 = poly->vertex_list[1].z;
+    z3 = poly->vertex_list[2].z;
+    int is_quad = 0;
+
+    // test if this is a quad
+    // extract vertex number and z component for clipping and projection
+    if(poly->num_points == 4) {
+        z4 = poly->vertex_list[3].z;
+        is_quad = 1;
+    } else {
+        z4 = z3;
+    }
+
+    RASTER_STAT_ADD(triangles_submitted, 1 + is_quad);
+
+    // perform z clipping test
+    if((z1 < CLIP_NEAR_Z && z2 < CLIP_NEAR_Z && z3 < CLIP_NEAR_Z && z4 < CLIP_NEAR_Z) || 
+       (z1 > CLIP_FAR_Z && z2 > CLIP_FAR_Z && z3 > CLIP_FAR_Z && z4 > CLIP_FAR_Z))
+    {
+        RASTER_STAT_ADD(rejected_z_clipped, 1 + is_quad);
+        return 0;
+    }
+
+    x1 = poly->vertex_list[0].x;
+    y1 = poly->vertex_list[0].y;
+    x2 = poly->vertex_list[1].x;
+    y2 = poly->vertex_list[1].y;
+    x3 = poly->vertex_list[2].x;
+    y3 = poly->vertex_list[2].y;
+
+    // compute screen position of points
+    x1 = (((float) WINDOW_WIDTH / 2)  + x1 * VIEWING_DISTANCE / z1);
+    y1 = (((float) WINDOW_HEIGHT / 2) + ASPECT_RATIO * y1 * VIEWING_DISTANCE / z1);
+    x2 = (((float) WINDOW_WIDTH / 2)  + x2 * VIEWING_DISTANCE / z2);
+    y2 = (((float) WINDOW_HEIGHT / 2) + ASPECT_RATIO * y2 * VIEWING_DISTANCE / z2);
+    x3 = (((float) WINDOW_WIDTH / 2)  + x3 * VIEWING_DISTANCE / z3);
+    y3 = (((float) WINDOW_HEIGHT / 2) + ASPECT_RATIO * y3 * VIEWING_DISTANCE / z3); 
+
+    //shade instead of color according to Lamotte.
+    triangles[0] = (RasterTriangle) {
+        .x     = { (int) x1, (int) x2, (int) x3 },
+        .y     = { (int) y1, (int) y2, (int) y3 },
+        .z     = { depth_encode(z1), depth_encode(z2), depth_encode(z3) },
+        .color = { poly->shade[0], poly->shade[1], poly->shade[2], poly->shade[3] },
+        .mode  = GOURAUD_SHADING
+    };
+
+    // second triangle if this is a quad
+    if(is_quad) {
+        // extract the point
+        x4 = poly->vertex_list[3].x;
+        y4 = poly->vertex_list[3].y;
+        x4 = (((float) WINDOW_WIDTH / 2)  + x4 * VIEWING_DISTANCE / z4);
+        y4 = (((float) WINDOW_HEIGHT / 2) + ASPECT_RATIO * y4 * VIEWING_DISTANCE / z4);
+
+        triangles[1] = (RasterTriangle) {
+            .x     = { (int) x3, (int) x4, (int) x1 },
+            .y     = { (int) y3, (int) y4, (int) y1 },
+            .z     = { depth_encode(z3), depth_encode(z4), depth_encode(z1) },
+            .color = { poly->shade[2], poly->shade[3], poly->shade[0], 0 },
+            .mode  = FLAT_SHADING
+        };
+    } // end if quad
+
+    // 28.4 sub-pixel positions for RASTER_SUBPIXEL (the literals above zero them)
+    const float xs[4] = { x1, x2, x3, x4 }, ys[4] = { y1, y2, y3, y4 };
+    static const int vertices[2][3] = { { 0, 1, 2 }, { 2, 3, 0 } };
+    for(int triangle = 0; triangle <= is_quad; triangle++) {
+        for(int i = 0; i < 3; i++) {
+            triangles[triangle].sx[i] = subpixel_from_float(xs[vertices[triangle][i]]);
+            triangles[triangle].sy[i] = subpixel_from_float(ys[vertices[triangle][i]]);
+        }
+    }
+
+    // texture coordinates and 1/z, perspective is undefined for vertices not
+    // in front of the camera (only left when the clipped list was full)
+    if(poly->texture != NULL && z1 > 0 && z2 > 0 && z3 > 0 && z4 > 0) {
+        static const int corners[2][3] = { { 0, 1, 2 }, { 2, 3, 0 } };
+        for(int triangle = 0; triangle <= is_quad; triangle++) {
+            RasterTriangle* t = &triangles[triangle];
+            t->texture = poly->texture;
+            for(int i = 0; i < 3; i++) {
+                int corner = corners[triangle][i];
+                t->u[i] = poly->uv[corner][0];
+                t->v[i] = poly->uv[corner][1];
+                t->w[i] = 1.0f / poly->vertex_list[corner].z;
+            }
+        }
+    }
+    return 1 + is_quad;
+}
+
+// Draws triangle from project_facet with draw_triangle_3D_z, with
+// draw_triangle_subpixel for RASTER_SUBPIXEL scanline stepping, or with
+// draw_triangle_textured if it has a texture and texturing is not TEXTURE_OFF.
+void draw_raster_triangle(RasterTriangle* t, uint32_t* pixelmap, void *z_buffer) {
+    if(t->texture != NULL && raster_texture() != TEXTURE_OFF) {
+        draw_triangle_textured(t, pixelmap, z_buffer);
+        return;
+    }
+    if(raster_stepping() == RASTER_SUBPIXEL && raster_algorithm() == RASTER_SCANLINE) {
+        draw_triangle_subpixel(t, pixelmap, z_buffer);
+        return;
+    }
+    draw_triangle_3D_z(t->x[0], t->y[0], t->z[0], t->x[1], t->y[1], t->z[1], t->x[2], t->y[2], t->z[2],
+                       t->color, pixelmap, z_buffer, t->mode);
+}
+
     // this function draws the global polygon list generated by calls to 
     // generate_poly_list using the z buffer triangle system.
-void draw_poly_list_z(facet **world_polys, int *num_polys_frame, uint32_t* pixelmap, int *z_buffer) {
-    float x1, y1, z1, x2, y2, z2,
-          x3, y3, z3, x4, y4, z4;
+    // With more than 1 raster thread the list is drawn by draw_poly_list_tiled.
+    // With POLY_SORT_BACK_TO_FRONT the list is painted in its order without
+    // touching z_buffer (painter's algorithm, sort_poly_list puts it in order).
+    // With SHADE_DEFERRED the triangles are drawn as ids and shaded afterwards.
+    // With HSR_SBUFFER the list is drawn by draw_poly_list_spans (z_buffer,
+    // sort order, threads and shading do not matter then).
+void draw_poly_list_z(facet **world_polys, int *num_polys_frame, uint32_t* pixelmap, void *z_buffer) {
+    RasterTriangle triangles[2];
+    int deferred = (raster_shading() == SHADE_DEFERRED);
+
+    if(raster_hsr() == HSR_SBUFFER) {
+        draw_poly_list_spans(world_polys, *num_polys_frame, pixelmap);
+        return;
+    }
+
+    // the fillers skip the depth test when they get no z-buffer
+    if(sort_mode == POLY_SORT_BACK_TO_FRONT) {
+        z_buffer = NULL;
+    }
+
+    if(raster_threads() > 1) {
+        draw_poly_list_tiled(world_polys, *num_polys_frame, pixelmap, z_buffer);
+        return;
+    }
 
     // draw each polygon in list
+    if(deferred) {
+        visibility_begin();
+    }
     for(int curr_poly = 0; curr_poly < *num_polys_frame; curr_poly++) {
-        // do Z clipping first before projection
-        z1 = world_polys[curr_poly]->vertex_list[0].z;
-        z2 = world_polys[curr_poly]->vertex_list[1].z;
-        z3 = world_polys[curr_poly]->vertex_list[2].z; 
-        int is_quad = 0;
-
-        // test if this is a quad
-        // extract vertex number and z component for clipping and projection
-        if(world_polys[curr_poly]->num_points == 4) {
-            z4 = world_polys[curr_poly]->vertex_list[3].z;
-            is_quad = 1;
-        } else {
-            z4 = z3;
+        int count = project_facet(world_polys[curr_poly], triangles);
+        for(int i = 0; i < count; i++) {
+            if(!deferred || visibility_add(&triangles[i])) {
+                draw_raster_triangle(&triangles[i], pixelmap, z_buffer);
+            }
         }
-
-        // perform z clipping test
-        if((z1 < CLIP_NEAR_Z && z2 < CLIP_NEAR_Z && z3 < CLIP_NEAR_Z && z4 < CLIP_NEAR_Z) || 
-           (z1 > CLIP_FAR_Z && z2 > CLIP_FAR_Z && z3 > CLIP_FAR_Z && z4 > CLIP_FAR_Z))
-        { continue; }
-
-        x1 = world_polys[curr_poly]->vertex_list[0].x;
-        y1 = world_polys[curr_poly]->vertex_list[0].y;
-        x2 = world_polys[curr_poly]->vertex_list[1].x;
-        y2 = world_polys[curr_poly]->vertex_list[1].y;
-        x3 = world_polys[curr_poly]->vertex_list[2].x;
-        y3 = world_polys[curr_poly]->vertex_list[2].y;
-
-        // compute screen position of points
-        x1 = (((float) WINDOW_WIDTH / 2)  + x1 * VIEWING_DISTANCE / z1);
-        y1 = (((float) WINDOW_HEIGHT / 2) + ASPECT_RATIO * y1 * VIEWING_DISTANCE / z1);
-        x2 = (((float) WINDOW_WIDTH / 2)  + x2 * VIEWING_DISTANCE / z2);
-        y2 = (((float) WINDOW_HEIGHT / 2) + ASPECT_RATIO * y2 * VIEWING_DISTANCE / z2);
-        x3 = (((float) WINDOW_WIDTH / 2)  + x3 * VIEWING_DISTANCE / z3);
-        y3 = (((float) WINDOW_HEIGHT / 2) + ASPECT_RATIO * y3 * VIEWING_DISTANCE / z3); 
-
-
-        //shade instead of color according to Lamotte.
-        draw_triangle_3D_z((int) x1, (int) y1, (int) z1, (int) x2, (int) y2, (int) z2,(int) x3, (int) y3, (int) z3, 
-                            world_polys[curr_poly]->shade, pixelmap, z_buffer, GOURAUD_SHADING);
-
-        // draw second poly if this is a quad
-        if(is_quad) {
-            // extract the point
-            x4 = world_polys[curr_poly]->vertex_list[3].x;
-            y4 = world_polys[curr_poly]->vertex_list[3].y;
-            x4 = (((float) WINDOW_WIDTH / 2)  + x4 * VIEWING_DISTANCE / z4);
-            y4 = (((float) WINDOW_HEIGHT / 2) + ASPECT_RATIO * y4 * VIEWING_DISTANCE / z4);
-
-            int quadcolors[3] = {world_polys[curr_poly]->shade[2], world_polys[curr_poly]->shade[3], world_polys[curr_poly]->shade[0]};
-            draw_triangle_3D_z((int) x3, (int) y3, (int) z3,(int) x4, (int) y4, (int) z4, (int) x1, (int) y1, (int) z1,
-                             quadcolors, pixelmap, z_buffer, FLAT_SHADING);
-        } // end if quad
-
     } // end for curr_poly
-}
 
+    // shade every visible pixel once
+    if(deferred) {
+        visibility_shade(pixelmap, 0, 0, WINDOW_WIDTH - 1, WINDOW_HEIGHT - 1);
+    }
+}
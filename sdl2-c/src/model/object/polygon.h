@@ -3,14 +3,16 @@
 
 #include "../math/vector.h"
 #include "../math/matrix.h"
+#include "../math/vertices.h"
+#include "../math/quaternion.h"
 #include "../global.h"
 #include "../../integration/display.h"
+#include "texture.h"
+#include <math.h>
 #include <stdint.h>
 #include <stdio.h>
 
-#define MAX_VERTICES_PER_OBJECT 17019
 #define MAX_POINTS_PER_POLYGON 4
-#define MAX_POLYS_PER_OBJECT 9720
 #define MAX_POLYS_PER_FRAME 9720
 
 // vertex_0 = top left
@@ -18,20 +20,31 @@
 // vertex_2 = bottom right
 // vertex_3 = bottom left
 
+#define MAX_MESHES 64             // amount of distinct meshes kept in mesh cache
+
+// Polygon of a mesh, shared by every object that uses the mesh
+// and never changed after loading.
 typedef struct {
     int num_points;
     int vertex_list[MAX_POINTS_PER_POLYGON];
     Vector normal;
 
     int color;
-    int shade[4];
     int two_sided;
-    int visible;
     int active;
-    int clipped;
-    
+
+    const Texture* texture;                     // NULL if polygon is not textured
+    float uv[MAX_POINTS_PER_POLYGON][2];        // texture coordinates of each vertex
 }Polygon;
 
+// Per object state of a polygon, rewritten every frame by
+// remove_backfaces, clip_object_3D and light.
+typedef struct {
+    int shade[4];
+    int visible;
+    int clipped;
+}PolygonState;
+
 typedef struct {
     int num_points;     // number of vertices
     int color;       // color for each vertex of polygon
@@ -43,52 +56,132 @@ typedef struct {
 
     Vector vertex_list[MAX_POINTS_PER_POLYGON]; // the points that make up the polygon facet
     Vector normal;
+
+    const Texture* texture;                     // NULL if facet is not textured
+    float uv[MAX_POINTS_PER_POLYGON][2];        // texture coordinates of each vertex (only if textured)
 }facet, *facet_ptr;
 
+// Mesh structure.
+// Immutable geometry loaded once per file and shared by all objects using it:
+// local vertices, polygons (indices, precomputed normals and colors) and bounds.
+// Two sided polygons are already mirrored into one sided pairs when loaded.
+typedef struct {
+    int id;
+    char filename[128];         // file and scale mesh was loaded with (mesh cache key)
+    float scale;
+
+    int num_vertices;
+    Vertices vertices;
+
+    int num_polys;
+    int max_polys;              // room in polys, leaves space for mirrored polygons
+    Polygon* polys;
+
+    float radius;               // bounding sphere around local origin
+    Vector bounds_min;          // bounding box in local coordinates
+    Vector bounds_max;
+}Mesh;
+
+// Object structure.
+// Lightweight instance of a mesh, holds only its own transform, state and the
+// per-frame scratch buffers. vertices_local and polys point into the mesh and
+// are never changed, rotating or scaling an object only changes its transform.
 typedef struct {
     int id;
+    const Mesh* mesh;
+
     int num_vertices;
-    Vector vertices_local[MAX_VERTICES_PER_OBJECT];
-    Vector vertices_world[MAX_VERTICES_PER_OBJECT];
-    Vector vertices_camera[MAX_VERTICES_PER_OBJECT];
+    const Vertices* vertices_local;
+    Vertices vertices_world;    // only filled when a stage asks for them (object_world_vertices)
+    Vertices vertices_camera;
 
     int num_polys;
-    Polygon polys[MAX_POLYS_PER_OBJECT];
+    const Polygon* polys;
+    PolygonState* poly_states;
 
-    float radius;
+    float radius;               // bounding sphere of mesh times scale
     int state;
     Vector world_pos;
+    Quaternion orientation;     // rotation of object around its local origin
+    float scale;                // uniform scale relative to mesh
+    int translation_only;       // 1 while object is neither rotated nor scaled
+    Matrix model;               // local to world coordinates, rebuilt when model_dirty
+    int model_dirty;            // 1 if model does not match position, orientation and scale
+    Matrix model_view;          // local to camera coordinates of last view transformation
+    int world_valid;            // 1 if vertices_world matches current transform
 }Object;
 
+/* Mesh functions found in mesh.c */
+
+// Allocates mesh for num_vertices and room for max_polys polygons.
+// Returns NULL if memory could not be allocated.
+Mesh* mesh_create(int num_vertices, int max_polys);
+// Frees mesh and all of its buffers.
+void mesh_free(Mesh* mesh);
+// Computes bounding sphere and bounding box of mesh.
+// Distances to the origin are measured in one batch (vertices_length).
+void mesh_compute_bounds(Mesh* mesh);
+// Returns already loaded mesh of file with same scale or NULL.
+Mesh* mesh_cache_find(const char* filename, float scale);
+// Adds mesh to cache so that later loads of the same file reuse it.
+// Returns 0 if cache is full (mesh is then owned by caller).
+int mesh_cache_add(Mesh* mesh, const char* filename, float scale);
+// Frees every cached mesh, objects using them must not be rendered afterwards.
+void mesh_cache_clear(void);
+
+/* Object memory found in object.c */
+
+// Makes object an instance of mesh placed at origin and allocates its
+// per-frame buffers. Buffers of a previous instance are freed first, so object
+// must either be zeroed or created before. Returns 1 on success.
+int object_create(Object* object, const Mesh* mesh);
+// Frees per-object buffers (not the mesh) and sets them to NULL.
+void object_free(Object* object);
+
 /* Object Transforms found in transform.c */
 
-// Computes the maximum radius or sphere around object.
+// Computes the maximum radius or sphere around object (scale included).
+// Distances to the origin are measured in one batch (vertices_length).
 float compute_object_radius(Object* object);
-// Rotates object along the y-axis.
+// Rotates object along the y-axis, only the orientation of the object changes
+// and the local vertices of its mesh are left as they are.
 void object_rotate_y(Object* object, float angle_rad);
-// Rotates object along the z-axis.
+// Rotates object along the z-axis, only the orientation of the object changes
+// and the local vertices of its mesh are left as they are.
 void object_rotate_z(Object* object, float angle_rad);
-// Transforms local coordinates to world coordinates by simply translating (adding) world pos 
-// with local coordinates.
+// Sets uniform scale of object relative to its mesh, bounding radius follows.
+void object_scale(Object* object, float scale);
+// Returns the model matrix of object: scale, then orientation, then translation
+// to world position (row vectors, v * S * R * T). Only rebuilt when dirty.
+const Matrix* object_model_matrix(Object* object);
+// Transforms local coordinates to world coordinates. Objects that are neither
+// rotated nor scaled are simply translated (adding world pos to local coordinates).
 void object_local_to_world_transformation(Object* object);
-// Convert the local coordinates into world and camera coordinates for shadin and projection. 
-// Note the viewer is at (0,0,0) with angles 0,0,0 so the transformation is imply to add the 
-// world position to each local vertex
+// Returns world coordinates of object, they are only computed the first time
+// a stage asks for them after object_view_transformation.
+const Vertices* object_world_vertices(Object* object);
+// Converts local coordinates straight into camera coordinates for shading and
+// projection. The model matrix is concatenated with view_inverse once, so every
+// vertex is transformed by a single matrix (world coordinates are skipped).
 void object_view_transformation(Object* object, Matrix* view_inverse);
 // Sets the world position of an object.
 static inline void object_position(Object* object, int x, int y, int z) {
     object->world_pos.x = x; object->world_pos.y = y; object->world_pos.z = z;
+    object->model_dirty = 1; object->world_valid = 0;
 }
 
 /* All clipping function found in clip.c */
-void mirror_two_sided_polygons(Object *object);
+
+// For two sided polygons of mesh a mirrored one sided copy is added,
+// done once when mesh is loaded.
+void mirror_two_sided_polygons(Mesh *mesh);
 
 // Determines if object is out of frame by comparing bounding sphere to z and then x,y frame.
 // return 1 means object is out of frame and should be removed. 0 means it should not be removed.
 int object_culling(Object* object, Matrix* view_inverse, int mode);
 // Removes backfaces meaning that the method determines if polygons are invisible or clipped from
 // the current viewpoint, and thus only draws relevant polygons. Relevant polygons of object are 
-// also colored and shaded.
+// also colored and shaded. viewpoint is in camera coordinates, i.e (0,0,0).
 void remove_backfaces(Object* object, Vector* viewpoint, int mode);
 // This fnuction clip an object in camera coordiantes against the 3D viewing
 // volume. The function has 2 mode of operation. In CLIP_Z_MODE the 
@@ -109,7 +202,49 @@ void clip_polygon(facet *world_poly_storage, facet **world_polys, int *num_polys
 // Object by object the list is built up by converting into facets/polygons. 
 void generate_poly_list(facet *world_poly_storage, facet **world_polys, int *num_polys_frame, Object* object);
 // Draws all polygons in list. Similar to object_draw_solid.
-void draw_poly_list_z(facet **world_polys, int *num_polys_frame, uint32_t* pixelmap, int *z_buffer);
+// With more than 1 raster thread the list is drawn by draw_poly_list_tiled.
+// With POLY_SORT_BACK_TO_FRONT the list is painted in its order without
+// touching z_buffer (painter's algorithm, sort_poly_list puts it in order).
+// With SHADE_DEFERRED the triangles are drawn as ids and shaded afterwards.
+// With HSR_SBUFFER the list is drawn by draw_poly_list_spans (z_buffer,
+// sort order, threads and shading do not matter then).
+void draw_poly_list_z(facet **world_polys, int *num_polys_frame, uint32_t* pixelmap, void *z_buffer);
+
+#define POLY_SORT_NONE          0   // list is drawn in the order it was generated
+#define POLY_SORT_FRONT_TO_BACK 1   // nearest first, hidden pixels fail the depth test early
+#define POLY_SORT_BACK_TO_FRONT 2   // farthest first, painted without z-buffer
+
+// Selects order sort_poly_list puts the list in (POLY_SORT_NONE by default).
+void poly_set_sort(int mode);
+// Returns order in use.
+int poly_sort(void);
+// Returns name of order ("none", "front-to-back" or "back-to-front").
+const char* poly_sort_name(int mode);
+// Sorts the list by average camera space z of each facet with a stable radix
+// sort (linear time, facets of equal depth keep their order). Does nothing
+// with POLY_SORT_NONE. Uses static scratch buffers, so it is not reentrant.
+void sort_poly_list(facet **world_polys, int num_polys_frame);
+
+// Screen space triangle as handed to draw_triangle_3D_z.
+typedef struct {
+    int x[3], y[3], z[3];
+    int color[4];       // color[0] for FLAT_SHADING, color[0..2] for GOURAUD_SHADING
+    int mode;
+    const Texture* texture;         // NULL unless textured, color then only lights the texels
+    float u[3], v[3], w[3];         // texture coordinates and 1/z of camera space z (only if textured)
+    int sx[3], sy[3];               // x and y in 28.4 fixed point (sub-pixel, for RASTER_SUBPIXEL)
+}RasterTriangle;
+
+// Projects facet to the screen and stores its triangles in triangles (a quad
+// is split in 2, the second one flat shaded, depths encoded with depth_encode).
+// Textured facets keep their texture unless a vertex is not in front of the camera.
+// Returns amount of triangles, 0 when the facet is entirely in front of near z
+// or behind far z.
+int project_facet(const facet* poly, RasterTriangle triangles[2]);
+// Draws triangle from project_facet with draw_triangle_3D_z, with
+// draw_triangle_subpixel for RASTER_SUBPIXEL scanline stepping, or with
+// draw_triangle_textured if it has a texture and texturing is not TEXTURE_OFF.
+void draw_raster_triangle(RasterTriangle* t, uint32_t* pixelmap, void *z_buffer);
 // Resets polygon list by setting num_polys_frame to 0.
 static inline void reset_poly_list(int *num_polys_frame) {
     *num_polys_frame = 0;
@@ -117,13 +252,90 @@ static inline void reset_poly_list(int *num_polys_frame) {
 
 /* All draw triangle functions found in drawtriangle.c */
 
+#define RASTER_FLOAT    0   // float edge, z and color stepping (inclusive spans)
+#define RASTER_FIXED    1   // 16.16 fixed point stepping (drawfixed.c, inclusive spans)
+#define RASTER_SUBPIXEL 2   // 28.4 sub-pixel edges with a top-left fill rule (drawsubpixel.c, default)
+
+// Selects float, 16.16 fixed point or 28.4 sub-pixel edge, z and color stepping.
+// The float and fixed point spans include both ends, so pixels on an edge shared
+// by 2 triangles are drawn twice, sub-pixel stepping (the default) draws them once.
+void raster_set_stepping(int mode);
+// Returns stepping in use.
+int raster_stepping(void);
+// Returns name of stepping ("float", "fixed" or "subpixel").
+const char* raster_stepping_name(int mode);
+
+// Returns mode first..last whose name (as returned by name, e.g.
+// raster_stepping_name) is value, or -1. Used to parse the mode flags of main
+// and the benchmarks.
+int mode_from_name(const char* value, int first, int last, const char* (*name)(int));
+
+#define RASTER_SCANLINE  0  // flat top/bottom triangles filled span by span
+#define RASTER_HALFSPACE 1  // edge functions over pixel blocks (drawhalfspace.c)
+
+// Selects scanline (flat top/bottom spans) or half-space (edge function) rasterizer.
+void raster_set_algorithm(int mode);
+// Returns rasterizer in use.
+int raster_algorithm(void);
+// Returns name of rasterizer ("scanline" or "halfspace").
+const char* raster_algorithm_name(int mode);
+
+// Limits drawing of the calling thread to rows first..last. Rows above first are
+// still stepped through, so every band gets the same values as the whole screen.
+void raster_set_band(int first, int last);
+// Returns first and last row the calling thread may draw.
+void raster_band(int* first, int* last);
+// Limits drawing of the calling thread to columns first..last. Pixels left of
+// first are still stepped through, so every tile gets the same values as the
+// whole screen.
+void raster_set_columns(int first, int last);
+// Returns first and last column the calling thread may draw.
+void raster_columns(int* first, int* last);
+
 // Draws Triangles by determining float top or bottom triangle. 
 // Same as draw_triangle_2D() except that this function incorporates a Z-buffer.
+// With RASTER_FIXED stepping the split point is computed with integers and the
+// fixed point triangle functions are used, unless a coordinate is out of range.
+// With RASTER_HALFSPACE the triangle is handed to draw_triangle_halfspace
+// instead (same range rule), with RASTER_SUBPIXEL stepping of the scanline
+// rasterizer to draw_triangle_subpixel (vertices at pixel centers). z1, z2, z3
+// are depth values of the depth format in use (see depth.h), the z-buffer holds
+// their depth test keys. Without a z-buffer (NULL) every pixel is painted over.
 void draw_triangle_3D_z(int x1, int y1, int z1,
                         int x2, int y2, int z2,
                         int x3, int y3, int z3,
-                        int color[4], uint32_t* pixelmap, int *z_buffer, int mode);
+                        int color[4], uint32_t* pixelmap, void *z_buffer, int mode);
 
+// Wipes tiles of an older epoch under the triangle with pixel vertices
+// x1,y1 - x3,y3 and returns 1 if it is behind everything in the tiles it
+// touches (spans may end a pixel beyond the vertices), painted triangles
+// without z-buffer only wipe. Every filler calls it before drawing.
+int triangle_tiles_hidden(int x1, int y1, int z1, int x2, int y2, int z2, int x3, int y3, int z3,
+                          uint32_t* pixelmap, void *z_buffer);
+
+#define TEXTURE_OFF    0    // textured triangles are drawn with their color like any other
+#define TEXTURE_AFFINE 1    // texture coordinates stepped linearly over each span (warps under perspective)
+#define TEXTURE_16     2    // perspective divide every 16 pixels, affine in between
+#define TEXTURE_8      3    // perspective divide every 8 pixels, affine in between
+#define TEXTURE_EXACT  4    // perspective divide at every pixel
+
+// Selects how textured triangles are drawn (TEXTURE_16 by default).
+void raster_set_texture(int mode);
+// Returns texturing in use.
+int raster_texture(void);
+// Returns name of texturing ("off", "affine", "16", "8" or "exact").
+const char* raster_texture_name(int mode);
+
+// Draws textured triangle t (see RasterTriangle) with the scanline edges of
+// draw_triangle_3D_z, so it covers the same pixels as an untextured one. Every
+// span divides u/z and v/z by 1/z at its start and then every 8 or 16 pixels
+// (TEXTURE_8, TEXTURE_16) and steps the texture coordinates linearly in
+// between. The mip level is picked once per triangle from its texels per
+// pixel and every texel is lit by the color of the triangle (its average for
+// GOURAUD_SHADING). Depth test, hierarchical z, epoch tiles, bands and columns
+// work as in draw_triangle_3D_z. The rasterizer setting is not used, with RASTER_SUBPIXEL
+// stepping the spans are the ones of draw_triangle_subpixel (sx, sy of t).
+void draw_triangle_textured(const RasterTriangle* t, uint32_t* pixelmap, void *z_buffer);
 
 // Extra shading function that breaks the triangle down using interpolation
 // into even smaller areas. These areas then use a shading from 0-63 steps to 
@@ -131,6 +343,151 @@ void draw_triangle_3D_z(int x1, int y1, int z1,
 void draw_tb_triangle_3d_gouraud(int x1, int y1, int z1, int i1,
                         int x2, int y2, int z2, int i2,
                         int x3, int y3, int z3, int i3,
-                        uint32_t* pixelmap, int *z_buffer);
+                        uint32_t* pixelmap, void *z_buffer);
+
+/* Fixed point triangle functions found in drawfixed.c */
+
+// Fills reciprocal table, must be called before the first fixed point triangle
+// (done by raster_set_stepping).
+void draw_fixed_init(void);
+
+// Draws flat top or flat bottom triangle with 16.16 fixed point stepping.
+void draw_tb_triangle_3d_z_fixed(int x1, int y1, int z1,
+                        int x2, int y2, int z2,
+                        int x3, int y3, int z3,
+                        int color, uint32_t* pixelmap, void *z_buffer);
+// Fixed point version of draw_tb_triangle_3d_gouraud, the 3 color channels
+// are interpolated as 16.16 integers just like z.
+void draw_tb_triangle_3d_gouraud_fixed(int x1, int y1, int z1, int i1,
+                        int x2, int y2, int z2, int i2,
+                        int x3, int y3, int z3, int i3,
+                        uint32_t* pixelmap, void *z_buffer);
+
+/* Sub-pixel triangle functions found in drawsubpixel.c */
+
+#define SUBPIXEL_BITS 4                         // 28.4 fixed point screen coordinates
+#define SUBPIXEL_ONE  (1 << SUBPIXEL_BITS)
+#define SUBPIXEL_MAX  (1 << 26)                 // coordinates are clamped to +-4M pixels
+
+// Returns screen coordinate v (pixel x covers v from x to x + 1) in 28.4 fixed point.
+static inline int subpixel_from_float(float v) {
+    v *= SUBPIXEL_ONE;
+    return (v >= SUBPIXEL_MAX) ? SUBPIXEL_MAX : ((v > -SUBPIXEL_MAX) ? (int) lrintf(v) : -SUBPIXEL_MAX);
+}
+
+// Returns center of pixel x in 28.4 fixed point.
+static inline int subpixel_from_pixel(int x) {
+    return (x * SUBPIXEL_ONE) + (SUBPIXEL_ONE / 2);
+}
+
+// Triangle with 28.4 vertices prepared for subpixel_triangle_spans.
+typedef struct {
+    int x[3], y[3];     // vertices sorted by y
+    int long_left;      // 1 if edge 0-2 (the one spanning all rows) is the left edge
+    int row_first,      // first row drawn
+        row_middle,     // first row at or below vertex 1
+        row_end;        // row after the last one drawn
+}SubpixelTriangle;
+
+// Draws pixels x_start..x_end of row y for subpixel_triangle_spans, data is
+// whatever the caller handed to it.
+typedef void (*SubpixelSpan)(const void* data, int y, int x_start, int x_end, uint32_t* pixelmap, void *z_buffer);
+
+// Sorts the 28.4 vertices x, y into s and finds the rows to draw inside the
+// clipping rectangle and the band of the calling thread. Returns 0 if the
+// triangle has no area or no pixel to draw.
+int subpixel_triangle_setup(SubpixelTriangle* s, const int x[3], const int y[3]);
+
+// Walks the rows of s and hands the pixels of each row to span. A pixel belongs
+// to the triangle when its center is inside, or exactly on a top or left edge
+// (top-left fill rule, rows walked with y increasing), so triangles sharing an
+// edge never both draw a pixel of it and leave no gap between them. Edges are
+// stepped exactly with integers.
+void subpixel_triangle_spans(const SubpixelTriangle* s, SubpixelSpan span, const void* data,
+                             uint32_t* pixelmap, void *z_buffer);
+
+// Draws triangle t by its 28.4 vertices sx, sy with subpixel_triangle_spans.
+// Depth and color are plane equations evaluated at the pixel centers (color
+// shaded as t->mode, texture ignored). Depth test, hierarchical z, epoch tiles,
+// bands and columns work as in draw_triangle_3D_z.
+void draw_triangle_subpixel(const RasterTriangle* t, uint32_t* pixelmap, void *z_buffer);
+
+/* Half-space rasterizer found in drawhalfspace.c */
+
+#define HALFSPACE_MAX_COORD 8191    // keeps edge functions and area within 32 bits
+
+// Draws triangle with edge functions evaluated over 4x4 pixel blocks (SSE2 rows
+// of 4 pixels), skipping blocks outside the triangle and filling blocks inside
+// it without edge tests. Depth and color are interpolated with plane equations.
+// Takes the same input as draw_triangle_3D_z (mode FLAT_SHADING uses color[0],
+// GOURAUD_SHADING interpolates color[0..2], a NULL z_buffer paints over every
+// pixel). Coordinates must be within +-HALFSPACE_MAX_COORD.
+void draw_triangle_halfspace(int x1, int y1, int z1,
+                             int x2, int y2, int z2,
+                             int x3, int y3, int z3,
+                             int color[4], uint32_t* pixelmap, void *z_buffer, int mode);
+
+/* Visibility buffer shading found in drawdeferred.c */
+
+#define SHADE_FORWARD  0    // rasterizers shade every pixel that passes the depth test
+#define SHADE_DEFERRED 1    // rasterizers write triangle ids, visibility_shade colors each pixel once
+
+// Selects forward (shaded while rasterizing) or deferred (visibility buffer) shading.
+void raster_set_shading(int mode);
+// Returns shading in use.
+int raster_shading(void);
+// Returns name of shading ("forward" or "deferred").
+const char* raster_shading_name(int mode);
+
+// Starts visibility buffer of a new frame (no ids handed out yet).
+void visibility_begin(void);
+// Keeps the color planes of t under the next id and turns t into a flat
+// triangle of that id, so the rasterizers write only depth and id (textures
+// are dropped, textured triangles are shaded with their color). Returns 0
+// when the ids of the frame are used up, t must then not be drawn.
+int visibility_add(RasterTriangle* t);
+// Replaces the ids in rectangle min_x,min_y - max_x,max_y of pixelmap by the
+// gouraud color of their triangle at that pixel, every pixel is shaded once.
+// Tiles of an older epoch are skipped (they hold last frame, buffers_resolve
+// blanks them).
+void visibility_shade(uint32_t* pixelmap, int min_x, int min_y, int max_x, int max_y);
+
+/* Span buffer hidden surface removal found in drawspans.c */
+
+#define HSR_ZBUFFER 0   // rasterizers test every pixel against the z-buffer
+#define HSR_SBUFFER 1   // visible spans per row are resolved first, every pixel is written once
+
+// Selects z-buffer or span buffer hidden surface removal.
+void raster_set_hsr(int mode);
+// Returns hidden surface removal in use.
+int raster_hsr(void);
+// Returns name of hidden surface removal ("zbuffer" or "sbuffer").
+const char* raster_hsr_name(int mode);
+
+// Draws the poly list into pixelmap with a span buffer instead of a z-buffer,
+// every pixel of pixelmap is written exactly once (black where nothing is).
+// Textured facets are drawn with their color.
+// Always runs on the calling thread. The tiles of pixelmap count as drawn,
+// so buffers_resolve leaves the result alone.
+void draw_poly_list_spans(facet **world_polys, int num_polys, uint32_t* pixelmap);
+
+/* Tile binned multithreaded rasterization found in drawtiles.c */
+
+#define TILE_SIZE          32   // rows and columns per tile
+#define TILES_X            ((WINDOW_WIDTH + TILE_SIZE - 1) / TILE_SIZE)
+#define TILES_Y            ((WINDOW_HEIGHT + TILE_SIZE - 1) / TILE_SIZE)
+#define TILES              (TILES_X * TILES_Y)
+#define RASTER_MAX_THREADS 64
+
+// Sets amount of threads drawing the poly list, the calling thread included
+// (1 = serial draw_poly_list_z). Starts or stops worker threads as needed and
+// returns amount in use. Builds with RASTER_STATS always stay serial.
+int raster_set_threads(int count);
+// Returns amount of threads drawing the poly list.
+int raster_threads(void);
+// Projects the poly list, bins the triangles into tiles (TILE_SIZE x TILE_SIZE
+// pixels, submission order kept per tile) and lets every thread rasterize whole
+// tiles into pixelmap and z_buffer. The result is bit identical to the serial path.
+void draw_poly_list_tiled(facet **world_polys, int num_polys, uint32_t* pixelmap, void *z_buffer);
 
 #endif
\ No newline at end of file
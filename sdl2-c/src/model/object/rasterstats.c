@@ -0,0 +1,88 @@
+#include "rasterstats.h"
+
+#ifdef RASTER_STATS
+
+#include <string.h>
+
+RasterStats raster_stats;
+uint16_t    raster_overdraw[ALL_PIXELS];
+
+// Resets all counters.
+void raster_stats_reset(void) {
+    memset(&raster_stats, 0, sizeof(RasterStats));
+}
+
+// Clears per pixel write counts before a frame is rasterized.
+void raster_stats_frame_begin(void) {
+    memset(raster_overdraw, 0, sizeof(raster_overdraw));
+}
+
+// Adds distinct pixels written during frame to pixels_covered.
+void raster_stats_frame_end(void) {
+    for(int i = 0; i < ALL_PIXELS; i++) {
+        if(raster_overdraw[i] > 0) {
+            raster_stats.pixels_covered++;
+        }
+    }
+    raster_stats.frames++;
+}
+
+// Overdraw, i.e average amount of writes per covered pixel.
+double raster_stats_overdraw(void) {
+    if(raster_stats.pixels_covered == 0) {
+        return 0;
+    }
+    return (double) raster_stats.depth_passes / (double) raster_stats.pixels_covered;
+}
+
+// Prints all counters (totals and per frame).
+void raster_stats_print(FILE* out) {
+    double frames = (raster_stats.frames > 0) ? (double) raster_stats.frames : 1;
+    uint64_t rejected = raster_stats.rejected_degenerate + raster_stats.rejected_offscreen +
+                        raster_stats.rejected_z_clipped + raster_stats.rejected_hiz;
+
+    fprintf(out, "raster stats of %llu frames\n", (unsigned long long) raster_stats.frames);
+    fprintf(out, "%-24s %14s %14s\n", "counter", "total", "per frame");
+    fprintf(out, "%-24s %14llu %14.1f\n", "triangles submitted",
+            (unsigned long long) raster_stats.triangles_submitted, raster_stats.triangles_submitted / frames);
+    fprintf(out, "%-24s %14llu %14.1f\n", "triangles rejected",
+            (unsigned long long) rejected, rejected / frames);
+    fprintf(out, "%-24s %14llu %14.1f\n", "  degenerate",
+            (unsigned long long) raster_stats.rejected_degenerate, raster_stats.rejected_degenerate / frames);
+    fprintf(out, "%-24s %14llu %14.1f\n", "  off-screen",
+            (unsigned long long) raster_stats.rejected_offscreen, raster_stats.rejected_offscreen / frames);
+    fprintf(out, "%-24s %14llu %14.1f\n", "  z-clipped",
+            (unsigned long long) raster_stats.rejected_z_clipped, raster_stats.rejected_z_clipped / frames);
+    fprintf(out, "%-24s %14llu %14.1f\n", "  hierarchical z",
+            (unsigned long long) raster_stats.rejected_hiz, raster_stats.rejected_hiz / frames);
+    fprintf(out, "%-24s %14llu %14.1f\n", "scanlines",
+            (unsigned long long) raster_stats.scanlines, raster_stats.scanlines / frames);
+    fprintf(out, "%-24s %14llu %14.1f\n", "  hierarchical z",
+            (unsigned long long) raster_stats.spans_hiz, raster_stats.spans_hiz / frames);
+    fprintf(out, "%-24s %14llu %14.1f\n", "depth tests",
+            (unsigned long long) raster_stats.depth_tests, raster_stats.depth_tests / frames);
+    fprintf(out, "%-24s %14llu %14.1f\n", "depth passes",
+            (unsigned long long) raster_stats.depth_passes, raster_stats.depth_passes / frames);
+    fprintf(out, "%-24s %14llu %14.1f\n", "pixels covered",
+            (unsigned long long) raster_stats.pixels_covered, raster_stats.pixels_covered / frames);
+    fprintf(out, "%-24s %14.3f\n", "overdraw", raster_stats_overdraw());
+}
+
+// Debug view that replaces pixelmap with a heatmap of writes per pixel of
+// the current frame: black = 0, blue = 1, green = 2, yellow = 3, orange = 4, red = 5+.
+void raster_stats_heatmap(uint32_t* pixelmap) {
+    static const uint32_t heat[6] = {
+        _RGB32BIT(0,   0,   0,   0),
+        _RGB32BIT(0,   0,   0, 255),
+        _RGB32BIT(0,   0, 255,   0),
+        _RGB32BIT(0, 255, 255,   0),
+        _RGB32BIT(0, 255, 128,   0),
+        _RGB32BIT(0, 255,   0,   0),
+    };
+    for(int i = 0; i < ALL_PIXELS; i++) {
+        int writes = raster_overdraw[i];
+        pixelmap[i] = heat[(writes > 5) ? 5 : writes];
+    }
+}
+
+#endif
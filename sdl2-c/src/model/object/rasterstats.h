@@ -0,0 +1,71 @@
+#ifndef RASTERSTATS_H
+#define RASTERSTATS_H
+
+#include "../global.h"
+#include <stdint.h>
+#include <stdio.h>
+
+// Rasterizer counters.
+// Compiled in only when RASTER_STATS is defined (e.g. -DRASTER_STATS), otherwise
+// every macro below expands to nothing so the fillers keep their inner loops.
+
+// Counters accumulated since last raster_stats_reset.
+typedef struct {
+    uint64_t frames,
+             triangles_submitted,   // triangles handed to draw_poly_list_z
+             rejected_degenerate,   // horizontal or vertical lines
+             rejected_offscreen,    // trivially rejected against screen
+             rejected_z_clipped,    // entirely in front of near or behind far z
+             rejected_hiz,          // behind the hierarchical z tiles it touches
+             spans_hiz,             // spans behind the hierarchical z tiles
+             scanlines,             // spans walked by the fillers
+             depth_tests,           // z-buffer comparisons
+             depth_passes,          // z-buffer comparisons that wrote a pixel
+             pixels_covered;        // distinct pixels written at end of each frame
+}RasterStats;
+
+#ifdef RASTER_STATS
+
+extern RasterStats raster_stats;
+extern uint16_t    raster_overdraw[ALL_PIXELS];   // writes per pixel during current frame
+
+// Resets all counters.
+void raster_stats_reset(void);
+
+// Clears per pixel write counts before a frame is rasterized.
+void raster_stats_frame_begin(void);
+
+// Adds distinct pixels written during frame to pixels_covered.
+void raster_stats_frame_end(void);
+
+// Overdraw, i.e average amount of writes per covered pixel.
+double raster_stats_overdraw(void);
+
+// Prints all counters (totals and per frame).
+void raster_stats_print(FILE* out);
+
+// Debug view that replaces pixelmap with a heatmap of writes per pixel of
+// the current frame: black = 0, blue = 1, green = 2, yellow = 3, orange = 4, red = 5+.
+void raster_stats_heatmap(uint32_t* pixelmap);
+
+#define RASTER_STAT(counter)            (raster_stats.counter++)
+#define RASTER_STAT_ADD(counter, n)     (raster_stats.counter += (n))
+#define RASTER_STAT_WRITE(index)        (raster_overdraw[(index)]++)
+#define RASTER_STATS_RESET()            raster_stats_reset()
+#define RASTER_STATS_FRAME_BEGIN()      raster_stats_frame_begin()
+#define RASTER_STATS_FRAME_END()        raster_stats_frame_end()
+#define RASTER_STATS_PRINT(out)         raster_stats_print(out)
+
+#else
+
+#define RASTER_STAT(counter)
+#define RASTER_STAT_ADD(counter, n)
+#define RASTER_STAT_WRITE(index)
+#define RASTER_STATS_RESET()
+#define RASTER_STATS_FRAME_BEGIN()
+#define RASTER_STATS_FRAME_END()
+#define RASTER_STATS_PRINT(out)
+
+#endif
+
+#endif
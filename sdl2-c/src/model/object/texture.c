@@ -0,0 +1,137 @@
+#include "texture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Textures loaded so far, looked up by filename.
+static struct {
+    Texture* textures[MAX_TEXTURES];
+    int      amount;
+}texture_cache;
+
+// Returns log2 of size or -1 if size is not a power of 2 between TEXTURE_TILE
+// and TEXTURE_MAX_SIZE.
+static int size_shift(int size) {
+    int shift = 0;
+    if(size < TEXTURE_TILE || size > TEXTURE_MAX_SIZE || (size & (size - 1)) != 0) {
+        return -1;
+    }
+    while((1 << shift) < size) {
+        shift++;
+    }
+    return shift;
+}
+
+// Average of 4 texels, every channel rounded.
+static uint32_t texel_average(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    uint32_t color = 0;
+    for(int shift = 0; shift < 32; shift += 8) {
+        uint32_t sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) + ((c >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+        color |= ((sum + 2) >> 2) << shift;
+    }
+    return color;
+}
+
+// Creates texture with mip levels from width x height texels (rows from bottom
+// to top, colors packed as _RGB32BIT). Returns NULL if a size is not a power of
+// 2 between TEXTURE_TILE and TEXTURE_MAX_SIZE or memory could not be allocated.
+Texture* texture_create(const uint32_t* texels, int width, int height) {
+    int width_shift = size_shift(width);
+    size_t total = 0;
+
+    if(width_shift < 0 || size_shift(height) < 0) {
+        printf("texture is %dx%d, sizes must be powers of 2 from %d to %d\n",
+               width, height, TEXTURE_TILE, TEXTURE_MAX_SIZE);
+        return NULL;
+    }
+    Texture* texture = calloc(1, sizeof(Texture));
+    if(texture == NULL) {
+        printf("could not allocate texture\n");
+        return NULL;
+    }
+
+    // sizes of every level, halved until a side would be smaller than a block
+    for(int w = width, h = height, shift = width_shift; ; w >>= 1, h >>= 1, shift--) {
+        TextureLevel* level = &texture->level[texture->levels++];
+        level->width       = w;
+        level->height      = h;
+        level->width_shift = shift;
+        total += (size_t) w * h;
+        if(w == TEXTURE_TILE || h == TEXTURE_TILE || texture->levels == TEXTURE_MAX_LEVELS) {
+            break;
+        }
+    }
+
+    // one allocation for all levels, aligned so every block is a single cache line
+    total *= sizeof(uint32_t);
+    texture->memory = aligned_alloc(64, (total + 63) & ~(size_t) 63);
+    if(texture->memory == NULL) {
+        printf("could not allocate texture (%dx%d)\n", width, height);
+        free(texture);
+        return NULL;
+    }
+    uint32_t* texels_level = texture->memory;
+    for(int index = 0; index < texture->levels; index++) {
+        texture->level[index].texels = texels_level;
+        texels_level += texture->level[index].width * texture->level[index].height;
+    }
+
+    // level 0 from the rows, every other level averages 2x2 texels of the one above
+    const TextureLevel* top = &texture->level[0];
+    for(int v = 0; v < height; v++) {
+        for(int u = 0; u < width; u++) {
+            top->texels[texture_index(top, u, v)] = texels[(v * width) + u];
+        }
+    }
+    for(int index = 1; index < texture->levels; index++) {
+        const TextureLevel* above = &texture->level[index - 1];
+        const TextureLevel* level = &texture->level[index];
+        for(int v = 0; v < level->height; v++) {
+            for(int u = 0; u < level->width; u++) {
+                level->texels[texture_index(level, u, v)] =
+                    texel_average(texture_texel(above, 2 * u, 2 * v),     texture_texel(above, 2 * u + 1, 2 * v),
+                                  texture_texel(above, 2 * u, 2 * v + 1), texture_texel(above, 2 * u + 1, 2 * v + 1));
+            }
+        }
+    }
+    return texture;
+}
+
+// Frees texture and all of its levels.
+void texture_free(Texture* texture) {
+    if(texture == NULL) {
+        return;
+    }
+    free(texture->memory);
+    free(texture);
+}
+
+// Returns already loaded texture of file or NULL.
+Texture* texture_cache_find(const char* filename) {
+    for(int index = 0; index < texture_cache.amount; index++) {
+        if(strcmp(texture_cache.textures[index]->filename, filename) == 0) {
+            return texture_cache.textures[index];
+        }
+    }
+    return NULL;
+}
+
+// Adds texture to cache so that later loads of the same file reuse it.
+// Returns 0 if cache is full (texture is then owned by caller).
+int texture_cache_add(Texture* texture, const char* filename) {
+    snprintf(texture->filename, sizeof(texture->filename), "%s", filename);
+    if(texture_cache.amount >= MAX_TEXTURES) {
+        return 0;
+    }
+    texture_cache.textures[texture_cache.amount++] = texture;
+    return 1;
+}
+
+// Frees every cached texture, polygons using them must not be rendered afterwards.
+void texture_cache_clear(void) {
+    for(int index = 0; index < texture_cache.amount; index++) {
+        texture_free(texture_cache.textures[index]);
+        texture_cache.textures[index] = NULL;
+    }
+    texture_cache.amount = 0;
+}
@@ -0,0 +1,63 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <stdint.h>
+
+// Textures.
+// Width and height are powers of 2, so texture coordinates wrap (repeat) with a
+// mask. Every mip level halves both sizes down to TEXTURE_TILE texels and is
+// averaged from the level above it. Texels of a level are stored in blocks of
+// TEXTURE_TILE x TEXTURE_TILE (64 bytes, one cache line), block after block
+// row by row, so a span stepping through the texture in any direction touches
+// a new cache line only every few texels and not on every row of the texture.
+// Texture coordinates are u to the right and v up, (0,0) is the bottom left
+// texel and (1,1) the top right corner.
+
+#define TEXTURE_TILE        4       // texels per side of a block
+#define TEXTURE_MAX_SIZE    1024    // largest width and height
+#define TEXTURE_MAX_LEVELS  9       // 1024 down to TEXTURE_TILE
+#define MAX_TEXTURES        32      // amount of distinct textures kept in texture cache
+
+// Mip level of a texture.
+typedef struct {
+    int       width, height;
+    int       width_shift;      // log2 of width
+    uint32_t* texels;           // blocks of TEXTURE_TILE x TEXTURE_TILE texels
+}TextureLevel;
+
+// Texture structure.
+// Loaded once per file and shared by every polygon using it, never changed afterwards.
+typedef struct {
+    char         filename[128];     // file texture was loaded from (texture cache key)
+    int          levels;            // mip levels, level 0 is the full size
+    TextureLevel level[TEXTURE_MAX_LEVELS];
+    uint32_t*    memory;            // texels of every level
+}Texture;
+
+// Creates texture with mip levels from width x height texels (rows from bottom
+// to top, colors packed as _RGB32BIT). Returns NULL if a size is not a power of
+// 2 between TEXTURE_TILE and TEXTURE_MAX_SIZE or memory could not be allocated.
+Texture* texture_create(const uint32_t* texels, int width, int height);
+// Frees texture and all of its levels.
+void texture_free(Texture* texture);
+
+// Returns already loaded texture of file or NULL.
+Texture* texture_cache_find(const char* filename);
+// Adds texture to cache so that later loads of the same file reuse it.
+// Returns 0 if cache is full (texture is then owned by caller).
+int texture_cache_add(Texture* texture, const char* filename);
+// Frees every cached texture, polygons using them must not be rendered afterwards.
+void texture_cache_clear(void);
+
+// Returns index of texel u,v (already wrapped into the level) in level->texels.
+static inline int texture_index(const TextureLevel* level, int u, int v) {
+    return ((v & ~(TEXTURE_TILE - 1)) << level->width_shift) + ((u & ~(TEXTURE_TILE - 1)) * TEXTURE_TILE) +
+           ((v & (TEXTURE_TILE - 1)) * TEXTURE_TILE) + (u & (TEXTURE_TILE - 1));
+}
+
+// Returns texel u,v of level, coordinates outside of the level repeat it.
+static inline uint32_t texture_texel(const TextureLevel* level, int u, int v) {
+    return level->texels[texture_index(level, u & (level->width - 1), v & (level->height - 1))];
+}
+
+#endif
@@ -1,65 +1,112 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "polygon.h"
 
-// Computes the maximum radius or sphere around object.
+// Computes the maximum radius or sphere around object (scale included).
+// Distances to the origin are measured in one batch (vertices_length).
 float compute_object_radius(Object* object) {
-    float new_radius, x,y,z;    // used in average radious calculation of object
+    float* lengths = aligned_alloc(VERTICES_ALIGN, sizeof(float) * object->vertices_local->capacity);
+    if(lengths == NULL) {
+        printf("could not allocate radius buffer (verts: %d)\n", object->num_vertices);
+        return object->radius;
+    }
+    vertices_length(object->vertices_local, lengths, PRECISION_EXACT);
     object->radius = 0;
     for(int index = 0; index < object->num_vertices; index++) {
-        x = object->vertices_local[index].x;
-        y = object->vertices_local[index].y;
-        z = object->vertices_local[index].z;
-        // compute distance to point and if this radius is bigger than
-        // last then change to bigger radius.
-        new_radius = (float) d_sqrt((x*x) + (y*y) + (z*z));
-        if(new_radius > object->radius) {
-            object->radius = new_radius;
+        // if this radius is bigger than last then change to bigger radius.
+        if(lengths[index] > object->radius) {
+            object->radius = lengths[index];
         }
     }
+    free(lengths);
+    object->radius *= object->scale;
     return object->radius;
 }
 
-// Rotates object along the y-axis via matrix multiplication.
+// Rotates object along the y-axis (same direction as matrix_create_rotation_matrix_y),
+// only the orientation of the object changes and the local vertices of its mesh
+// are left as they are.
 void object_rotate_y(Object* object, float angle_rad) {
-    Matrix m, y = matrix_create_rotation_matrix_y(angle_rad);
-    for(int index = 0; index < object->num_vertices; index++) {
-        m = vector_as_matrix(&object->vertices_local[index]);
-        m = matrix_mul(&m, &y);
-        object->vertices_local[index].x = m.matrix[0][0];
-        object->vertices_local[index].y = m.matrix[0][1];
-        object->vertices_local[index].z = m.matrix[0][2];
-    }
-
+    Vector axis = vector_create(0, 1, 0);
+    Quaternion rotation = quaternion_from_axis_angle(&axis, -angle_rad);
+    rotation = quaternion_mul(&rotation, &object->orientation);
+    object->orientation = quaternion_normalize(&rotation);
+    object->translation_only = 0;
+    object->model_dirty = 1;
+    object->world_valid = 0;
 }
 
-// Rotates object along the z-axis via matrix multiplication.
+// Rotates object along the z-axis (same direction as matrix_create_rotation_matrix_z),
+// only the orientation of the object changes and the local vertices of its mesh
+// are left as they are.
 void object_rotate_z(Object* object, float angle_rad) {
-    Matrix m, z = matrix_create_rotation_matrix_z(angle_rad);
-    for(int index = 0; index < object->num_vertices; index++) {
-        m = vector_as_matrix(&object->vertices_local[index]);
-        m = matrix_mul(&m, &z);
-        object->vertices_local[index].x = m.matrix[0][0];
-        object->vertices_local[index].y = m.matrix[0][1];
-        object->vertices_local[index].z = m.matrix[0][2];
+    Vector axis = vector_create(0, 0, 1);
+    Quaternion rotation = quaternion_from_axis_angle(&axis, -angle_rad);
+    rotation = quaternion_mul(&rotation, &object->orientation);
+    object->orientation = quaternion_normalize(&rotation);
+    object->translation_only = 0;
+    object->model_dirty = 1;
+    object->world_valid = 0;
+}
+
+// Sets uniform scale of object relative to its mesh, bounding radius follows.
+void object_scale(Object* object, float scale) {
+    object->scale  = scale;
+    object->radius = object->mesh->radius * scale;
+    if(scale != 1) {
+        object->translation_only = 0;
     }
+    object->model_dirty = 1;
+    object->world_valid = 0;
+}
 
+// Returns the model matrix of object: scale, then orientation, then translation
+// to world position (row vectors, v * S * R * T). Only rebuilt when dirty.
+const Matrix* object_model_matrix(Object* object) {
+    if(object->model_dirty) {
+        object->model = quaternion_to_matrix(&object->orientation);
+        for(int row = 0; row < 3; row++) {
+            for(int col = 0; col < 3; col++) {
+                object->model.matrix[row][col] *= object->scale;
+            }
+        }
+        object->model.matrix[3][0] = object->world_pos.x;
+        object->model.matrix[3][1] = object->world_pos.y;
+        object->model.matrix[3][2] = object->world_pos.z;
+        object->model_dirty = 0;
+    }
+    return &object->model;
 }
 
-// Transforms local coordinates to world coordinates by simply translating (adding) world pos 
-// with local coordinates.
+// Transforms local coordinates to world coordinates. Objects that are neither
+// rotated nor scaled are simply translated (adding world pos to local coordinates).
 void object_local_to_world_transformation(Object* object) {
-    for(int index = 0; index < object->num_vertices; index++) {
-        object->vertices_world[index].x = object->vertices_local[index].x + object->world_pos.x;
-        object->vertices_world[index].y = object->vertices_local[index].y + object->world_pos.y;
-        object->vertices_world[index].z = object->vertices_local[index].z + object->world_pos.z;   
+    if(object->vertices_world.x == NULL &&
+       !vertices_allocate(&object->vertices_world, object->num_vertices)) {
+        return;
+    }
+    if(object->translation_only) {
+        vertices_translate(object->vertices_local, &object->vertices_world, &object->world_pos);
+    } else {
+        vertices_transform(object->vertices_local, &object->vertices_world, object_model_matrix(object));
     }
+    object->world_valid = 1;
 }
 
-// Convert the local coordinates into world and camera coordinates for shading
-// and projection. Note the viewer is at (0,0,0) with angles 0,0,0 so the 
-// transformation is imply to add the world position to each  local vertex
-void object_view_transformation(Object *object, Matrix *view_inverse) {  
-    for(int index = 0; index < object->num_vertices; index++) {
-        object->vertices_camera[index] = vector_matrix_mul(&object->vertices_world[index], view_inverse);
+// Returns world coordinates of object, they are only computed the first time
+// a stage asks for them after object_view_transformation.
+const Vertices* object_world_vertices(Object* object) {
+    if(!object->world_valid) {
+        object_local_to_world_transformation(object);
     }
-}
\ No newline at end of file
+    return &object->vertices_world;
+}
+
+// Converts local coordinates straight into camera coordinates for shading and
+// projection. The model matrix is concatenated with view_inverse once, so every
+// vertex is transformed by a single matrix (world coordinates are skipped).
+void object_view_transformation(Object *object, Matrix *view_inverse) {
+    object->model_view = matrix_mul(object_model_matrix(object), view_inverse);
+    vertices_transform(object->vertices_local, &object->vertices_camera, &object->model_view);
+    object->world_valid = 0;
+}
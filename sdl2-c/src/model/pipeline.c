@@ -0,0 +1,83 @@
+#include "pipeline.h"
+#include "../integration/profiler.h"
+#include "object/rasterstats.h"
+#include "object/hiz.h"
+#include "object/depth.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Sizes z-buffer of frame for the depth format in use, returns 0 if it could
+// not be allocated.
+static int frame_depth_buffer(Frame* frame) {
+    int bytes = depth_bytes(depth_format());
+    if(frame->z_buffer == NULL || frame->z_bytes != bytes) {
+        free(frame->z_buffer);
+        frame->z_buffer = malloc((size_t) ALL_PIXELS * bytes);
+        frame->z_bytes  = bytes;
+    }
+    return frame->z_buffer != NULL;
+}
+
+// A single instance or iteration of entire rendering process
+// that is repeated continously throughout the program:
+//
+// Each object is firstly culled to determine if it is even inside viewing window
+// (two sided polygons are already mirrored once when the mesh is loaded).
+// Convert local coordinates straight into camera coordinates with one fused
+// model-view matrix (world coordinates are only computed if a stage asks).
+// Shade and remove backfaces in camera coordinates, the viewpoint is then the
+// origin and the light source is transformed once per frame.
+// clip the object polygons against viewing volume.
+// generate polygon list.
+// clip possible near_z for each polygon.
+// sort polygon list front to back or back to front (if a sort is selected).
+void pipeline_render_frame(Frame* frame, Scene* scene, Camera* camera) {
+    if(!frame_depth_buffer(frame)) {
+        printf("Could not allocate z-buffer\n");
+        return;
+    }
+
+    // Wipe pixelmap and fill z_buffer with highest possible values
+    // (with epoch clears only a counter, tiles are wiped when drawn).
+    PROFILE(PROFILE_CLEAR, buffers_clear(frame->pixels, frame->z_buffer));
+
+    // Update camera and reset list of polygons.
+    camera_update(camera);
+    reset_poly_list(&frame->num_polys_frame);
+    Vector view_point   = vector_create(0, 0, 0);
+    Vector light_source = vector_matrix_mul(&scene->light_source, &camera->lookAt);
+
+    for(int index = 0; index < scene->amount_of_objects; index++) {
+        Object* object = &scene->objects[index];
+        int culled;
+        PROFILE(PROFILE_CULLING, culled = object_culling(object, &camera->lookAt, OBJECT_CULL_XYZ_MODE));
+        if(!culled)
+        {
+            PROFILE(PROFILE_VIEW,           object_view_transformation(object, &camera->lookAt));
+            PROFILE(PROFILE_BACKFACES,      remove_backfaces(object, &view_point, CONSTANT_SHADING));
+            PROFILE(PROFILE_LIGHT,          light(object, scene->palette, &light_source, scene->ambient_light));
+            PROFILE(PROFILE_CLIP_OBJECT,    clip_object_3D(object, CLIP_XYZ_MODE));
+            PROFILE(PROFILE_POLY_LIST,      generate_poly_list(frame->world_poly_storage, frame->world_polys, &frame->num_polys_frame, object));
+            PROFILE(PROFILE_CLIP_POLYGON,   clip_polygon(frame->world_poly_storage, frame->world_polys, &frame->num_polys_frame));
+        }
+    }
+    // order polygon list by depth, then draw it with z-buffer (or without
+    // when painted back to front).
+    PROFILE(PROFILE_SORT, sort_poly_list(frame->world_polys, frame->num_polys_frame));
+    RASTER_STATS_FRAME_BEGIN();
+    PROFILE(PROFILE_DRAW, draw_poly_list_z(frame->world_polys, &frame->num_polys_frame, frame->pixels, frame->z_buffer));
+    RASTER_STATS_FRAME_END();
+
+    // blank tiles nothing was drawn into.
+    PROFILE(PROFILE_CLEAR, buffers_resolve());
+}
+
+// Counts triangles in polygon list of frame that are handed to the rasterizer
+// (a quad counts as 2 triangles).
+int pipeline_count_triangles(const Frame* frame) {
+    int triangles = 0;
+    for(int curr_poly = 0; curr_poly < frame->num_polys_frame; curr_poly++) {
+        triangles += frame->world_polys[curr_poly]->num_points - 2;
+    }
+    return triangles;
+}
@@ -0,0 +1,46 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "object/polygon.h"
+#include "light/rgba.h"
+#include "camera.h"
+#include "global.h"
+#include <stdint.h>
+
+// Frame structure.
+// Holds pixelmap of entire screen (first quadrant) together with the z-buffer
+// and the polygon i.e facet list containing all faces of all objects.
+// world_polys is pointer for real world_poly_storage. The z-buffer is
+// allocated by pipeline_render_frame for the depth format in use (ALL_PIXELS
+// depths of z_bytes each, see depth.h), a zeroed Frame has none yet.
+typedef struct {
+    uint32_t pixels  [ALL_PIXELS];
+    void*    z_buffer;
+    int      z_bytes;
+    int      num_polys_frame;
+    facet*   world_polys[MAX_POLYS_PER_FRAME];
+    facet    world_poly_storage[MAX_POLYS_PER_FRAME];
+}Frame;
+
+// Scene structure.
+// List of objects that are rendered each frame together with the palette
+// and light source used for shading them.
+typedef struct {
+    Object* objects;
+    int     amount_of_objects;
+    RGBA*   palette;
+    Vector  light_source;
+    float   ambient_light;
+}Scene;
+
+// A single instance or iteration of entire rendering process, renders scene
+// as seen from camera into frame. Does not depend on any display backend.
+// The z-buffer of frame is (re)allocated when the depth format needs another
+// size, nothing is rendered if that fails.
+void pipeline_render_frame(Frame* frame, Scene* scene, Camera* camera);
+
+// Counts triangles in polygon list of frame that are handed to the rasterizer
+// (a quad counts as 2 triangles).
+int pipeline_count_triangles(const Frame* frame);
+
+#endif